@@ -0,0 +1,202 @@
+// Asset loading: every OBJ under models/ through SveModel::Builder::loadModel and the SveModel
+// upload, timed per stage (file read, parse, weld, staging write, GPU copy) with the heap
+// allocations of each model and the peak RSS. Headless, so it runs on software drivers too.
+// Build with `make asset_benchmark`, run from the repository root
+#include "sve_allocation_tracker.hpp"
+#include "sve_device.hpp"
+#include "sve_model.hpp"
+#include "sve_window.hpp"
+
+// std
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// posix
+#include <sys/resource.h>
+
+namespace sve {
+
+static long peakRssKb() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;  // kilobytes on Linux
+}
+
+struct ModelResult {
+    std::string path;
+    uintmax_t fileBytes = 0;
+    size_t vertices = 0;
+    size_t indices = 0;
+    // medians over the repeats
+    float readMs = 0.f;
+    float parseMs = 0.f;
+    float weldMs = 0.f;
+    float stagingMs = 0.f;
+    float copyMs = 0.f;
+    // of the last repeat
+    SveAllocationTracker::Counts loadAllocations{};
+    SveAllocationTracker::Counts uploadAllocations{};
+    long peakRssKb = 0;  // of the process, after this model
+};
+
+static float median(std::vector<float> values) {
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+static ModelResult benchmarkModel(SveDevice &device, const std::string &path, uint32_t repeats) {
+    ModelResult result{};
+    result.path = path;
+    result.fileBytes = std::filesystem::file_size(path);
+
+    std::vector<float> readMs, parseMs, weldMs, stagingMs, copyMs;
+    for (uint32_t i = 0; i < repeats; i++) {
+        auto beforeLoad = SveAllocationTracker::total();
+        SveModel::Builder builder{};
+        builder.loadModel(path);
+        auto afterLoad = SveAllocationTracker::total();
+        auto model = std::make_unique<SveModel>(device, builder);
+        auto afterUpload = SveAllocationTracker::total();
+
+        readMs.push_back(builder.timings.readMs);
+        parseMs.push_back(builder.timings.parseMs);
+        weldMs.push_back(builder.timings.weldMs);
+        stagingMs.push_back(model->getUploadTimings().stagingMs);
+        copyMs.push_back(model->getUploadTimings().copyMs);
+        result.vertices = builder.vertices.size();
+        result.indices = builder.indices.size();
+        result.loadAllocations = afterLoad - beforeLoad;
+        result.uploadAllocations = afterUpload - afterLoad;
+    }
+    result.readMs = median(readMs);
+    result.parseMs = median(parseMs);
+    result.weldMs = median(weldMs);
+    result.stagingMs = median(stagingMs);
+    result.copyMs = median(copyMs);
+    result.peakRssKb = peakRssKb();
+    return result;
+}
+
+static std::vector<std::string> findModels(const std::vector<std::string> &directories) {
+    std::vector<std::string> paths;
+    for (const auto &directory : directories) {
+        for (const auto &entry : std::filesystem::directory_iterator(directory)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".obj") {
+                paths.push_back(entry.path().string());
+            }
+        }
+    }
+    std::sort(paths.begin(), paths.end());  // same order, and so the same RSS growth, every run
+    return paths;
+}
+
+static bool writeJson(const std::string &path, const std::vector<ModelResult> &results, uint32_t repeats) {
+    std::ofstream file{path};
+    if (!file) {
+        return false;
+    }
+    // model paths are plain file names from models/, no escaping needed
+    file << "{\n  \"repeats\": " << repeats << ",\n  \"peak_rss_kb\": " << peakRssKb() << ",\n  \"models\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto &result = results[i];
+        file << (i == 0 ? "\n" : ",\n") << "    {\"path\": \"" << result.path << "\", \"file_bytes\": "
+             << result.fileBytes << ", \"vertices\": " << result.vertices << ", \"indices\": " << result.indices
+             << ", \"read_ms\": " << result.readMs << ", \"parse_ms\": " << result.parseMs
+             << ", \"weld_ms\": " << result.weldMs << ", \"staging_ms\": " << result.stagingMs
+             << ", \"copy_ms\": " << result.copyMs << ", \"load_allocations\": " << result.loadAllocations.allocations
+             << ", \"load_allocated_bytes\": " << result.loadAllocations.bytes
+             << ", \"upload_allocations\": " << result.uploadAllocations.allocations
+             << ", \"upload_allocated_bytes\": " << result.uploadAllocations.bytes
+             << ", \"peak_rss_kb\": " << result.peakRssKb << "}";
+    }
+    file << "\n  ]\n}\n";
+    return static_cast<bool>(file);
+}
+
+}  // namespace sve
+
+static void printUsage(const char *program) {
+    std::cerr << "usage: " << program << " [--repeats N] [--out FILE] [DIRECTORY...]\n"
+              << "  --repeats  loads per model, stage times are the median, default 3\n"
+              << "  --out      also write the results as JSON\n"
+              << "  DIRECTORY  where to look for .obj files, default models and models/geodesic\n";
+}
+
+int main(int argc, char **argv) {
+    uint32_t repeats = 3;
+    std::string outPath;
+    std::vector<std::string> directories;
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        try {
+            if (std::strcmp(argv[i], "--repeats") == 0 && hasValue) {
+                repeats = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else if (std::strcmp(argv[i], "--out") == 0 && hasValue) {
+                outPath = argv[++i];
+            } else if (argv[i][0] != '-') {
+                directories.push_back(argv[i]);
+            } else {
+                printUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } catch (const std::exception &) {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (repeats == 0) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (directories.empty()) {
+        directories = {"models", "models/geodesic"};
+    }
+
+    try {
+        sve::SveWindow window{64, 64, "asset benchmark", true};
+        sve::SveDevice device{window};
+
+        std::vector<sve::ModelResult> results;
+        std::cout << std::left << std::setw(48) << "model" << std::right << std::setw(10) << "vertices"
+                  << std::setw(10) << "read ms" << std::setw(10) << "parse ms" << std::setw(10) << "weld ms"
+                  << std::setw(12) << "staging ms" << std::setw(10) << "copy ms" << std::setw(10) << "allocs"
+                  << std::setw(12) << "peak rss kb" << std::endl;
+        sve::ModelResult total{};
+        for (const auto &path : sve::findModels(directories)) {
+            auto result = sve::benchmarkModel(device, path, repeats);
+            std::cout << std::left << std::setw(48) << result.path << std::right << std::setw(10) << result.vertices
+                      << std::fixed << std::setprecision(3) << std::setw(10) << result.readMs << std::setw(10)
+                      << result.parseMs << std::setw(10) << result.weldMs << std::setw(12) << result.stagingMs
+                      << std::setw(10) << result.copyMs << std::setw(10)
+                      << result.loadAllocations.allocations + result.uploadAllocations.allocations << std::setw(12)
+                      << result.peakRssKb << std::endl;
+            total.readMs += result.readMs;
+            total.parseMs += result.parseMs;
+            total.weldMs += result.weldMs;
+            total.stagingMs += result.stagingMs;
+            total.copyMs += result.copyMs;
+            results.push_back(std::move(result));
+        }
+        std::cout << results.size() << " models, read " << total.readMs << "ms, parse " << total.parseMs
+                  << "ms, weld " << total.weldMs << "ms, staging " << total.stagingMs << "ms, copy "
+                  << total.copyMs << "ms, peak rss " << sve::peakRssKb() << "kb" << std::endl;
+
+        if (!outPath.empty() && !sve::writeJson(outPath, results, repeats)) {
+            std::cerr << "failed to write results to " << outPath << std::endl;
+            return EXIT_FAILURE;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
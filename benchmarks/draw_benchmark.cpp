@@ -0,0 +1,810 @@
+// Draw call throughput: CPU cost of recording N object draws through the ways the engine could
+// submit them, from SimpleRenderSystem's push constants and per object binds to one multi draw
+// indirect call. Renders headless into a tiny target, so it runs on software drivers like lavapipe
+// and GPU work stays small. Build with `make draw_benchmark`, run from the repository root
+#include "sve_buffer.hpp"
+#include "sve_command_counters.hpp"
+#include "sve_descriptors.hpp"
+#include "sve_device.hpp"
+#include "sve_model.hpp"
+#include "sve_pipeline.hpp"
+#include "sve_window.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sve {
+
+enum class DrawVariant {
+    PushConstants,      // today's path: push the model matrix, bind the model's buffers, draw
+    SharedBuffer,       // all meshes in one buffer bound once, per draw offsets, transforms in a buffer
+    Instanced,          // one instanced draw per mesh
+    MultiDrawIndirect,  // one indirect call for all draws
+    SecondaryThreads,   // push constant path split over threads recording secondary command buffers
+};
+
+static const char *variantName(DrawVariant variant) {
+    switch (variant) {
+        case DrawVariant::PushConstants:
+            return "push constants";
+        case DrawVariant::SharedBuffer:
+            return "shared buffer";
+        case DrawVariant::Instanced:
+            return "instanced";
+        case DrawVariant::MultiDrawIndirect:
+            return "multi draw indirect";
+        case DrawVariant::SecondaryThreads:
+            return "secondary threads";
+    }
+    return "unknown";
+}
+
+// runs a job on every worker thread and waits for all of them, the threads stay alive between runs
+// so spawning them isn't part of the measurement
+class RecordingThreads {
+   public:
+    explicit RecordingThreads(uint32_t threadCount) {
+        for (uint32_t i = 0; i < threadCount; i++) {
+            threads.emplace_back([this, i] { work(i); });
+        }
+    }
+    ~RecordingThreads() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+    RecordingThreads(const RecordingThreads &) = delete;
+    RecordingThreads &operator=(const RecordingThreads &) = delete;
+
+    uint32_t size() const { return static_cast<uint32_t>(threads.size()); }
+
+    void run(const std::function<void(uint32_t)> &job) {
+        std::unique_lock<std::mutex> lock{mutex};
+        currentJob = &job;
+        remaining = size();
+        generation++;
+        wake.notify_all();
+        done.wait(lock, [this] { return remaining == 0; });
+        currentJob = nullptr;
+    }
+
+   private:
+    void work(uint32_t index) {
+        uint64_t seenGeneration = 0;
+        while (true) {
+            const std::function<void(uint32_t)> *job;
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+                wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+                if (stopping) {
+                    return;
+                }
+                seenGeneration = generation;
+                job = currentJob;
+            }
+            (*job)(index);
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                remaining--;
+            }
+            done.notify_one();
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(uint32_t)> *currentJob = nullptr;
+    uint64_t generation = 0;
+    uint32_t remaining = 0;
+    bool stopping = false;
+};
+
+class DrawBenchmark {
+   public:
+    static constexpr uint32_t TARGET_SIZE = 64;
+    static constexpr VkFormat TARGET_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+
+    struct Result {
+        DrawVariant variant;
+        uint32_t objects;
+        bool supported;
+        double recordMs;  // median over the repeats, CPU uploads of per draw data included
+        double nsPerDraw;
+        double drawsPerSecond;
+        double submitMs;  // submit until the GPU finished, median
+    };
+
+    DrawBenchmark(SveDevice &device, uint32_t maxObjects, uint32_t threadCount);
+    ~DrawBenchmark();
+
+    DrawBenchmark(const DrawBenchmark &) = delete;
+    DrawBenchmark &operator=(const DrawBenchmark &) = delete;
+
+    Result run(DrawVariant variant, uint32_t objectCount, uint32_t repeats);
+
+   private:
+    struct Mesh {
+        std::unique_ptr<SveModel> model;  // own buffers, for the push constant variants
+        uint32_t firstIndex;              // in the shared buffers
+        uint32_t indexCount;
+        int32_t vertexOffset;
+    };
+    struct PushConstantData {
+        glm::mat4 modelMatrix{1.f};
+        uint32_t useTransforms = 0;
+    };
+    struct ThreadRecorder {
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    };
+
+    void loadMeshes();
+    void createTarget();
+    void createRenderPass();
+    void createPipeline();
+    void createCommandBuffers();
+    void prepareObjects(uint32_t objectCount);
+
+    void record(DrawVariant variant, VkCommandBuffer commandBuffer);
+    void recordPushConstants(VkCommandBuffer commandBuffer, uint32_t first, uint32_t count);
+    void uploadTransforms();
+    void setViewport(VkCommandBuffer commandBuffer);
+    // first object of each mesh, objects are sorted by mesh
+    uint32_t meshStart(uint32_t mesh) const { return meshStarts[mesh]; }
+
+    SveDevice &sveDevice;
+    RecordingThreads recordingThreads;
+    uint32_t maxObjects;
+
+    std::vector<Mesh> meshes;
+    std::unique_ptr<SveBuffer> sharedVertexBuffer;
+    std::unique_ptr<SveBuffer> sharedIndexBuffer;
+
+    VkImage targetImage;
+    SveAllocation targetAllocation{};
+    VkImageView targetView;
+    VkRenderPass renderPass;
+    VkFramebuffer framebuffer;
+
+    SveDescriptorLayoutCache layoutCache{sveDevice};
+    std::shared_ptr<SveDescriptorSetLayout> transformSetLayout;
+    std::unique_ptr<SveDescriptorAllocator> descriptorAllocator;
+    VkDescriptorSet transformSet;
+    VkPipelineLayout pipelineLayout;
+    std::unique_ptr<SvePipeline> pipeline;
+
+    std::unique_ptr<SveBuffer> transformBuffer;  // host visible, rewritten every iteration
+    std::unique_ptr<SveBuffer> indirectBuffer;
+    std::vector<glm::mat4> transforms;  // the CPU side scene
+    uint32_t objectCount = 0;
+    std::vector<uint32_t> meshStarts;
+
+    VkCommandPool commandPool;
+    VkCommandBuffer primaryCommandBuffer;
+    VkFence fence;
+    std::vector<ThreadRecorder> threadRecorders;
+};
+
+DrawBenchmark::DrawBenchmark(SveDevice &device, uint32_t maxObjects, uint32_t threadCount)
+    : sveDevice{device}, recordingThreads{threadCount}, maxObjects{maxObjects} {
+    loadMeshes();
+    createTarget();
+    createRenderPass();
+    createPipeline();
+    createCommandBuffers();
+
+    transformBuffer = std::make_unique<SveBuffer>(
+        sveDevice,
+        sizeof(glm::mat4),
+        maxObjects,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    transformBuffer->map();
+    indirectBuffer = std::make_unique<SveBuffer>(
+        sveDevice,
+        sizeof(VkDrawIndexedIndirectCommand),
+        maxObjects,
+        VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    indirectBuffer->map();
+
+    auto transformInfo = transformBuffer->descriptorInfo();
+    if (!SveDescriptorWriter(*transformSetLayout, *descriptorAllocator)
+             .writeBuffer(0, &transformInfo)
+             .build(transformSet)) {
+        throw std::runtime_error("failed to allocate benchmark transform descriptor set!");
+    }
+}
+
+DrawBenchmark::~DrawBenchmark() {
+    vkDeviceWaitIdle(sveDevice.device());
+    for (auto &recorder : threadRecorders) {
+        vkDestroyCommandPool(sveDevice.device(), recorder.commandPool, nullptr);
+    }
+    vkDestroyFence(sveDevice.device(), fence, nullptr);
+    vkDestroyCommandPool(sveDevice.device(), commandPool, nullptr);
+    pipeline.reset();
+    vkDestroyPipelineLayout(sveDevice.device(), pipelineLayout, nullptr);
+    vkDestroyFramebuffer(sveDevice.device(), framebuffer, nullptr);
+    vkDestroyRenderPass(sveDevice.device(), renderPass, nullptr);
+    vkDestroyImageView(sveDevice.device(), targetView, nullptr);
+    sveDevice.destroyImage(targetImage, targetAllocation);
+}
+
+// low poly geodesic spheres, so the GPU side stays small next to the CPU recording cost
+void DrawBenchmark::loadMeshes() {
+    const std::vector<std::string> paths{
+        "models/geodesic/geodesic_classI_2.obj",
+        "models/geodesic/geodesic_classI_3.obj",
+        "models/geodesic/geodesic_classII_2_2.obj",
+        "models/geodesic/geodesic_classIII_3_1.obj"};
+
+    std::vector<SveModel::Vertex> vertices;
+    std::vector<uint32_t> indices;
+    for (const auto &path : paths) {
+        SveModel::Builder builder{};
+        builder.loadModel(path);
+        Mesh mesh{};
+        mesh.model = std::make_unique<SveModel>(sveDevice, builder);
+        mesh.firstIndex = static_cast<uint32_t>(indices.size());
+        mesh.indexCount = static_cast<uint32_t>(builder.indices.size());
+        mesh.vertexOffset = static_cast<int32_t>(vertices.size());
+        vertices.insert(vertices.end(), builder.vertices.begin(), builder.vertices.end());
+        indices.insert(indices.end(), builder.indices.begin(), builder.indices.end());
+        meshes.push_back(std::move(mesh));
+    }
+
+    auto upload = [&](const void *data, VkDeviceSize elementSize, uint32_t count, VkBufferUsageFlags usage) {
+        SveBuffer stagingBuffer{
+            sveDevice,
+            elementSize,
+            count,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+        stagingBuffer.map();
+        stagingBuffer.writeToBuffer(const_cast<void *>(data));
+        auto buffer = std::make_unique<SveBuffer>(
+            sveDevice,
+            elementSize,
+            count,
+            usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        sveDevice.copyBuffer(stagingBuffer.getBuffer(), buffer->getBuffer(), elementSize * count);
+        return buffer;
+    };
+    sharedVertexBuffer = upload(
+        vertices.data(),
+        sizeof(SveModel::Vertex),
+        static_cast<uint32_t>(vertices.size()),
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    sharedIndexBuffer = upload(
+        indices.data(),
+        sizeof(uint32_t),
+        static_cast<uint32_t>(indices.size()),
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+}
+
+void DrawBenchmark::createTarget() {
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = {TARGET_SIZE, TARGET_SIZE, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = TARGET_FORMAT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    sveDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, targetImage, targetAllocation);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = targetImage;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = TARGET_FORMAT;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.layerCount = 1;
+    if (vkCreateImageView(sveDevice.device(), &viewInfo, nullptr, &targetView) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create benchmark target view!");
+    }
+}
+
+void DrawBenchmark::createRenderPass() {
+    VkAttachmentDescription colorAttachment{};
+    colorAttachment.format = TARGET_FORMAT;
+    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference colorAttachmentRef{};
+    colorAttachmentRef.attachment = 0;
+    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorAttachmentRef;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &colorAttachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    if (vkCreateRenderPass(sveDevice.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create benchmark render pass!");
+    }
+
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = renderPass;
+    framebufferInfo.attachmentCount = 1;
+    framebufferInfo.pAttachments = &targetView;
+    framebufferInfo.width = TARGET_SIZE;
+    framebufferInfo.height = TARGET_SIZE;
+    framebufferInfo.layers = 1;
+    if (vkCreateFramebuffer(sveDevice.device(), &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create benchmark framebuffer!");
+    }
+}
+
+void DrawBenchmark::createPipeline() {
+    transformSetLayout = SveDescriptorSetLayout::Builder(sveDevice)
+                             .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+                             .build(layoutCache);
+    descriptorAllocator = SveDescriptorAllocator::Builder(sveDevice)
+                              .setSetsPerPool(1)
+                              .addPoolRatio(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.f)
+                              .build();
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.size = sizeof(PushConstantData);
+
+    VkDescriptorSetLayout setLayout = transformSetLayout->getDescriptorSetLayout();
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    if (vkCreatePipelineLayout(sveDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create benchmark pipeline layout!");
+    }
+
+    PipelineConfigInfo pipelineConfig{};
+    SvePipeline::defaultPipelineConfigInfo(pipelineConfig);
+    pipelineConfig.renderPass = renderPass;
+    pipelineConfig.pipelineLayout = pipelineLayout;
+    // the model's interleaved vertices, of which the shader only reads the position
+    pipelineConfig.attributeDescriptions.resize(1);
+    pipelineConfig.depthStencilInfo.depthTestEnable = VK_FALSE;
+    pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+    pipeline = std::make_unique<SvePipeline>(
+        sveDevice,
+        "shaders/draw_benchmark.vert.spv",
+        "shaders/draw_benchmark.frag.spv",
+        pipelineConfig);
+}
+
+void DrawBenchmark::createCommandBuffers() {
+    uint32_t graphicsFamily = sveDevice.findPhysicalQueueFamilies().graphicsFamily;
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = graphicsFamily;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandBufferCount = 1;
+
+    // pools are reset whole every iteration, the way per frame pools are
+    if (vkCreateCommandPool(sveDevice.device(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create benchmark command pool!");
+    }
+    allocInfo.commandPool = commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    if (vkAllocateCommandBuffers(sveDevice.device(), &allocInfo, &primaryCommandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate benchmark command buffer!");
+    }
+
+    // a pool per thread, command pools can't be used from two threads at once
+    threadRecorders.resize(recordingThreads.size());
+    for (auto &recorder : threadRecorders) {
+        if (vkCreateCommandPool(sveDevice.device(), &poolInfo, nullptr, &recorder.commandPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create benchmark thread command pool!");
+        }
+        allocInfo.commandPool = recorder.commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        if (vkAllocateCommandBuffers(sveDevice.device(), &allocInfo, &recorder.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate benchmark secondary command buffer!");
+        }
+    }
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    if (vkCreateFence(sveDevice.device(), &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create benchmark fence!");
+    }
+}
+
+// tiny spheres scattered over the target, the same scene for every variant at a given count
+void DrawBenchmark::prepareObjects(uint32_t count) {
+    objectCount = count;
+    transforms.resize(count);
+    std::mt19937 random{1234};
+    std::uniform_real_distribution<float> position{-.95f, .95f};
+    for (auto &transform : transforms) {
+        transform = glm::translate(glm::mat4{1.f}, {position(random), position(random), .5f});
+        transform = glm::scale(transform, glm::vec3{.01f});
+    }
+    // an even share of the objects per mesh
+    meshStarts.resize(meshes.size());
+    for (size_t mesh = 0; mesh < meshes.size(); mesh++) {
+        meshStarts[mesh] = static_cast<uint32_t>(static_cast<uint64_t>(count) * mesh / meshes.size());
+    }
+}
+
+void DrawBenchmark::setViewport(VkCommandBuffer commandBuffer) {
+    VkViewport viewport{0.f, 0.f, static_cast<float>(TARGET_SIZE), static_cast<float>(TARGET_SIZE), 0.f, 1.f};
+    VkRect2D scissor{{0, 0}, {TARGET_SIZE, TARGET_SIZE}};
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+void DrawBenchmark::uploadTransforms() {
+    std::memcpy(transformBuffer->getMappedMemory(), transforms.data(), sizeof(glm::mat4) * objectCount);
+}
+
+// objects [first, first + count) the way SimpleRenderSystem draws them
+void DrawBenchmark::recordPushConstants(VkCommandBuffer commandBuffer, uint32_t first, uint32_t count) {
+    pipeline->bind(commandBuffer);
+    setViewport(commandBuffer);
+    // not read on this path, but the shader references the set so it has to be bound
+    vkCmdBindDescriptorSets(
+        commandBuffer,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        pipelineLayout,
+        0,
+        1,
+        &transformSet,
+        0,
+        nullptr);
+    PushConstantData push{};
+    vkCmdPushConstants(
+        commandBuffer,
+        pipelineLayout,
+        VK_SHADER_STAGE_VERTEX_BIT,
+        0,
+        sizeof(PushConstantData),
+        &push);
+
+    uint32_t mesh = 0;
+    for (uint32_t i = first; i < first + count; i++) {
+        while (mesh + 1 < meshes.size() && i >= meshStart(mesh + 1)) {
+            mesh++;
+        }
+        vkCmdPushConstants(
+            commandBuffer,
+            pipelineLayout,
+            VK_SHADER_STAGE_VERTEX_BIT,
+            0,
+            sizeof(glm::mat4),
+            &transforms[i]);
+        meshes[mesh].model->bind(commandBuffer);
+        meshes[mesh].model->draw(commandBuffer);
+    }
+}
+
+void DrawBenchmark::record(DrawVariant variant, VkCommandBuffer commandBuffer) {
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    VkClearValue clearValue{};
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = renderPass;
+    renderPassInfo.framebuffer = framebuffer;
+    renderPassInfo.renderArea = {{0, 0}, {TARGET_SIZE, TARGET_SIZE}};
+    renderPassInfo.clearValueCount = 1;
+    renderPassInfo.pClearValues = &clearValue;
+
+    if (variant == DrawVariant::SecondaryThreads) {
+        // the workers record through the pipeline's and models' SveCommandCounters wrappers, whose
+        // state is single threaded. That is only safe while counting is off, which it always is here
+        assert(!SveCommandCounters::isEnabled() && "Command counters can't count multithreaded recording");
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        uint32_t threadCount = recordingThreads.size();
+        recordingThreads.run([&](uint32_t thread) {
+            auto &recorder = threadRecorders[thread];
+            vkResetCommandPool(sveDevice.device(), recorder.commandPool, 0);
+
+            VkCommandBufferInheritanceInfo inheritanceInfo{};
+            inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+            inheritanceInfo.renderPass = renderPass;
+            inheritanceInfo.subpass = 0;
+            inheritanceInfo.framebuffer = framebuffer;
+            VkCommandBufferBeginInfo secondaryBeginInfo{};
+            secondaryBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            secondaryBeginInfo.flags =
+                VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+            secondaryBeginInfo.pInheritanceInfo = &inheritanceInfo;
+            vkBeginCommandBuffer(recorder.commandBuffer, &secondaryBeginInfo);
+
+            uint32_t first = static_cast<uint32_t>(static_cast<uint64_t>(objectCount) * thread / threadCount);
+            uint32_t last = static_cast<uint32_t>(static_cast<uint64_t>(objectCount) * (thread + 1) / threadCount);
+            recordPushConstants(recorder.commandBuffer, first, last - first);
+            vkEndCommandBuffer(recorder.commandBuffer);
+        });
+        std::vector<VkCommandBuffer> secondaries;
+        for (const auto &recorder : threadRecorders) {
+            secondaries.push_back(recorder.commandBuffer);
+        }
+        vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+        vkCmdEndRenderPass(commandBuffer);
+        vkEndCommandBuffer(commandBuffer);
+        return;
+    }
+
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    if (variant == DrawVariant::PushConstants) {
+        recordPushConstants(commandBuffer, 0, objectCount);
+    } else {
+        // the per draw data lives in the transform buffer, indexed with the instance index
+        uploadTransforms();
+        pipeline->bind(commandBuffer);
+        setViewport(commandBuffer);
+        vkCmdBindDescriptorSets(
+            commandBuffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            pipelineLayout,
+            0,
+            1,
+            &transformSet,
+            0,
+            nullptr);
+        PushConstantData push{};
+        push.useTransforms = 1;
+        vkCmdPushConstants(
+            commandBuffer,
+            pipelineLayout,
+            VK_SHADER_STAGE_VERTEX_BIT,
+            0,
+            sizeof(PushConstantData),
+            &push);
+        VkBuffer vertexBuffers[] = {sharedVertexBuffer->getBuffer()};
+        VkDeviceSize offsets[] = {0};
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+        vkCmdBindIndexBuffer(commandBuffer, sharedIndexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+
+        if (variant == DrawVariant::SharedBuffer) {
+            uint32_t mesh = 0;
+            for (uint32_t i = 0; i < objectCount; i++) {
+                while (mesh + 1 < meshes.size() && i >= meshStart(mesh + 1)) {
+                    mesh++;
+                }
+                const auto &range = meshes[mesh];
+                vkCmdDrawIndexed(commandBuffer, range.indexCount, 1, range.firstIndex, range.vertexOffset, i);
+            }
+        } else if (variant == DrawVariant::Instanced) {
+            for (uint32_t mesh = 0; mesh < meshes.size(); mesh++) {
+                const auto &range = meshes[mesh];
+                uint32_t first = meshStart(mesh);
+                uint32_t count = (mesh + 1 < meshes.size() ? meshStart(mesh + 1) : objectCount) - first;
+                vkCmdDrawIndexed(commandBuffer, range.indexCount, count, range.firstIndex, range.vertexOffset, first);
+            }
+        } else {
+            // written by the CPU every frame here, a GPU culling pass would write them instead
+            auto *commands = static_cast<VkDrawIndexedIndirectCommand *>(indirectBuffer->getMappedMemory());
+            uint32_t mesh = 0;
+            for (uint32_t i = 0; i < objectCount; i++) {
+                while (mesh + 1 < meshes.size() && i >= meshStart(mesh + 1)) {
+                    mesh++;
+                }
+                const auto &range = meshes[mesh];
+                commands[i] = {range.indexCount, 1, range.firstIndex, range.vertexOffset, i};
+            }
+            uint32_t maxDrawCount = sveDevice.properties.limits.maxDrawIndirectCount;
+            for (uint32_t first = 0; first < objectCount; first += maxDrawCount) {
+                vkCmdDrawIndexedIndirect(
+                    commandBuffer,
+                    indirectBuffer->getBuffer(),
+                    first * sizeof(VkDrawIndexedIndirectCommand),
+                    std::min(maxDrawCount, objectCount - first),
+                    sizeof(VkDrawIndexedIndirectCommand));
+            }
+        }
+    }
+    vkCmdEndRenderPass(commandBuffer);
+    vkEndCommandBuffer(commandBuffer);
+}
+
+DrawBenchmark::Result DrawBenchmark::run(DrawVariant variant, uint32_t count, uint32_t repeats) {
+    assert(count <= maxObjects && "Object count above the benchmark's maximum");
+    Result result{variant, count, true, 0., 0., 0., 0.};
+    if (variant == DrawVariant::MultiDrawIndirect && !sveDevice.supportsMultiDrawIndirect()) {
+        result.supported = false;
+        return result;
+    }
+    if (objectCount != count) {
+        prepareObjects(count);
+    }
+
+    using Clock = std::chrono::steady_clock;
+    std::vector<double> recordMs;
+    std::vector<double> submitMs;
+    // the first iteration warms up driver allocations and caches, it isn't counted
+    for (uint32_t iteration = 0; iteration <= repeats; iteration++) {
+        vkResetCommandPool(sveDevice.device(), commandPool, 0);
+        auto recordStart = Clock::now();
+        record(variant, primaryCommandBuffer);
+        auto recordEnd = Clock::now();
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &primaryCommandBuffer;
+        if (vkQueueSubmit(sveDevice.graphicsQueue(), 1, &submitInfo, fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit benchmark command buffer!");
+        }
+        vkWaitForFences(sveDevice.device(), 1, &fence, VK_TRUE, UINT64_MAX);
+        vkResetFences(sveDevice.device(), 1, &fence);
+        auto submitEnd = Clock::now();
+
+        if (iteration > 0) {
+            recordMs.push_back(std::chrono::duration<double, std::milli>(recordEnd - recordStart).count());
+            submitMs.push_back(std::chrono::duration<double, std::milli>(submitEnd - recordEnd).count());
+        }
+    }
+
+    auto median = [](std::vector<double> &values) {
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    };
+    result.recordMs = median(recordMs);
+    result.submitMs = median(submitMs);
+    result.nsPerDraw = result.recordMs * 1e6 / count;
+    result.drawsPerSecond = count / (result.recordMs * 1e-3);
+    return result;
+}
+
+}  // namespace sve
+
+static void printUsage(const char *program) {
+    std::cerr << "usage: " << program << " [--counts N,N,...] [--threads N] [--repeats N] [--out FILE]\n"
+              << "  --counts   object counts to sweep, default 1000,10000,100000,1000000\n"
+              << "  --threads  recording threads of the secondary command buffer variant, default all cores\n"
+              << "  --repeats  measured iterations per variant and count, the median is reported, default 10\n"
+              << "  --out      also write the results as CSV\n";
+}
+
+int main(int argc, char **argv) {
+    std::vector<uint32_t> counts{1000, 10000, 100000, 1000000};
+    uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+    uint32_t repeats = 10;
+    std::string outPath;
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        try {
+            if (std::strcmp(argv[i], "--counts") == 0 && hasValue) {
+                counts.clear();
+                std::string list = argv[++i];
+                for (size_t start = 0; start < list.size();) {
+                    size_t end = std::min(list.find(',', start), list.size());
+                    counts.push_back(static_cast<uint32_t>(std::stoul(list.substr(start, end - start))));
+                    start = end + 1;
+                }
+            } else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) {
+                threadCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else if (std::strcmp(argv[i], "--repeats") == 0 && hasValue) {
+                repeats = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else if (std::strcmp(argv[i], "--out") == 0 && hasValue) {
+                outPath = argv[++i];
+            } else {
+                printUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } catch (const std::exception &) {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (counts.empty() || threadCount == 0 || repeats == 0 ||
+        std::find(counts.begin(), counts.end(), 0u) != counts.end()) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    try {
+        sve::SveWindow window{sve::DrawBenchmark::TARGET_SIZE, sve::DrawBenchmark::TARGET_SIZE, "draw benchmark", true};
+        sve::SveDevice device{window};
+        sve::DrawBenchmark benchmark{device, *std::max_element(counts.begin(), counts.end()), threadCount};
+
+        const sve::DrawVariant variants[] = {
+            sve::DrawVariant::PushConstants,
+            sve::DrawVariant::SharedBuffer,
+            sve::DrawVariant::Instanced,
+            sve::DrawVariant::MultiDrawIndirect,
+            sve::DrawVariant::SecondaryThreads};
+        std::vector<sve::DrawBenchmark::Result> results;
+        std::cout << std::left << std::setw(22) << "variant" << std::right << std::setw(10) << "objects"
+                  << std::setw(14) << "record ms" << std::setw(12) << "ns/draw" << std::setw(16) << "draws/s"
+                  << std::setw(14) << "submit ms" << std::endl;
+        for (uint32_t count : counts) {
+            for (auto variant : variants) {
+                auto result = benchmark.run(variant, count, repeats);
+                results.push_back(result);
+                std::cout << std::left << std::setw(22) << sve::variantName(variant) << std::right << std::setw(10)
+                          << count;
+                if (!result.supported) {
+                    std::cout << "  unsupported on this device" << std::endl;
+                    continue;
+                }
+                std::cout << std::fixed << std::setprecision(3) << std::setw(14) << result.recordMs
+                          << std::setprecision(1) << std::setw(12) << result.nsPerDraw << std::setprecision(0)
+                          << std::setw(16) << result.drawsPerSecond << std::setprecision(3) << std::setw(14)
+                          << result.submitMs << std::endl;
+            }
+        }
+
+        if (!outPath.empty()) {
+            std::ofstream file{outPath};
+            file << "variant,objects,threads,record_ms,ns_per_draw,draws_per_second,submit_ms\n";
+            for (const auto &result : results) {
+                if (!result.supported) continue;
+                file << sve::variantName(result.variant) << ',' << result.objects << ','
+                     << (result.variant == sve::DrawVariant::SecondaryThreads ? threadCount : 1) << ','
+                     << result.recordMs << ',' << result.nsPerDraw << ',' << result.drawsPerSecond << ','
+                     << result.submitMs << '\n';
+            }
+            if (!file) {
+                std::cerr << "failed to write results to " << outPath << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
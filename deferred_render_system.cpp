@@ -0,0 +1,188 @@
+#include "deferred_render_system.hpp"
+
+#include "sve_command_counters.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <cassert>
+#include <stdexcept>
+
+namespace sve {
+
+// same layout as SimpleRenderSystem, the geometry pass reuses simple_shader.vert
+struct GeometryPushConstantData {
+    glm::mat4 modelMatrix{1.f};
+    glm::mat4 normalMatrix{1.f};
+};
+
+struct LightingPushConstantData {
+    glm::mat4 inverseProjectionView{1.f};  // reconstructs world positions from depth
+};
+
+DeferredRenderSystem::DeferredRenderSystem(
+    SveDevice &device,
+    VkRenderPass deferredRenderPass,
+    VkDescriptorSetLayout globalSetLayout,
+    SveDescriptorLayoutCache &layoutCache)
+    : sveDevice{device} {
+    inputSetLayout = SveDescriptorSetLayout::Builder(sveDevice)
+                         .addBinding(0, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT)
+                         .addBinding(1, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT)
+                         .addBinding(2, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT)
+                         .build(layoutCache);
+    createPipelineLayouts(globalSetLayout);
+    createPipelines(deferredRenderPass);
+}
+
+DeferredRenderSystem::~DeferredRenderSystem() {
+    vkDestroyPipelineLayout(sveDevice.device(), geometryPipelineLayout, nullptr);
+    vkDestroyPipelineLayout(sveDevice.device(), lightingPipelineLayout, nullptr);
+}
+
+void DeferredRenderSystem::createPipelineLayouts(VkDescriptorSetLayout globalSetLayout) {
+    VkPushConstantRange geometryRange{};
+    geometryRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    geometryRange.size = sizeof(GeometryPushConstantData);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &globalSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &geometryRange;
+
+    if (vkCreatePipelineLayout(sveDevice.device(), &pipelineLayoutInfo, nullptr, &geometryPipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create geometry pipeline layout!");
+    }
+
+    VkPushConstantRange lightingRange{};
+    lightingRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    lightingRange.size = sizeof(LightingPushConstantData);
+
+    std::array<VkDescriptorSetLayout, 2> lightingSetLayouts{globalSetLayout, inputSetLayout->getDescriptorSetLayout()};
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(lightingSetLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = lightingSetLayouts.data();
+    pipelineLayoutInfo.pPushConstantRanges = &lightingRange;
+
+    if (vkCreatePipelineLayout(sveDevice.device(), &pipelineLayoutInfo, nullptr, &lightingPipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create lighting pipeline layout!");
+    }
+}
+
+void DeferredRenderSystem::createPipelines(VkRenderPass renderPass) {
+    assert(geometryPipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+
+    PipelineConfigInfo geometryConfig{};
+    SvePipeline::defaultPipelineConfigInfo(geometryConfig);
+    geometryConfig.renderPass = renderPass;
+    geometryConfig.pipelineLayout = geometryPipelineLayout;
+    geometryConfig.subpass = 0;
+    // albedo and normal targets
+    std::array<VkPipelineColorBlendAttachmentState, 2> blendAttachments{
+        geometryConfig.colorBlendAttachment,
+        geometryConfig.colorBlendAttachment};
+    geometryConfig.colorBlendInfo.attachmentCount = static_cast<uint32_t>(blendAttachments.size());
+    geometryConfig.colorBlendInfo.pAttachments = blendAttachments.data();
+    geometryPipeline = std::make_unique<SvePipeline>(
+        sveDevice,
+        "shaders/simple_shader.vert.spv",
+        "shaders/gbuffer.frag.spv",
+        geometryConfig);
+
+    PipelineConfigInfo lightingConfig{};
+    SvePipeline::defaultPipelineConfigInfo(lightingConfig);
+    lightingConfig.renderPass = renderPass;
+    lightingConfig.pipelineLayout = lightingPipelineLayout;
+    lightingConfig.subpass = 1;
+    lightingConfig.bindingDescriptions.clear();  // full screen triangle from gl_VertexIndex
+    lightingConfig.attributeDescriptions.clear();
+    lightingConfig.depthStencilInfo.depthTestEnable = VK_FALSE;
+    lightingConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+    lightingPipeline = std::make_unique<SvePipeline>(
+        sveDevice,
+        "shaders/deferred_lighting.vert.spv",
+        "shaders/deferred_lighting.frag.spv",
+        lightingConfig);
+}
+
+void DeferredRenderSystem::renderGeometry(FrameInfo &frameInfo) {
+    SveCommandScope commandScope{"deferred geometry"};
+    drawCount = 0;
+    SveCommandCounters::bindDescriptorSets(
+        frameInfo.commandBuffer,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        geometryPipelineLayout,
+        0,
+        1,
+        &frameInfo.globalDescriptorSet,
+        1,
+        &frameInfo.globalUboOffset);
+    geometryPipeline->bind(frameInfo.commandBuffer);
+
+    for (auto &kv : frameInfo.gameObjects) {
+        auto &obj = kv.second;
+        if (obj.model == nullptr) continue;
+        GeometryPushConstantData push{};
+        push.modelMatrix = obj.transform.mat4();
+        push.normalMatrix = obj.transform.normalMatrix();
+
+        SveCommandCounters::pushConstants(
+            frameInfo.commandBuffer,
+            geometryPipelineLayout,
+            VK_SHADER_STAGE_VERTEX_BIT,
+            0,
+            sizeof(GeometryPushConstantData),
+            &push);
+        obj.model->bind(frameInfo.commandBuffer);
+        obj.model->draw(frameInfo.commandBuffer);
+        drawCount++;
+    }
+}
+
+void DeferredRenderSystem::renderLighting(FrameInfo &frameInfo, const SveSwapChain::GBufferViews &gbuffer) {
+    SveCommandScope commandScope{"deferred lighting"};
+    // the views change with the swap chain image, so the set is rebuilt every frame from the
+    // frame allocator instead of kept per image and invalidated on resize
+    VkDescriptorImageInfo albedoInfo{VK_NULL_HANDLE, gbuffer.albedo, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    VkDescriptorImageInfo normalInfo{VK_NULL_HANDLE, gbuffer.normal, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    VkDescriptorImageInfo depthInfo{VK_NULL_HANDLE, gbuffer.depth, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+    VkDescriptorSet inputSet;
+    if (!SveDescriptorWriter(*inputSetLayout, frameInfo.frameDescriptorAllocator, &frameInfo.frameArena)
+             .writeImage(0, &albedoInfo)
+             .writeImage(1, &normalInfo)
+             .writeImage(2, &depthInfo)
+             .build(inputSet)) {
+        throw std::runtime_error("failed to allocate G-buffer descriptor set!");
+    }
+
+    VkDescriptorSet descriptorSets[] = {frameInfo.globalDescriptorSet, inputSet};
+    SveCommandCounters::bindDescriptorSets(
+        frameInfo.commandBuffer,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        lightingPipelineLayout,
+        0,
+        2,
+        descriptorSets,
+        1,
+        &frameInfo.globalUboOffset);
+    lightingPipeline->bind(frameInfo.commandBuffer);
+
+    LightingPushConstantData push{};
+    push.inverseProjectionView = glm::inverse(frameInfo.camera.getProjection() * frameInfo.camera.getView());
+    SveCommandCounters::pushConstants(
+        frameInfo.commandBuffer,
+        lightingPipelineLayout,
+        VK_SHADER_STAGE_FRAGMENT_BIT,
+        0,
+        sizeof(LightingPushConstantData),
+        &push);
+    SveCommandCounters::draw(frameInfo.commandBuffer, 3, 1, 0, 0);
+    drawCount++;
+}
+
+}  // namespace sve
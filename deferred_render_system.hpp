@@ -0,0 +1,51 @@
+#pragma once
+
+#include "sve_descriptors.hpp"
+#include "sve_device.hpp"
+#include "sve_frame_info.hpp"
+#include "sve_pipeline.hpp"
+#include "sve_swap_chain.hpp"
+
+// std
+#include <memory>
+
+namespace sve {
+
+// Deferred path through the renderer's two subpass render pass. renderGeometry fills the G-buffer
+// (albedo, packed normals, depth) in subpass 0, renderLighting shades a full screen triangle in
+// subpass 1 reading it back as input attachments, with the same clustered lights and shadows as
+// the forward path. Lighting cost no longer scales with overdraw, only with screen pixels
+class DeferredRenderSystem {
+   public:
+    DeferredRenderSystem(
+        SveDevice &device,
+        VkRenderPass deferredRenderPass,
+        VkDescriptorSetLayout globalSetLayout,
+        SveDescriptorLayoutCache &layoutCache);
+    ~DeferredRenderSystem();
+
+    DeferredRenderSystem(const DeferredRenderSystem &) = delete;
+    DeferredRenderSystem &operator=(const DeferredRenderSystem &) = delete;
+
+    void renderGeometry(FrameInfo &frameInfo);
+    // call after SveRenderer::nextSubpass
+    void renderLighting(FrameInfo &frameInfo, const SveSwapChain::GBufferViews &gbuffer);
+
+    // draws recorded by the last renderGeometry and renderLighting
+    uint32_t getDrawCountLastFrame() const { return drawCount; }
+
+   private:
+    void createPipelineLayouts(VkDescriptorSetLayout globalSetLayout);
+    void createPipelines(VkRenderPass renderPass);
+
+    SveDevice &sveDevice;
+
+    std::shared_ptr<SveDescriptorSetLayout> inputSetLayout;  // G-buffer input attachments, set 1
+    std::unique_ptr<SvePipeline> geometryPipeline;
+    std::unique_ptr<SvePipeline> lightingPipeline;
+    VkPipelineLayout geometryPipelineLayout;
+    VkPipelineLayout lightingPipelineLayout;
+    uint32_t drawCount = 0;
+};
+
+}  // namespace sve
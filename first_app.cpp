@@ -1,9 +1,22 @@
 #include "first_app.hpp"
 
+#include "deferred_render_system.hpp"
 #include "keyboard_movement_controller.hpp"
+#include "light_culling_system.hpp"
+#include "shadow_render_system.hpp"
 #include "simple_render_system.hpp"
 #include "sve_buffer.hpp"
 #include "sve_camera.hpp"
+#include "sve_command_counters.hpp"
+#include "sve_allocation_tracker.hpp"
+#include "sve_cpu_profiler.hpp"
+#include "sve_defragmenter.hpp"
+#include "sve_frame_limiter.hpp"
+#include "sve_gpu_profiler.hpp"
+#include "sve_memory_budget.hpp"
+#include "sve_render_graph.hpp"
+#include "sve_resolution_controller.hpp"
+#include "upscale_render_system.hpp"
 
 // libs
 #define GLM_FORCE_RADIANS
@@ -12,56 +25,168 @@
 #include <glm/gtc/constants.hpp>  // for PI
 
 // std
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <chrono>
+#include <iostream>
 #include <stdexcept>
+#include <unordered_map>
 
 namespace sve {
 
-struct GlobalUbo {
-    glm::mat4 projectionView{1.f};
-    glm::vec4 ambientColor{1.f, 1.f, 1.f, .02f};
-    glm::vec3 lightPosition{-1.f};
-    alignas(16) glm::vec4 lightColor{1.f};  // w is intensity, alignment for padding against vec3
-};
-
-FirstApp::FirstApp() {
-    globalPool = SveDescriptorPool::Builder(sveDevice)
-                     .setMaxSets(SveSwapChain::MAX_FRAMES_IN_FLIGHT)
-                     .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SveSwapChain::MAX_FRAMES_IN_FLIGHT)
-                     .build();
-    loadGameObjects();
+// device local heaps against their budget, then what our allocations hold per category
+static void printMemoryUsage(SveDevice &device, const SveMemoryBudget &memoryBudget) {
+    const auto &budgets = memoryBudget.getHeapBudgets();
+    std::cout << "memory" << (device.supportsMemoryBudget() ? "" : " (estimated budget)") << ":";
+    for (uint32_t i = 0; i < budgets.size(); i++) {
+        if (budgets[i].deviceLocal) {
+            std::cout << " heap " << i << " " << (budgets[i].usage >> 20) << "/" << (budgets[i].budget >> 20)
+                      << " MiB (" << SveMemoryBudget::levelName(memoryBudget.getLevel(i)) << ")";
+        }
+    }
+    auto categories = device.allocator().getCategoryStats();
+    for (uint32_t i = 0; i < SveMemoryAllocator::CATEGORY_COUNT; i++) {
+        if (categories[i].allocationCount > 0) {
+            std::cout << ", " << SveMemoryAllocator::categoryName(static_cast<SveMemoryCategory>(i)) << " "
+                      << (categories[i].allocatedBytes >> 10) << " KiB";
+        }
+    }
+    std::cout << std::endl;
+}
+
+// the last frame's calls per category and render system, redundant ones in parentheses
+static void printCommandCounts() {
+    auto printCounts = [](const char *name, const SveCommandCounters::Counts &counts) {
+        std::cout << "  " << name << ":";
+        for (uint32_t i = 0; i < SveCommandCounters::CATEGORY_COUNT; i++) {
+            if (counts.calls[i] == 0) continue;
+            std::cout << " " << SveCommandCounters::categoryName(static_cast<SveCommandCounters::Category>(i))
+                      << " " << counts.calls[i];
+            if (counts.redundant[i] > 0) {
+                std::cout << " (" << counts.redundant[i] << " redundant)";
+            }
+        }
+        std::cout << std::endl;
+    };
+    std::cout << "commands last frame" << std::endl;
+    printCounts("total", SveCommandCounters::getLastFrameTotal());
+    for (const auto &scope : SveCommandCounters::getLastFrame()) {
+        const auto &calls = scope.counts.calls;
+        if (std::any_of(calls.begin(), calls.end(), [](uint32_t count) { return count > 0; })) {
+            printCounts(scope.name, scope.counts);
+        }
+    }
+}
+
+static const char *presentModeName(VkPresentModeKHR mode) {
+    switch (mode) {
+        case VK_PRESENT_MODE_IMMEDIATE_KHR:
+            return "immediate";
+        case VK_PRESENT_MODE_MAILBOX_KHR:
+            return "mailbox";
+        case VK_PRESENT_MODE_FIFO_KHR:
+            return "fifo";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+            return "fifo relaxed";
+        default:
+            return "other";
+    }
+}
+
+FirstApp::FirstApp(const AppOptions &options) : options{options} {
+    globalAllocator = SveDescriptorAllocator::Builder(sveDevice)
+                          .setSetsPerPool(SveSwapChain::MAX_FRAMES_IN_FLIGHT)
+                          .addPoolRatio(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.f)
+                          .addPoolRatio(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3.f)
+                          .addPoolRatio(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.f)
+                          .build();
+
+    // transient sets for a single frame, dropped wholesale once that frame slot comes around again
+    frameAllocators.resize(SveSwapChain::MAX_FRAMES_IN_FLIGHT);
+    for (auto &allocator : frameAllocators) {
+        allocator = SveDescriptorAllocator::Builder(sveDevice)
+                        .addPoolRatio(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.f)
+                        .addPoolRatio(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.f)
+                        .addPoolRatio(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.f)
+                        .addPoolRatio(VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 3.f)
+                        .build();
+    }
+
+    uniformAllocator = std::make_unique<SveUniformAllocator>(sveDevice, SveSwapChain::MAX_FRAMES_IN_FLIGHT);
+    frameArena = std::make_unique<SveFrameArena>(SveSwapChain::MAX_FRAMES_IN_FLIGHT);
+
+    if (sveDevice.supportsBindless()) {
+        bindlessSet = std::make_unique<SveBindlessSet>(sveDevice);
+    }
+    if (options.benchmarkScript.empty()) {
+        loadGameObjects();
+    } else {
+        benchmark = std::make_unique<SveBenchmark>(options.benchmarkScript);
+        this->options.frameCount = benchmark->getTotalFrames();
+        loadBenchmarkScene();
+    }
 }
 
 FirstApp::~FirstApp() {}
 
 void FirstApp::run() {  // synchronization of frames
-    // ubo for each frame in flight
-    std::vector<std::unique_ptr<SveBuffer>> uboBuffers(SveSwapChain::MAX_FRAMES_IN_FLIGHT);
-    for (int i = 0; i < uboBuffers.size(); i++) {
-        uboBuffers[i] = std::make_unique<SveBuffer>(
-            sveDevice,
-            sizeof(GlobalUbo),
-            1,
-            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-        uboBuffers[i]->map();
-    }
+    SVE_PROFILE_THREAD("main");
+    LightCullingSystem lightCullingSystem{sveDevice, SveSwapChain::MAX_FRAMES_IN_FLIGHT};
+    ShadowRenderSystem shadowRenderSystem{sveDevice};
 
+    // ubo lives in the per-frame uniform allocator, bound through a dynamic offset
+    // bindings 1-3 are the clustered lights and 4 the cascaded shadow map, see shaders/lighting.glsl
     auto globalSetLayout = SveDescriptorSetLayout::Builder(sveDevice)
-                               .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
-                               .build();
+                               .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_ALL_GRAPHICS)
+                               .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+                               .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+                               .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+                               .addBinding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+                               .build(layoutCache);
 
     std::vector<VkDescriptorSet> globalDescriptorSets(SveSwapChain::MAX_FRAMES_IN_FLIGHT);
+    auto shadowMapInfo = shadowRenderSystem.descriptorInfo();
     for (int i = 0; i < globalDescriptorSets.size(); i++) {
-        auto bufferInfo = uboBuffers[i]->descriptorInfo();
-        SveDescriptorWriter(*globalSetLayout, *globalPool)
+        auto bufferInfo = uniformAllocator->descriptorInfo(i, sizeof(GlobalUbo));
+        auto lightsInfo = lightCullingSystem.lightsDescriptorInfo(i);
+        auto clustersInfo = lightCullingSystem.clustersDescriptorInfo(i);
+        auto lightIndicesInfo = lightCullingSystem.lightIndicesDescriptorInfo(i);
+        SveDescriptorWriter(*globalSetLayout, *globalAllocator)
             .writeBuffer(0, &bufferInfo)
+            .writeBuffer(1, &lightsInfo)
+            .writeBuffer(2, &clustersInfo)
+            .writeBuffer(3, &lightIndicesInfo)
+            .writeImage(4, &shadowMapInfo)
             .build(globalDescriptorSets[i]);
     }
 
-    SimpleRenderSystem simpleRenderSystem{sveDevice, sveRenderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout()};
+    SimpleRenderSystem simpleRenderSystem{
+        sveDevice,
+        sveRenderer.getSwapChainRenderPass(),
+        globalSetLayout->getDescriptorSetLayout(),
+        bindlessSet ? bindlessSet->getDescriptorSetLayout() : VK_NULL_HANDLE};
+    simpleRenderSystem.setDepthPrepass(sceneSettings.depthPrepass);
+    DeferredRenderSystem deferredRenderSystem{
+        sveDevice,
+        sveRenderer.getDeferredRenderPass(),
+        globalSetLayout->getDescriptorSetLayout(),
+        layoutCache};
+    sveRenderer.setRenderPath(sceneSettings.renderPath);
+    sveRenderer.setFramesInFlight(sceneSettings.framesInFlight);
+    sveRenderer.setLatencyMode(sceneSettings.latencyMode);
+    sveRenderer.setPresentPolicy(sceneSettings.presentPolicy);
+    SveFrameLimiter frameLimiter{sceneSettings.targetFps};
+    SveDefragmenter defragmenter{sveDevice};
+    // forward path only, the deferred path's subpasses stay in the swap chain's render pass
+    SveRenderGraph renderGraph{sveDevice};
+    uint32_t renderGraphSwapChainGeneration = sveRenderer.getSwapChainGeneration();
+    SveGpuProfiler gpuProfiler{sveDevice};
+    renderGraph.setProfiler(&gpuProfiler);
+    UpscaleRenderSystem upscaleRenderSystem{sveDevice, sveRenderer.getSwapChainImageFormat(), layoutCache};
+    SveResolutionController resolutionController{sceneSettings.gpuBudgetMs, sceneSettings.minResolutionScale};
+    bool dynamicResolution = sceneSettings.dynamicResolution;
+    SveMemoryBudget memoryBudget{sveDevice, sceneSettings.memoryWarningFraction, sceneSettings.memoryCriticalFraction};
     SveCamera camera{};
 
     auto viewerObject = SveGameObject::createGameObject();
@@ -69,46 +194,342 @@ void FirstApp::run() {  // synchronization of frames
     KeyboardMovementController cameraController{};
 
     auto currentTime = std::chrono::high_resolution_clock::now();
+    float statsTimer = 0.f;
+    bool prepassKeyDown = false;
+    bool renderPathKeyDown = false;
+    bool framesInFlightKeyDown = false;
+    bool latencyModeKeyDown = false;
+    bool presentPolicyKeyDown = false;
+    bool dynamicResolutionKeyDown = false;
+    bool commandCountersKeyDown = false;
+    SveCommandCounters::setEnabled(options.commandCounters);
 
-    while (!sveWindow.shouldClose()) {
-        glfwPollEvents();
+    bool headless = sveWindow.isHeadless();
+    uint32_t framesRendered = 0;
+    auto runStart = std::chrono::steady_clock::now();
+
+    while (options.frameCount > 0 ? framesRendered < options.frameCount : !sveWindow.shouldClose()) {
+        SVE_PROFILE_SCOPE("frame");
+        SveAllocationTracker::beginFrame();
+        {
+            SVE_PROFILE_SCOPE("frame limiter");
+            frameLimiter.wait();
+        }
+        // wait for the GPU before sampling input, so the frame shows the freshest input possible
+        sveRenderer.waitForNextFrame();
+        // headless runs see no input, the view and settings stay as configured
+        if (!headless) {
+            SVE_PROFILE_SCOPE("input");
+            glfwPollEvents();
+        }
+        // scripted runs ignore input so every run renders the same frames
+        if (!headless && !benchmark) {
+            // P flips the depth pre-pass so fragment counts can be compared on the same view
+            bool prepassKey = glfwGetKey(sveWindow.getGLFWwindow(), GLFW_KEY_P) == GLFW_PRESS;
+            if (prepassKey && !prepassKeyDown) {
+                simpleRenderSystem.setDepthPrepass(!simpleRenderSystem.isDepthPrepassEnabled());
+            }
+            prepassKeyDown = prepassKey;
+
+            // G switches between the forward and deferred paths
+            bool renderPathKey = glfwGetKey(sveWindow.getGLFWwindow(), GLFW_KEY_G) == GLFW_PRESS;
+            if (renderPathKey && !renderPathKeyDown) {
+                sveRenderer.setRenderPath(
+                    sveRenderer.getRenderPath() == SveRenderPath::Forward ? SveRenderPath::Deferred
+                                                                          : SveRenderPath::Forward);
+            }
+            renderPathKeyDown = renderPathKey;
+
+            // F cycles through 1 to MAX_FRAMES_IN_FLIGHT frames in flight, L toggles low latency mode
+            bool framesInFlightKey = glfwGetKey(sveWindow.getGLFWwindow(), GLFW_KEY_F) == GLFW_PRESS;
+            if (framesInFlightKey && !framesInFlightKeyDown) {
+                sveRenderer.setFramesInFlight(sveRenderer.getFramesInFlight() % SveSwapChain::MAX_FRAMES_IN_FLIGHT + 1);
+            }
+            framesInFlightKeyDown = framesInFlightKey;
+            bool latencyModeKey = glfwGetKey(sveWindow.getGLFWwindow(), GLFW_KEY_L) == GLFW_PRESS;
+            if (latencyModeKey && !latencyModeKeyDown) {
+                sveRenderer.setLatencyMode(
+                    sveRenderer.getLatencyMode() == SveLatencyMode::Throughput ? SveLatencyMode::LowLatency
+                                                                              : SveLatencyMode::Throughput);
+            }
+            latencyModeKeyDown = latencyModeKey;
+
+            // V cycles the present policies
+            bool presentPolicyKey = glfwGetKey(sveWindow.getGLFWwindow(), GLFW_KEY_V) == GLFW_PRESS;
+            if (presentPolicyKey && !presentPolicyKeyDown) {
+                sveRenderer.setPresentPolicy(
+                    static_cast<SvePresentPolicy>((static_cast<int>(sveRenderer.getPresentPolicy()) + 1) % 4));
+            }
+            presentPolicyKeyDown = presentPolicyKey;
+
+            // R toggles dynamic resolution
+            bool dynamicResolutionKey = glfwGetKey(sveWindow.getGLFWwindow(), GLFW_KEY_R) == GLFW_PRESS;
+            if (dynamicResolutionKey && !dynamicResolutionKeyDown) {
+                dynamicResolution = !dynamicResolution;
+            }
+            dynamicResolutionKeyDown = dynamicResolutionKey;
+
+            // C toggles the command counters
+            bool commandCountersKey = glfwGetKey(sveWindow.getGLFWwindow(), GLFW_KEY_C) == GLFW_PRESS;
+            if (commandCountersKey && !commandCountersKeyDown) {
+                SveCommandCounters::setEnabled(!SveCommandCounters::isEnabled());
+            }
+            commandCountersKeyDown = commandCountersKey;
+        }
 
         auto newTime = std::chrono::high_resolution_clock::now();
         float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
         currentTime = newTime;
+        float wallFrameMs = frameTime * 1000.f;
+        if (benchmark) {
+            frameTime = benchmark->getTimestep();  // simulated, so the scene doesn't depend on the machine
+        }
 
         // frameTime = glm::min(frameTime, MAX_FRAME_TIME);
 
-        cameraController.moveInPlaneXZ(sveWindow.getGLFWwindow(), frameTime, viewerObject);
-        camera.setViewXYZ(viewerObject.transform.translation, viewerObject.transform.rotation);
+        {
+            SVE_PROFILE_SCOPE("camera update");
+            if (benchmark) {
+                benchmark->cameraAt(
+                    framesRendered,
+                    viewerObject.transform.translation,
+                    viewerObject.transform.rotation);
+            } else if (!headless) {
+                cameraController.moveInPlaneXZ(sveWindow.getGLFWwindow(), frameTime, viewerObject);
+            }
+            camera.setViewXYZ(viewerObject.transform.translation, viewerObject.transform.rotation);
 
-        float aspect = sveRenderer.getAspectRatio();  // prevent resize warping
-        camera.setPerspectiveProjection(glm::pi<float>() / 4.f, aspect, .1f, 100.f);
+            float aspect = sveRenderer.getAspectRatio();  // prevent resize warping
+            camera.setPerspectiveProjection(glm::pi<float>() / 4.f, aspect, .1f, 100.f);
+        }
 
         if (auto commandBuffer = sveRenderer.beginFrame()) {
             int frameIndex = sveRenderer.getFrameIndex();
+            // frame slot's fence has been waited on, its transient allocations can be recycled
+            frameAllocators[frameIndex]->resetPools();
+            uniformAllocator->beginFrame(frameIndex);
+            frameArena->beginFrame(frameIndex);
+            gpuProfiler.beginFrame(commandBuffer, frameIndex);
+
             FrameInfo frameInfo{
                 frameIndex,
                 frameTime,
                 commandBuffer,
                 camera,
                 globalDescriptorSets[frameIndex],
+                0,
+                bindlessSet ? bindlessSet->getDescriptorSet() : VK_NULL_HANDLE,
+                *frameAllocators[frameIndex],
+                *uniformAllocator,
+                *frameArena,
                 gameObjects};
 
+            // the forward path renders to the top left of a full size offscreen target, the
+            // deferred path's G-buffer lives in the swap chain's render pass and stays at full size
+            VkExtent2D extent = sveRenderer.getSwapChainExtent();
+            VkExtent2D renderExtent = extent;
+            if (dynamicResolution && sveRenderer.getRenderPath() == SveRenderPath::Forward) {
+                resolutionController.update(sveRenderer.getFrameTimings().gpuFrameMs);
+                renderExtent = resolutionController.scaledExtent(extent);
+            }
+
             // update
             GlobalUbo ubo{};
             ubo.projectionView = camera.getProjection() * camera.getView();
-            uboBuffers[frameIndex]->writeToBuffer(&ubo);
-            uboBuffers[frameIndex]->flush();  // manually flush memory due to indexed data
+            {
+                SVE_PROFILE_SCOPE("light culling");
+                lightCullingSystem.update(frameInfo, renderExtent, ubo);  // clusters are in render area pixels
+            }
+
+            // transfers and shadow passes have to be recorded outside the swap chain render pass
+            uint32_t relocationScope = gpuProfiler.beginScope(commandBuffer, "relocations");
+            defragmenter.recordRelocations(frameInfo);
+            gpuProfiler.endScope(commandBuffer, relocationScope);
+            uint32_t shadowScope = gpuProfiler.beginScope(commandBuffer, "shadows", true);
+            {
+                SVE_PROFILE_SCOPE("record shadows");
+                shadowRenderSystem.render(frameInfo, ubo);
+            }
+            gpuProfiler.endScope(commandBuffer, shadowScope);
+            {
+                SVE_PROFILE_SCOPE("write global ubo");
+                frameInfo.globalUboOffset = uniformAllocator->push(ubo);
+            }
 
             // render
-            sveRenderer.beginSwapChainRenderPass(commandBuffer);
-            simpleRenderSystem.renderGameObjects(frameInfo);
-            sveRenderer.endSwapChainRenderPass(commandBuffer);
+            if (sveRenderer.getRenderPath() == SveRenderPath::Deferred) {
+                // timing only, the renderer's fragment statistics query already spans both subpasses
+                // and pipeline statistics queries can't overlap
+                uint32_t deferredScope = gpuProfiler.beginScope(commandBuffer, "deferred");
+                sveRenderer.beginSwapChainRenderPass(commandBuffer);
+                deferredRenderSystem.renderGeometry(frameInfo);
+                sveRenderer.nextSubpass(commandBuffer);
+                deferredRenderSystem.renderLighting(frameInfo, sveRenderer.getGBufferViews());
+                sveRenderer.endSwapChainRenderPass(commandBuffer);
+                gpuProfiler.endScope(commandBuffer, deferredScope);
+            } else {
+                if (renderGraphSwapChainGeneration != sveRenderer.getSwapChainGeneration()) {
+                    renderGraphSwapChainGeneration = sveRenderer.getSwapChainGeneration();
+                    renderGraph.invalidate();
+                }
+                renderGraph.reset();
+                auto backbuffer = renderGraph.importImage(
+                    "backbuffer",
+                    sveRenderer.getCurrentSwapChainImage(),
+                    sveRenderer.getCurrentSwapChainImageView(),
+                    {sveRenderer.getSwapChainImageFormat(), extent},
+                    VK_IMAGE_LAYOUT_UNDEFINED,
+                    VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR,  // where the acquire semaphore is waited on
+                    sveRenderer.getSwapChainPresentLayout());
+                // without dynamic resolution the scene is drawn straight into the backbuffer.
+                // Otherwise it is allocated at full size once and only the render area follows the
+                // scale, so scale changes never reallocate or recompile the graph. The scene keeps the
+                // swap chain format so the pipelines built against the swap chain render pass stay
+                // compatible
+                auto sceneColor = backbuffer;
+                if (dynamicResolution) {
+                    VkFormat sceneFormat = sveRenderer.getSwapChainImageFormat();
+                    sceneColor = renderGraph.createImage("scene color", {sceneFormat, extent});
+                }
+                auto depth = renderGraph.createImage("depth", {sveRenderer.getSwapChainDepthFormat(), extent});
+                renderGraph
+                    .addPass(
+                        "forward",
+                        [&](VkCommandBuffer cmd) {
+                            sveRenderer.beginFragmentStatistics(cmd);
+                            simpleRenderSystem.renderGameObjects(frameInfo);
+                            sveRenderer.endFragmentStatistics(cmd);
+                        })
+                    .write(sceneColor, SveRenderGraph::Access::ColorAttachment)
+                    .write(depth, SveRenderGraph::Access::DepthAttachment)
+                    .clearColor(sceneColor, {{0.01f, 0.01f, 0.01f, 1.0f}})
+                    .clearDepth(depth, 1.0f)
+                    .setRenderArea(renderExtent);
+                if (dynamicResolution) {
+                    // at full scale it is a plain copy, sharpening would change the native image
+                    bool nativeScale = renderExtent.width == extent.width && renderExtent.height == extent.height;
+                    upscaleRenderSystem.setSharpness(nativeScale ? 0.f : sceneSettings.sharpness);
+                    renderGraph
+                        .addPass(
+                            "upscale",
+                            [&](VkCommandBuffer cmd) {
+                                uint32_t upscaleScope = gpuProfiler.beginScope(cmd, "upscale sharpen", true);
+                                upscaleRenderSystem.render(
+                                    frameInfo,
+                                    renderGraph.getImageView(sceneColor),
+                                    extent,
+                                    renderExtent,
+                                    extent);
+                                gpuProfiler.endScope(cmd, upscaleScope);
+                            })
+                        .read(sceneColor, SveRenderGraph::Access::FragmentSampled)
+                        .write(backbuffer, SveRenderGraph::Access::ColorAttachment);
+                }
+                SVE_PROFILE_SCOPE("record render graph");
+                renderGraph.execute(commandBuffer);
+            }
+
+            {
+                SVE_PROFILE_SCOPE("flush uniforms");
+                uniformAllocator->flush();  // render systems may have pushed blocks too
+            }
             sveRenderer.endFrame();
+            if (benchmark) {
+                const auto &timings = sveRenderer.getFrameTimings();
+                uint32_t drawCount = shadowRenderSystem.getDrawCountLastFrame() +
+                                     (sveRenderer.getRenderPath() == SveRenderPath::Forward
+                                          ? simpleRenderSystem.getDrawCountLastFrame() + (dynamicResolution ? 1 : 0)
+                                          : deferredRenderSystem.getDrawCountLastFrame());
+                benchmark->recordFrame(
+                    framesRendered,
+                    {wallFrameMs,
+                     timings.latestCpuFrameMs,
+                     timings.latestGpuFrameMs,
+                     drawCount,
+                     SveAllocationTracker::getCurrentFrame().allocations});
+            }
+            framesRendered++;
+        }
+
+        memoryBudget.update();
+
+        statsTimer += frameTime;
+        if (statsTimer >= 1.f) {
+            statsTimer = 0.f;
+            const auto &timings = sveRenderer.getFrameTimings();
+            std::cout << "frames in flight " << sveRenderer.getFramesInFlight()
+                      << (sveRenderer.getLatencyMode() == SveLatencyMode::LowLatency ? " (low latency)" : "")
+                      << ": cpu wait " << timings.cpuWaitMs << "ms, sleep " << timings.latencySleepMs
+                      << "ms, cpu " << timings.cpuFrameMs << "ms, gpu " << timings.gpuFrameMs << "ms, gpu idle "
+                      << timings.gpuIdleMs << "ms" << std::endl;
+            const auto &frameStats = frameLimiter.getStats();
+            std::cout << "present mode " << presentModeName(sveRenderer.getPresentMode()) << ", frame time "
+                      << frameStats.meanMs << "ms +- " << frameStats.stdDevMs << "ms (variance "
+                      << frameStats.varianceMs2 << ", " << frameStats.minMs << "-" << frameStats.maxMs << "ms)"
+                      << std::endl;
+            if (sveRenderer.getRenderPath() == SveRenderPath::Forward) {
+                std::cout << "resolution scale " << (dynamicResolution ? resolutionController.getScale() : 1.f)
+                          << (dynamicResolution ? "" : " (dynamic resolution off)") << ", gpu budget "
+                          << resolutionController.getGpuBudgetMs() << "ms" << std::endl;
+            }
+            if (gpuProfiler.isSupported()) {
+                std::cout << "gpu scopes:";
+                for (const auto &scope : gpuProfiler.getStats()) {
+                    std::cout << " " << scope.name << " " << scope.avgMs << "ms (p95 " << scope.p95Ms << ")";
+                }
+                std::cout << std::endl;
+            }
+            if (sveDevice.supportsPipelineStatistics() && sveRenderer.getRenderPath() == SveRenderPath::Forward) {
+                std::cout << "fragment invocations: " << sveRenderer.getFragmentInvocations()
+                          << " (depth pre-pass " << (simpleRenderSystem.isDepthPrepassEnabled() ? "on" : "off") << ")"
+                          << std::endl;
+            }
+            printMemoryUsage(sveDevice, memoryBudget);
+            // the frame before this one, which had no stats to print
+            auto heapAllocations = SveAllocationTracker::getLastFrame();
+            std::cout << "cpu heap allocations last frame: " << heapAllocations.allocations << " ("
+                      << heapAllocations.bytes << " bytes), frame arena " << frameArena->bytesUsed() << " of "
+                      << frameArena->getCapacity() << " bytes" << std::endl;
+            if (SveCommandCounters::isEnabled()) {
+                printCommandCounts();
+            }
         }
     }
     vkDeviceWaitIdle(sveDevice.device());
+
+    if (benchmark) {
+        std::string path = options.benchmarkOutputPath.empty() ? benchmark->getScript().name + ".json"
+                                                               : options.benchmarkOutputPath;
+        if (benchmark->writeJson(path, sveDevice.properties.deviceName, sveRenderer.getSwapChainExtent())) {
+            std::cout << "benchmark results written to " << path << std::endl;
+        } else {
+            std::cerr << "failed to write benchmark results to " << path << std::endl;
+        }
+    }
+    if (!options.cpuTracePath.empty()) {
+        if (!SveCpuProfiler::ENABLED) {
+            std::cerr << "CPU profiler not compiled in, rebuild with PROFILE=1 for a trace" << std::endl;
+        } else if (!SveCpuProfiler::writeChromeTrace(options.cpuTracePath)) {
+            std::cerr << "failed to write CPU trace to " << options.cpuTracePath << std::endl;
+        }
+    }
+    if (!options.gpuProfilePath.empty()) {
+        const auto &path = options.gpuProfilePath;
+        bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+        if (!(json ? gpuProfiler.writeJson(path) : gpuProfiler.writeCsv(path))) {
+            std::cerr << "failed to write GPU profile to " << path << std::endl;
+        }
+    }
+
+    if (options.frameCount > 0) {
+        float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - runStart).count();
+        const auto &frameStats = frameLimiter.getStats();
+        std::cout << framesRendered << " frames at " << sveRenderer.getSwapChainExtent().width << "x"
+                  << sveRenderer.getSwapChainExtent().height << (headless ? " (headless)" : "") << " in "
+                  << seconds << "s, " << framesRendered / seconds << " fps, frame time " << frameStats.meanMs
+                  << "ms +- " << frameStats.stdDevMs << "ms, gpu " << sveRenderer.getFrameTimings().gpuFrameMs
+                  << "ms" << std::endl;
+    }
 }
 
 void FirstApp::loadGameObjects() {
@@ -141,6 +562,71 @@ void FirstApp::loadGameObjects() {
     floor.transform.translation = {.5f, .5f, 0.f};
     floor.transform.scale = glm::vec3{3.f, 1.f, 3.f};
     gameObjects.emplace(floor.getId(), std::move(floor));
+
+    std::vector<glm::vec3> lightColors{
+        {1.f, .1f, .1f},
+        {.1f, .1f, 1.f},
+        {.1f, 1.f, .1f},
+        {1.f, 1.f, .1f},
+        {.1f, 1.f, 1.f},
+        {1.f, 1.f, 1.f},
+    };
+    for (int i = 0; i < lightColors.size(); i++) {
+        auto pointLight = SveGameObject::makePointLight(.5f, 4.f, lightColors[i]);
+        auto rotateLight = glm::rotate(
+            glm::mat4(1.f),
+            (i * glm::two_pi<float>()) / lightColors.size(),
+            {0.f, -1.f, 0.f});
+        pointLight.transform.translation = glm::vec3(rotateLight * glm::vec4(-1.f, -1.f, -1.f, 1.f));
+        gameObjects.emplace(pointLight.getId(), std::move(pointLight));
+    }
+
+    // off by default: the vase and bunny only overlap the floor, and the extra geometry pass costs
+    // more than the little overdraw it saves. Dense scenes turn it on, see bunny_grid.txt
+    sceneSettings.depthPrepass = false;
+}
+
+void FirstApp::loadBenchmarkScene() {
+    const auto &script = benchmark->getScript();
+    std::unordered_map<std::string, std::shared_ptr<SveModel>> models;  // instances share the model
+    for (const auto &spawn : script.spawns) {
+        auto &model = models[spawn.modelPath];
+        if (!model) {
+            model = SveModel::createModelFromFile(sveDevice, spawn.modelPath);
+        }
+        glm::vec3 gridSize = glm::vec3(spawn.count - glm::uvec3{1}) * spawn.spacing;
+        for (uint32_t x = 0; x < spawn.count.x; x++) {
+            for (uint32_t y = 0; y < spawn.count.y; y++) {
+                for (uint32_t z = 0; z < spawn.count.z; z++) {
+                    auto object = SveGameObject::createGameObject();
+                    object.model = model;
+                    object.transform.translation =
+                        spawn.origin - .5f * gridSize + glm::vec3{x, y, z} * spawn.spacing;
+                    object.transform.rotation = spawn.rotation;
+                    object.transform.scale = glm::vec3{spawn.scale};
+                    gameObjects.emplace(object.getId(), std::move(object));
+                }
+            }
+        }
+    }
+
+    // lights on a ring above the scene, cycling through the hues
+    for (uint32_t i = 0; i < script.lightCount; i++) {
+        float hue = static_cast<float>(i) / static_cast<float>(script.lightCount);
+        glm::vec3 color = glm::clamp(
+            glm::abs(glm::mod(hue * 6.f + glm::vec3{0.f, 4.f, 2.f}, 6.f) - 3.f) - 1.f,
+            glm::vec3{.1f},
+            glm::vec3{1.f});
+        auto pointLight = SveGameObject::makePointLight(.5f, 6.f, color);
+        float angle = hue * glm::two_pi<float>();
+        pointLight.transform.translation = {3.f * glm::cos(angle), -1.5f, 3.f * glm::sin(angle)};
+        gameObjects.emplace(pointLight.getId(), std::move(pointLight));
+    }
+
+    // timings have to be comparable between runs, so nothing adapts to the machine
+    sceneSettings.dynamicResolution = false;
+    sceneSettings.targetFps = 0.f;
+    sceneSettings.depthPrepass = script.depthPrepass;
 }
 
 }  // namespace sve
\ No newline at end of file
@@ -1,22 +1,46 @@
 #pragma once
 
+#include "sve_benchmark.hpp"
+#include "sve_bindless.hpp"
 #include "sve_descriptors.hpp"
 #include "sve_device.hpp"
+#include "sve_frame_arena.hpp"
 #include "sve_game_object.hpp"
 #include "sve_renderer.hpp"
+#include "sve_uniform_allocator.hpp"
 #include "sve_window.hpp"
 
 // std
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace sve {
+
+// from the command line, see main.cpp
+struct AppOptions {
+    static constexpr uint32_t HEADLESS_DEFAULT_FRAMES = 600;
+
+    int width = 800;
+    int height = 600;
+    // no window or display needed, renders into offscreen images. Input is ignored
+    bool headless = false;
+    // frames to render before exiting, 0 to run until the window is closed
+    uint32_t frameCount = 0;
+    // GPU profiler results are written here on exit, as JSON for a .json path and CSV otherwise
+    std::string gpuProfilePath;
+    // Chrome trace of the CPU zones, needs a build with SVE_ENABLE_PROFILER
+    std::string cpuTracePath;
+    // per frame command counts in the stats output, also toggled with C at runtime
+    bool commandCounters = false;
+    // scripted benchmark, replaces the scene and input and runs the script's frames
+    std::string benchmarkScript;
+    std::string benchmarkOutputPath;  // JSON results, <script name>.json when empty
+};
+
 class FirstApp {
    public:
-    static constexpr int WIDTH = 800;
-    static constexpr int HEIGHT = 600;
-
-    FirstApp();
+    explicit FirstApp(const AppOptions &options = AppOptions{});
     ~FirstApp();
 
     FirstApp(const FirstApp &) = delete;
@@ -26,14 +50,43 @@ class FirstApp {
 
    private:
     void loadGameObjects();
+    void loadBenchmarkScene();
 
-    SveWindow sveWindow{WIDTH, HEIGHT, "Soliloquy"};
+    AppOptions options;
+    SveWindow sveWindow{options.width, options.height, "Soliloquy", options.headless};
     SveDevice sveDevice{sveWindow};
     SveRenderer sveRenderer{sveWindow, sveDevice};
 
     // note: order of declarations matters
-    std::unique_ptr<SveDescriptorPool> globalPool{};
+    SveDescriptorLayoutCache layoutCache{sveDevice};
+    std::unique_ptr<SveDescriptorAllocator> globalAllocator{};
+    std::vector<std::unique_ptr<SveDescriptorAllocator>> frameAllocators;  // reset every frame
+    std::unique_ptr<SveBindlessSet> bindlessSet{};                          // null without descriptor indexing
+    std::unique_ptr<SveUniformAllocator> uniformAllocator{};
+    std::unique_ptr<SveFrameArena> frameArena{};
     SveGameObject::Map gameObjects;
+    std::unique_ptr<SveBenchmark> benchmark{};  // null unless running a benchmark script
+
+    // per scene render settings, set up alongside the game objects
+    struct SceneSettings {
+        bool depthPrepass = false;  // forward path only
+        SveRenderPath renderPath = SveRenderPath::Forward;
+        uint32_t framesInFlight = 2;  // up to SveSwapChain::MAX_FRAMES_IN_FLIGHT
+        SveLatencyMode latencyMode = SveLatencyMode::Throughput;
+        SvePresentPolicy presentPolicy = SvePresentPolicy::Throughput;
+        float targetFps = 0.f;  // CPU frame limiter, 0 for unlimited
+        // forward path only: the scene is rendered at a scale that keeps the GPU frame time within
+        // gpuBudgetMs, then upscaled and sharpened into the swap chain image. Off unless a scene
+        // opts in, R toggles it at runtime
+        bool dynamicResolution = false;
+        float gpuBudgetMs = 14.f;
+        float minResolutionScale = .5f;
+        float sharpness = .5f;
+        // fractions of a memory heap's budget where SveMemoryBudget reports warning and critical
+        float memoryWarningFraction = .8f;
+        float memoryCriticalFraction = .95f;
+    };
+    SceneSettings sceneSettings{};
 };
 
 }  // namespace sve
\ No newline at end of file
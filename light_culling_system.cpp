@@ -0,0 +1,211 @@
+#include "light_culling_system.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace sve {
+
+LightCullingSystem::LightCullingSystem(SveDevice &device, int framesInFlight) : sveDevice{device} {
+    frames.resize(framesInFlight);
+    for (auto &frame : frames) {
+        frame.lights = std::make_unique<SveBuffer>(
+            sveDevice,
+            sizeof(GpuPointLight),
+            MAX_LIGHTS,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        frame.clusters = std::make_unique<SveBuffer>(
+            sveDevice,
+            sizeof(GpuCluster),
+            CLUSTER_COUNT,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        frame.lightIndices = std::make_unique<SveBuffer>(
+            sveDevice,
+            sizeof(uint32_t),
+            MAX_LIGHT_INDICES,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        frame.lights->map();
+        frame.clusters->map();
+        frame.lightIndices->map();
+    }
+
+    posX.reserve(MAX_LIGHTS);
+    posY.reserve(MAX_LIGHTS);
+    posZ.reserve(MAX_LIGHTS);
+    ranges.reserve(MAX_LIGHTS);
+    bounds.reserve(MAX_LIGHTS);
+    visible.reserve(MAX_LIGHTS);
+    clusterCounts.resize(CLUSTER_COUNT);
+}
+
+LightCullingSystem::~LightCullingSystem() {}
+
+void LightCullingSystem::update(FrameInfo &frameInfo, VkExtent2D extent, GlobalUbo &ubo) {
+    auto &frame = frames[frameInfo.framIndex];
+    auto *gpuLights = static_cast<GpuPointLight *>(frame.lights->getMappedMemory());
+    auto *gpuClusters = static_cast<GpuCluster *>(frame.clusters->getMappedMemory());
+    auto *gpuIndices = static_cast<uint32_t *>(frame.lightIndices->getMappedMemory());
+
+    // gather
+    posX.clear();
+    posY.clear();
+    posZ.clear();
+    ranges.clear();
+    for (auto &kv : frameInfo.gameObjects) {
+        auto &obj = kv.second;
+        if (obj.pointLight == nullptr) continue;
+        if (posX.size() >= MAX_LIGHTS) {
+            // the light buffers are sized for MAX_LIGHTS, anything past that is left unlit
+            if (!warnedLightOverflow) {
+                std::cerr << "more than " << MAX_LIGHTS << " point lights, skipping the rest" << std::endl;
+                warnedLightOverflow = true;
+            }
+            break;
+        }
+
+        uint32_t index = static_cast<uint32_t>(posX.size());
+        gpuLights[index].position = glm::vec4(obj.transform.translation, obj.pointLight->range);
+        gpuLights[index].color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
+        posX.push_back(obj.transform.translation.x);
+        posY.push_back(obj.transform.translation.y);
+        posZ.push_back(obj.transform.translation.z);
+        ranges.push_back(obj.pointLight->range);
+    }
+    lightCount = static_cast<uint32_t>(posX.size());
+
+    // to view space
+    const glm::mat4 &view = frameInfo.camera.getView();
+    for (uint32_t i = 0; i < lightCount; i++) {
+        float x = posX[i], y = posY[i], z = posZ[i];
+        posX[i] = view[0][0] * x + view[1][0] * y + view[2][0] * z + view[3][0];
+        posY[i] = view[0][1] * x + view[1][1] * y + view[2][1] * z + view[3][1];
+        posZ[i] = view[0][2] * x + view[1][2] * y + view[2][2] * z + view[3][2];
+    }
+
+    computeBounds(frameInfo.camera);
+
+    // count lights per cluster, then prefix sum into offsets
+    std::fill(clusterCounts.begin(), clusterCounts.end(), 0);
+    for (uint32_t i = 0; i < lightCount; i++) {
+        if (!visible[i]) continue;
+        const auto &b = bounds[i];
+        for (uint32_t z = b.minZ; z <= b.maxZ; z++) {
+            for (uint32_t y = b.minY; y <= b.maxY; y++) {
+                uint32_t row = (z * CLUSTER_Y + y) * CLUSTER_X;
+                for (uint32_t x = b.minX; x <= b.maxX; x++) {
+                    clusterCounts[row + x]++;
+                }
+            }
+        }
+    }
+
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < CLUSTER_COUNT; i++) {
+        // past the index list capacity clusters keep whatever fits, dropping their last lights
+        uint32_t count = std::min(clusterCounts[i], MAX_LIGHT_INDICES - offset);
+        gpuClusters[i] = {offset, count};
+        clusterCounts[i] = 0;  // reused as the fill cursor
+        offset += count;
+    }
+    lightIndexCount = offset;
+
+    for (uint32_t i = 0; i < lightCount; i++) {
+        if (!visible[i]) continue;
+        const auto &b = bounds[i];
+        for (uint32_t z = b.minZ; z <= b.maxZ; z++) {
+            for (uint32_t y = b.minY; y <= b.maxY; y++) {
+                uint32_t row = (z * CLUSTER_Y + y) * CLUSTER_X;
+                for (uint32_t x = b.minX; x <= b.maxX; x++) {
+                    auto &cluster = gpuClusters[row + x];
+                    uint32_t &cursor = clusterCounts[row + x];
+                    if (cursor < cluster.count) {
+                        gpuIndices[cluster.offset + cursor++] = i;
+                    }
+                }
+            }
+        }
+    }
+
+    if (lightCount > 0) {
+        frame.lights->flush(lightCount * sizeof(GpuPointLight));
+    }
+    frame.clusters->flush();
+    frame.lightIndices->flush(std::max<VkDeviceSize>(lightIndexCount, 1) * sizeof(uint32_t));
+
+    ubo.clusterGrid = glm::uvec4{CLUSTER_X, CLUSTER_Y, CLUSTER_Z, lightCount};
+    ubo.clusterParams = glm::vec4{
+        frameInfo.camera.getNear(),
+        frameInfo.camera.getFar(),
+        static_cast<float>(extent.width),
+        static_cast<float>(extent.height)};
+}
+
+// Conservative cluster range of each light's bounding sphere. Depth slices are exponential,
+// slice = log(z / near) / log(far / near) * CLUSTER_Z, which keeps clusters roughly cubic. Screen
+// bounds come from projecting the corners of the sphere's view space box: x / z is monotonic in
+// both x and z, so the extremes are at the corners
+void LightCullingSystem::computeBounds(const SveCamera &camera) {
+    const glm::mat4 &projection = camera.getProjection();
+    const float near = camera.getNear();
+    const float far = camera.getFar();
+    const float sliceScale = static_cast<float>(CLUSTER_Z) / std::log(far / near);
+
+    auto slice = [&](float z) {
+        float s = std::floor(std::log(z / near) * sliceScale);
+        return static_cast<uint32_t>(std::clamp(s, 0.f, static_cast<float>(CLUSTER_Z - 1)));
+    };
+    auto tile = [](float ndc, uint32_t count) {
+        float t = std::floor((ndc * .5f + .5f) * static_cast<float>(count));
+        return static_cast<uint32_t>(std::clamp(t, 0.f, static_cast<float>(count - 1)));
+    };
+
+    bounds.resize(lightCount);
+    visible.resize(lightCount);
+    for (uint32_t i = 0; i < lightCount; i++) {
+        float r = ranges[i];
+        float zMin = posZ[i] - r;
+        float zMax = posZ[i] + r;
+        if (zMax < near || zMin > far) {
+            visible[i] = 0;
+            continue;
+        }
+        zMin = std::max(zMin, near);
+        zMax = std::min(zMax, far);
+
+        constexpr float inf = std::numeric_limits<float>::infinity();
+        float ndcMinX = inf, ndcMaxX = -inf, ndcMinY = inf, ndcMaxY = -inf;
+        for (float z : {zMin, zMax}) {
+            for (float dx : {-r, r}) {
+                float ndc = projection[0][0] * (posX[i] + dx) / z;
+                ndcMinX = std::min(ndcMinX, ndc);
+                ndcMaxX = std::max(ndcMaxX, ndc);
+            }
+            for (float dy : {-r, r}) {
+                float ndc = projection[1][1] * (posY[i] + dy) / z;
+                ndcMinY = std::min(ndcMinY, ndc);
+                ndcMaxY = std::max(ndcMaxY, ndc);
+            }
+        }
+        if (ndcMaxX < -1.f || ndcMinX > 1.f || ndcMaxY < -1.f || ndcMinY > 1.f) {
+            visible[i] = 0;
+            continue;
+        }
+
+        visible[i] = 1;
+        bounds[i] = {
+            tile(ndcMinX, CLUSTER_X),
+            tile(ndcMaxX, CLUSTER_X),
+            tile(ndcMinY, CLUSTER_Y),
+            tile(ndcMaxY, CLUSTER_Y),
+            slice(zMin),
+            slice(zMax),
+        };
+    }
+}
+
+}  // namespace sve
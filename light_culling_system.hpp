@@ -0,0 +1,79 @@
+#pragma once
+
+#include "sve_buffer.hpp"
+#include "sve_device.hpp"
+#include "sve_frame_info.hpp"
+
+// std
+#include <memory>
+#include <vector>
+
+namespace sve {
+
+// Clustered light culling. The view frustum is split into a CLUSTER_X * CLUSTER_Y screen tiles by
+// CLUSTER_Z exponential depth slices, every point light is assigned to the clusters its range
+// touches, and the fragment shader only loops over the lights of its own cluster (see
+// shaders/lighting.glsl). Binning runs on the CPU over structure-of-arrays light data, each light
+// only visits the clusters inside its screen/depth bounds so the cost is lights * touched clusters
+class LightCullingSystem {
+   public:
+    static constexpr uint32_t CLUSTER_X = 16;
+    static constexpr uint32_t CLUSTER_Y = 9;
+    static constexpr uint32_t CLUSTER_Z = 24;
+    static constexpr uint32_t CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+    static constexpr uint32_t MAX_LIGHTS = 1024;
+    static constexpr uint32_t MAX_LIGHT_INDICES = CLUSTER_COUNT * 32;
+
+    // std430 layouts, match shaders/lighting.glsl
+    struct GpuPointLight {
+        glm::vec4 position{};  // world space, w is range
+        glm::vec4 color{};     // w is intensity
+    };
+    struct GpuCluster {
+        uint32_t offset;  // into the light index list
+        uint32_t count;
+    };
+
+    LightCullingSystem(SveDevice &device, int framesInFlight);
+    ~LightCullingSystem();
+
+    LightCullingSystem(const LightCullingSystem &) = delete;
+    LightCullingSystem &operator=(const LightCullingSystem &) = delete;
+
+    // bins this frame's point lights and fills in the cluster fields of the ubo
+    void update(FrameInfo &frameInfo, VkExtent2D extent, GlobalUbo &ubo);
+
+    VkDescriptorBufferInfo lightsDescriptorInfo(int frameIndex) { return frames[frameIndex].lights->descriptorInfo(); }
+    VkDescriptorBufferInfo clustersDescriptorInfo(int frameIndex) { return frames[frameIndex].clusters->descriptorInfo(); }
+    VkDescriptorBufferInfo lightIndicesDescriptorInfo(int frameIndex) { return frames[frameIndex].lightIndices->descriptorInfo(); }
+
+    uint32_t getLightCount() const { return lightCount; }
+    uint32_t getLightIndexCount() const { return lightIndexCount; }
+
+   private:
+    struct ClusterBounds {
+        uint32_t minX, maxX, minY, maxY, minZ, maxZ;
+    };
+    struct FrameBuffers {
+        std::unique_ptr<SveBuffer> lights;
+        std::unique_ptr<SveBuffer> clusters;
+        std::unique_ptr<SveBuffer> lightIndices;
+    };
+
+    void computeBounds(const SveCamera &camera);
+
+    SveDevice &sveDevice;
+    std::vector<FrameBuffers> frames;
+
+    // view space light data, structure of arrays so the compiler can auto-vectorize the transform loop
+    std::vector<float> posX, posY, posZ, ranges;
+    std::vector<ClusterBounds> bounds;
+    std::vector<uint8_t> visible;
+    std::vector<uint32_t> clusterCounts;
+
+    uint32_t lightCount = 0;
+    uint32_t lightIndexCount = 0;
+    bool warnedLightOverflow = false;
+};
+
+}  // namespace sve
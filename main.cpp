@@ -2,13 +2,71 @@
 
 // std
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
+#include <string>
 
-int main() {
-    sve::FirstApp app{};
+static void printUsage(const char *program) {
+    std::cerr << "usage: " << program
+              << " [--headless] [--frames N] [--width W] [--height H] [--gpu-profile FILE] [--cpu-trace FILE]\n"
+              << "       [--command-counters] [--benchmark SCRIPT [--benchmark-out FILE]]\n"
+              << "  --headless  render offscreen without a window, e.g. on lavapipe or SwiftShader\n"
+              << "  --frames    exit after N frames, headless runs default to "
+              << sve::AppOptions::HEADLESS_DEFAULT_FRAMES << '\n'
+              << "  --width     resolution, the initial window size when not headless\n"
+              << "  --height\n"
+              << "  --gpu-profile  write GPU scope timings on exit, JSON for a .json file and CSV otherwise\n"
+              << "  --cpu-trace    write CPU zones as a Chrome trace on exit, needs a PROFILE=1 build\n"
+              << "  --command-counters  print per frame command counts by render system, C toggles them\n"
+              << "  --benchmark    play a scene and camera path script with a fixed timestep, see benchmarks/scripts\n"
+              << "  --benchmark-out  frame time percentiles as JSON, <script name>.json by default\n";
+}
+
+static bool parseOptions(int argc, char **argv, sve::AppOptions &options) {
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        try {
+            if (std::strcmp(argv[i], "--headless") == 0) {
+                options.headless = true;
+            } else if (std::strcmp(argv[i], "--frames") == 0 && hasValue) {
+                options.frameCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else if (std::strcmp(argv[i], "--width") == 0 && hasValue) {
+                options.width = std::stoi(argv[++i]);
+            } else if (std::strcmp(argv[i], "--height") == 0 && hasValue) {
+                options.height = std::stoi(argv[++i]);
+            } else if (std::strcmp(argv[i], "--gpu-profile") == 0 && hasValue) {
+                options.gpuProfilePath = argv[++i];
+            } else if (std::strcmp(argv[i], "--cpu-trace") == 0 && hasValue) {
+                options.cpuTracePath = argv[++i];
+            } else if (std::strcmp(argv[i], "--command-counters") == 0) {
+                options.commandCounters = true;
+            } else if (std::strcmp(argv[i], "--benchmark") == 0 && hasValue) {
+                options.benchmarkScript = argv[++i];
+            } else if (std::strcmp(argv[i], "--benchmark-out") == 0 && hasValue) {
+                options.benchmarkOutputPath = argv[++i];
+            } else {
+                return false;
+            }
+        } catch (const std::exception &) {
+            return false;  // not a number
+        }
+    }
+    if (options.headless && options.frameCount == 0) {
+        options.frameCount = sve::AppOptions::HEADLESS_DEFAULT_FRAMES;  // nothing to close
+    }
+    return options.width > 0 && options.height > 0;
+}
+
+int main(int argc, char **argv) {
+    sve::AppOptions options{};
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
 
     try {
+        sve::FirstApp app{options};  // a malformed benchmark script throws here
         app.run();
     } catch (const std::exception &e) {
         std::cerr << e.what() << '\n';
@@ -16,4 +74,4 @@ int main() {
     }
 
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -0,0 +1,11 @@
+// Bindless resource arrays, matches SveBindlessSet (set 1).
+// Include with #extension GL_GOOGLE_include_directive and index with the integer handed out when the
+// resource was registered, e.g. an index carried per instance:
+//   texture(sampler2D(bindlessTextures[nonuniformEXT(texIndex)], bindlessSamplers[samplerIndex]), uv)
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 1, binding = 0) uniform texture2D bindlessTextures[];
+layout(set = 1, binding = 1) uniform sampler bindlessSamplers[];
+layout(set = 1, binding = 2) readonly buffer BindlessBuffer {
+    uint data[];
+} bindlessBuffers[];
@@ -0,0 +1,31 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+layout(location = 0) out vec4 outColor;
+
+#include "global_ubo.glsl"
+#include "lighting.glsl"
+
+// written by gbuffer.frag in the previous subpass, same pixel only
+layout(input_attachment_index = 0, set = 1, binding = 0) uniform subpassInput inAlbedo;
+layout(input_attachment_index = 1, set = 1, binding = 1) uniform subpassInput inNormal;
+layout(input_attachment_index = 2, set = 1, binding = 2) uniform subpassInput inDepth;
+
+layout(push_constant) uniform Push {
+    mat4 inverseProjectionView;
+} push;
+
+void main() {
+    float depth = subpassLoad(inDepth).r;
+    if (depth >= 1.0) {
+        discard;  // nothing drawn here, keep the clear color
+    }
+
+    vec2 ndc = gl_FragCoord.xy / ubo.clusterParams.zw * 2.0 - 1.0;
+    vec4 positionWorld = push.inverseProjectionView * vec4(ndc, depth, 1.0);
+    vec3 normalWorld = subpassLoad(inNormal).xyz * 2.0 - 1.0;
+    vec3 albedo = subpassLoad(inAlbedo).rgb;
+
+    vec3 lighting = computeLighting(positionWorld.xyz / positionWorld.w, normalWorld, vec4(gl_FragCoord.xy, depth, 1.0));
+    outColor = vec4(lighting * albedo, 1.0);
+}
@@ -0,0 +1,19 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+layout(location = 0) in vec3 position;
+
+#include "global_ubo.glsl"
+
+layout(push_constant) uniform Push {
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+} push;
+
+// must match simple_shader.vert bit for bit, the main pass tests depth with EQUAL
+invariant gl_Position;
+
+void main() {
+    vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);
+    gl_Position = ubo.projectionViewMatrix * positionWorld;
+}
@@ -0,0 +1,21 @@
+#version 450
+
+// benchmarks/draw_benchmark.cpp, positions are already in clip space after the model matrix
+
+layout(location = 0) in vec3 position;
+
+// per object transforms, indexed with the instance index by the shared buffer, instanced and
+// indirect variants
+layout(set = 0, binding = 0) readonly buffer Transforms {
+    mat4 transforms[];
+};
+
+layout(push_constant) uniform Push {
+    mat4 modelMatrix;  // per draw, when useTransforms is 0
+    uint useTransforms;
+} push;
+
+void main() {
+    mat4 model = push.useTransforms != 0 ? transforms[gl_InstanceIndex] : push.modelMatrix;
+    gl_Position = model * vec4(position, 1.0);
+}
@@ -0,0 +1,14 @@
+// Set 0 binding 0, matches GlobalUbo in sve_frame_info.hpp.
+// Include with #extension GL_GOOGLE_include_directive
+#define SHADOW_CASCADE_COUNT 4
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projectionViewMatrix;
+    vec4 ambientLightColor;
+    uvec4 clusterGrid;    // cluster counts in x, y and z, w is the light count
+    vec4 clusterParams;   // near, far, framebuffer width and height
+    vec4 directionalLightDirection;  // direction the light travels
+    vec4 directionalLightColor;      // w is intensity
+    vec4 cascadeSplits;              // far view depth of each shadow cascade
+    mat4 lightViewProjection[SHADOW_CASCADE_COUNT];
+} ubo;
@@ -0,0 +1,86 @@
+// Clustered point lights, matches LightCullingSystem (set 0, bindings 1-3), and the shadowed
+// directional light of ShadowRenderSystem (binding 4).
+// Include after global_ubo.glsl with #extension GL_GOOGLE_include_directive
+
+struct PointLight {
+    vec4 position;  // world space, w is range
+    vec4 color;     // w is intensity
+};
+
+layout(set = 0, binding = 1) readonly buffer LightBuffer {
+    PointLight lights[];
+};
+layout(set = 0, binding = 2) readonly buffer ClusterBuffer {
+    uvec2 clusters[];  // offset into lightIndices, count
+};
+layout(set = 0, binding = 3) readonly buffer LightIndexBuffer {
+    uint lightIndices[];
+};
+layout(set = 0, binding = 4) uniform sampler2DArrayShadow shadowMap;
+
+// inverts the [0, 1] perspective depth of SveCamera::setPerspectiveProjection back to view z
+float viewDepth(vec4 fragCoord) {
+    float near = ubo.clusterParams.x;
+    float far = ubo.clusterParams.y;
+    return near * far / (far - fragCoord.z * (far - near));
+}
+
+uint clusterIndex(vec4 fragCoord) {
+    float near = ubo.clusterParams.x;
+    float far = ubo.clusterParams.y;
+    float viewZ = viewDepth(fragCoord);
+
+    float slices = float(ubo.clusterGrid.z);
+    uint z = uint(clamp(floor(log(viewZ / near) / log(far / near) * slices), 0.0, slices - 1.0));
+    uvec2 tile = uvec2(clamp(
+        floor(fragCoord.xy / ubo.clusterParams.zw * vec2(ubo.clusterGrid.xy)),
+        vec2(0.0),
+        vec2(ubo.clusterGrid.xy) - 1.0));
+    return (z * ubo.clusterGrid.y + tile.y) * ubo.clusterGrid.x + tile.x;
+}
+
+// 1 lit, 0 shadowed. Picks the first cascade whose split is past the fragment, beyond the last
+// split everything is lit
+float shadowFactor(vec3 positionWorld, vec4 fragCoord) {
+    float viewZ = viewDepth(fragCoord);
+    int cascade = 0;
+    while (cascade < SHADOW_CASCADE_COUNT && viewZ > ubo.cascadeSplits[cascade]) {
+        cascade++;
+    }
+    if (cascade == SHADOW_CASCADE_COUNT) {
+        return 1.0;
+    }
+
+    vec4 lightClip = ubo.lightViewProjection[cascade] * vec4(positionWorld, 1.0);
+    vec3 ndc = lightClip.xyz / lightClip.w;
+    // compare sampler with linear filtering, 2x2 PCF
+    return texture(shadowMap, vec4(ndc.xy * 0.5 + 0.5, float(cascade), ndc.z));
+}
+
+// shadowed directional light and diffuse from every light in this fragment's cluster, plus ambient
+vec3 computeLighting(vec3 positionWorld, vec3 normalWorld, vec4 fragCoord) {
+    vec3 lighting = ubo.ambientLightColor.xyz * ubo.ambientLightColor.w;
+    vec3 normal = normalize(normalWorld);
+
+    float sunCosAngle = max(dot(normal, -ubo.directionalLightDirection.xyz), 0.0);
+    if (sunCosAngle > 0.0) {
+        lighting += ubo.directionalLightColor.xyz * ubo.directionalLightColor.w * sunCosAngle *
+                    shadowFactor(positionWorld, fragCoord);
+    }
+
+    uvec2 cluster = clusters[clusterIndex(fragCoord)];
+    for (uint i = 0; i < cluster.y; i++) {
+        PointLight light = lights[lightIndices[cluster.x + i]];
+        vec3 directionToLight = light.position.xyz - positionWorld;
+        float distanceSquared = dot(directionToLight, directionToLight);
+
+        // inverse square, windowed to reach zero at the light's range so culling is exact
+        float ratio = distanceSquared / (light.position.w * light.position.w);
+        float window = clamp(1.0 - ratio * ratio, 0.0, 1.0);
+        float attenuation = window * window / max(distanceSquared, 0.0001);
+
+        float cosAngle = max(dot(normal, directionToLight * inversesqrt(distanceSquared)), 0.0);
+        lighting += light.color.xyz * light.color.w * attenuation * cosAngle;
+    }
+    return lighting;
+}
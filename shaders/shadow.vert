@@ -0,0 +1,11 @@
+#version 450
+
+layout(location = 0) in vec3 position;
+
+layout(push_constant) uniform Push {
+    mat4 lightModelMatrix;  // cascade view projection * model
+} push;
+
+void main() {
+    gl_Position = push.lightModelMatrix * vec4(position, 1.0);
+}
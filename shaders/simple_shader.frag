@@ -1,4 +1,5 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
 
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec3 fragPosWorld;
@@ -6,12 +7,8 @@ layout(location = 2) in vec3 fragNormalWorld;
 
 layout(location = 0) out vec4 outColor;
 
-layout(set = 0, binding = 0) uniform GlobalUbo {
-    mat4 projectionViewMatrix;
-    vec4 ambientLightColor;
-    vec3 lightPosition;
-    vec4 lightColor;
-} ubo;
+#include "global_ubo.glsl"
+#include "lighting.glsl"
 
 layout(push_constant) uniform Push {
     mat4 modelMatrix;
@@ -19,12 +16,6 @@ layout(push_constant) uniform Push {
 } push;
 
 void main() {
-    vec3 directionToLight = ubo.lightPosition - fragPosWorld.xyz;
-    float attenuation = 1.0 / dot(directionToLight, directionToLight); // distance squared
-
-    vec3 lightColor = ubo.lightColor.xyz * ubo.lightColor.w * attenuation;
-    vec3 ambientLight = ubo.ambientLightColor.xyz * ubo.ambientLightColor.w;
-    vec3 diffuseLight = lightColor * max(dot(normalize(fragNormalWorld), normalize(directionToLight)), 0);
-
-    outColor = vec4((diffuseLight + ambientLight) * fragColor, 1.0);
+    vec3 lighting = computeLighting(fragPosWorld, fragNormalWorld, gl_FragCoord);
+    outColor = vec4(lighting * fragColor, 1.0);
 }
\ No newline at end of file
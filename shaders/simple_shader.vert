@@ -1,4 +1,5 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
 
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 color;
@@ -9,18 +10,15 @@ layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec3 fragPosWorld; // dir to light source for each fragment
 layout(location = 2) out vec3 fragNormalWorld;   
 
-layout(set = 0, binding = 0) uniform GlobalUbo {
-    mat4 projectionViewMatrix;
-    vec4 ambientLightColor;
-    vec3 lightPosition;
-    vec4 lightColor;
-} ubo;
+#include "global_ubo.glsl"
 
 layout(push_constant) uniform Push {
     mat4 modelMatrix; // projection * view * model
     mat4 normalMatrix;
 } push;
 
+invariant gl_Position;  // shared with depth_prepass.vert
+
 void main() {
     vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);    // position in world space
     gl_Position = ubo.projectionViewMatrix * positionWorld;         // position in clip space
@@ -0,0 +1,41 @@
+#version 450
+
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform sampler2D sceneColor;
+
+layout(push_constant) uniform Push {
+    vec2 uvScale;          // rendered part of the scene image, in uv
+    vec2 sourceTexelSize;  // 1 / scene image extent
+    vec2 targetSize;
+    float sharpness;       // 0 plain bilinear up to 1 strongest
+} push;
+
+// texels past the render area hold whatever an earlier, larger frame left there
+vec3 sampleScene(vec2 uv) {
+    vec2 halfTexel = 0.5 * push.sourceTexelSize;
+    return texture(sceneColor, clamp(uv, halfTexel, push.uvScale - halfTexel)).rgb;
+}
+
+void main() {
+    vec2 uv = gl_FragCoord.xy / push.targetSize * push.uvScale;
+    vec3 center = sampleScene(uv);
+    if (push.sharpness <= 0.0) {
+        outColor = vec4(center, 1.0);  // plain bilinear, e.g. a copy at native resolution
+        return;
+    }
+    vec3 north = sampleScene(uv - vec2(0.0, push.sourceTexelSize.y));
+    vec3 south = sampleScene(uv + vec2(0.0, push.sourceTexelSize.y));
+    vec3 west = sampleScene(uv - vec2(push.sourceTexelSize.x, 0.0));
+    vec3 east = sampleScene(uv + vec2(push.sourceTexelSize.x, 0.0));
+
+    // contrast adaptive sharpening: the less headroom the neighbourhood has towards black or
+    // white, the less it is sharpened, so edges that are already hard don't ring
+    vec3 minColor = min(center, min(min(north, south), min(west, east)));
+    vec3 maxColor = max(center, max(max(north, south), max(west, east)));
+    vec3 amount = sqrt(clamp(min(minColor, 1.0 - maxColor) / max(maxColor, vec3(1e-4)), 0.0, 1.0));
+    vec3 weight = -amount * mix(0.0, 0.2, push.sharpness);
+
+    vec3 color = (center + (north + south + west + east) * weight) / (1.0 + 4.0 * weight);
+    outColor = vec4(clamp(color, 0.0, 1.0), 1.0);
+}
@@ -0,0 +1,587 @@
+#include "shadow_render_system.hpp"
+
+#include "sve_command_counters.hpp"
+#include "sve_utils.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+
+namespace sve {
+
+// mix between uniform and logarithmic splits, more log keeps near cascades tight
+static constexpr float CASCADE_SPLIT_LAMBDA = .75f;
+
+struct ShadowPushConstantData {
+    glm::mat4 lightModelMatrix{1.f};  // cascade view projection * model
+};
+
+ShadowRenderSystem::ShadowRenderSystem(SveDevice &device, float shadowDistance)
+    : sveDevice{device}, shadowDistance{shadowDistance} {
+    createShadowMap();
+    createRenderPass();
+    createFramebuffers();
+    createPipelineLayout();
+    createPipeline();
+}
+
+ShadowRenderSystem::~ShadowRenderSystem() {
+    vkDestroyPipelineLayout(sveDevice.device(), pipelineLayout, nullptr);
+    for (auto framebuffer : framebuffers) {
+        vkDestroyFramebuffer(sveDevice.device(), framebuffer, nullptr);
+    }
+    vkDestroyRenderPass(sveDevice.device(), loadRenderPass, nullptr);
+    vkDestroyRenderPass(sveDevice.device(), renderPass, nullptr);
+    vkDestroySampler(sveDevice.device(), shadowSampler, nullptr);
+    for (auto view : layerViews) {
+        vkDestroyImageView(sveDevice.device(), view, nullptr);
+    }
+    vkDestroyImageView(sveDevice.device(), shadowArrayView, nullptr);
+    sveDevice.destroyImage(staticImage, staticImageAllocation);
+    sveDevice.destroyImage(shadowImage, shadowImageAllocation);
+}
+
+void ShadowRenderSystem::createShadowMap() {
+    depthFormat = sveDevice.findSupportedFormat(
+        {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM},
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+            VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = SHADOW_MAP_SIZE;
+    imageInfo.extent.height = SHADOW_MAP_SIZE;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = SHADOW_CASCADE_COUNT;
+    imageInfo.format = depthFormat;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+                      VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    sveDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, shadowImage, shadowImageAllocation);
+
+    imageInfo.arrayLayers = SHADOW_CASCADE_COUNT - FIRST_CACHED_CASCADE;
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    sveDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, staticImage, staticImageAllocation);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = shadowImage;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+    viewInfo.format = depthFormat;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = SHADOW_CASCADE_COUNT;
+    if (vkCreateImageView(sveDevice.device(), &viewInfo, nullptr, &shadowArrayView) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shadow map image view!");
+    }
+
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.subresourceRange.layerCount = 1;
+    for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+        viewInfo.subresourceRange.baseArrayLayer = i;
+        if (vkCreateImageView(sveDevice.device(), &viewInfo, nullptr, &layerViews[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shadow cascade image view!");
+        }
+    }
+
+    // hardware depth compare with linear filtering gives 2x2 PCF for free
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;  // outside the map is lit
+    samplerInfo.compareEnable = VK_TRUE;
+    samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    samplerInfo.minLod = 0.f;
+    samplerInfo.maxLod = 0.f;
+    if (vkCreateSampler(sveDevice.device(), &samplerInfo, nullptr, &shadowSampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shadow sampler!");
+    }
+}
+
+void ShadowRenderSystem::createRenderPass() {
+    VkAttachmentDescription depthAttachment{};
+    depthAttachment.format = depthFormat;
+    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+    VkAttachmentReference depthAttachmentRef{};
+    depthAttachmentRef.attachment = 0;
+    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 0;
+    subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+    // the map is shared by all frames in flight: wait for earlier frames to finish sampling before
+    // overwriting a cascade, and make the new depth visible to this frame's fragment shaders
+    std::array<VkSubpassDependency, 2> dependencies{};
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    dependencies[0].srcAccessMask = 0;
+    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    dependencies[1].srcSubpass = 0;
+    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &depthAttachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    renderPassInfo.pDependencies = dependencies.data();
+
+    if (vkCreateRenderPass(sveDevice.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shadow render pass!");
+    }
+
+    // dynamic casters are drawn over the static depth copied back into the layer
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+    if (vkCreateRenderPass(sveDevice.device(), &renderPassInfo, nullptr, &loadRenderPass) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shadow render pass!");
+    }
+}
+
+void ShadowRenderSystem::createFramebuffers() {
+    for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = renderPass;
+        framebufferInfo.attachmentCount = 1;
+        framebufferInfo.pAttachments = &layerViews[i];
+        framebufferInfo.width = SHADOW_MAP_SIZE;
+        framebufferInfo.height = SHADOW_MAP_SIZE;
+        framebufferInfo.layers = 1;
+
+        if (vkCreateFramebuffer(sveDevice.device(), &framebufferInfo, nullptr, &framebuffers[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shadow framebuffer!");
+        }
+    }
+}
+
+void ShadowRenderSystem::createPipelineLayout() {
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.size = sizeof(ShadowPushConstantData);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 0;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(sveDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shadow pipeline layout!");
+    }
+}
+
+void ShadowRenderSystem::createPipeline() {
+    assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+
+    PipelineConfigInfo pipelineConfig{};
+    SvePipeline::defaultPipelineConfigInfo(pipelineConfig);
+    pipelineConfig.renderPass = renderPass;
+    pipelineConfig.pipelineLayout = pipelineLayout;
+    pipelineConfig.colorBlendInfo.attachmentCount = 0;
+    pipelineConfig.colorBlendInfo.pAttachments = nullptr;
+    pipelineConfig.bindingDescriptions = SveModel::Vertex::getPositionBindingDescriptions();
+    pipelineConfig.attributeDescriptions = SveModel::Vertex::getPositionAttributeDescriptions();
+
+    // casters in front of the cascade's near plane get pancaked onto it instead of clipped
+    pipelineConfig.rasterizerInfo.depthClampEnable = sveDevice.supportsDepthClamp() ? VK_TRUE : VK_FALSE;
+    pipelineConfig.rasterizerInfo.depthBiasEnable = VK_TRUE;
+    pipelineConfig.rasterizerInfo.depthBiasConstantFactor = 1.25f;
+    pipelineConfig.rasterizerInfo.depthBiasSlopeFactor = 1.75f;
+
+    svePipeline = std::make_unique<SvePipeline>(sveDevice, "shaders/shadow.vert.spv", "", pipelineConfig);
+}
+
+void ShadowRenderSystem::setLight(glm::vec3 direction, glm::vec4 color) {
+    direction = glm::normalize(direction);
+    if (direction != lightDirection) {
+        cachedCascadesDirty = true;
+    }
+    lightDirection = direction;
+    lightColor = color;
+}
+
+VkDescriptorImageInfo ShadowRenderSystem::descriptorInfo() const {
+    return VkDescriptorImageInfo{
+        shadowSampler,
+        shadowArrayView,
+        VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+    };
+}
+
+void ShadowRenderSystem::render(FrameInfo &frameInfo, GlobalUbo &ubo) {
+    SveCommandScope commandScope{"shadows"};
+    bool hasDynamicCasters = false;
+    size_t hash = hashStaticCasters(frameInfo.gameObjects, hasDynamicCasters);
+    if (hash != casterHash) {
+        casterHash = hash;
+        cachedCascadesDirty = true;
+    }
+
+    const SveCamera &camera = frameInfo.camera;
+    const glm::mat4 &projection = camera.getProjection();
+    const glm::mat4 inverseViewProjection = glm::inverse(projection * camera.getView());
+    const float near = camera.getNear();
+    const float far = std::min(camera.getFar(), shadowDistance);
+
+    cascadesRendered = 0;
+    drawCount = 0;
+    float previousSplit = near;
+    for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+        float p = static_cast<float>(i + 1) / static_cast<float>(SHADOW_CASCADE_COUNT);
+        float logSplit = near * std::pow(far / near, p);
+        float uniformSplit = near + (far - near) * p;
+        float split = glm::mix(uniformSplit, logSplit, CASCADE_SPLIT_LAMBDA);
+
+        // slice corners, view depth d maps to ndc z = P22 + P32 / d for this projection
+        glm::vec3 corners[8];
+        int corner = 0;
+        for (float depth : {previousSplit, split}) {
+            float ndcZ = projection[2][2] + projection[3][2] / depth;
+            for (float x : {-1.f, 1.f}) {
+                for (float y : {-1.f, 1.f}) {
+                    glm::vec4 world = inverseViewProjection * glm::vec4(x, y, ndcZ, 1.f);
+                    corners[corner++] = glm::vec3(world) / world.w;
+                }
+            }
+        }
+
+        auto &cascade = cascades[i];
+        if (i < FIRST_CACHED_CASCADE) {
+            fitCascade(i, corners, 0.f);
+            renderCascade(frameInfo, i, CasterFilter::All);
+            cascadesRendered++;
+        } else {
+            if (cachedCascadesDirty || !cascade.valid || !cachedCascadeCovers(cascade, corners)) {
+                fitCascade(i, corners, CACHED_CASCADE_PADDING);
+                renderCascade(frameInfo, i, CasterFilter::Static);
+                staticDepthSaved[i] = false;
+                cascadesRendered++;
+            } else if (holdsDynamicCasters[i]) {
+                copyStaticDepth(frameInfo.commandBuffer, i, false);  // wipe last frame's dynamic casters
+            }
+            // a fully static scene never pays for the copies
+            if (hasDynamicCasters) {
+                if (!staticDepthSaved[i]) {
+                    copyStaticDepth(frameInfo.commandBuffer, i, true);
+                    staticDepthSaved[i] = true;
+                }
+                renderCascade(frameInfo, i, CasterFilter::Dynamic);
+            }
+            holdsDynamicCasters[i] = hasDynamicCasters;
+        }
+        cascade.splitDepth = split;
+
+        ubo.cascadeSplits[i] = split;
+        ubo.lightViewProjection[i] = cascade.viewProjection;
+        previousSplit = split;
+    }
+    cachedCascadesDirty = false;
+
+    ubo.directionalLightDirection = glm::vec4(lightDirection, 0.f);
+    ubo.directionalLightColor = lightColor;
+}
+
+static void sliceSphere(const glm::vec3 corners[8], glm::vec3 &center, float &radius) {
+    center = glm::vec3{0.f};
+    for (int i = 0; i < 8; i++) {
+        center += corners[i];
+    }
+    center /= 8.f;
+
+    radius = 0.f;
+    for (int i = 0; i < 8; i++) {
+        radius = std::max(radius, glm::length(corners[i] - center));
+    }
+    // quantized so float noise doesn't change the cascade size from frame to frame
+    radius = std::ceil(radius * 16.f) / 16.f;
+}
+
+void ShadowRenderSystem::fitCascade(uint32_t index, const glm::vec3 corners[8], float padding) {
+    glm::vec3 center;
+    float radius;
+    sliceSphere(corners, center, radius);
+    radius *= 1.f + padding;
+
+    // snap the light space origin to whole texels
+    glm::vec3 up = std::abs(lightDirection.y) > .99f ? glm::vec3{0.f, 0.f, 1.f} : glm::vec3{0.f, 1.f, 0.f};
+    glm::mat4 lightRotation = glm::lookAt(glm::vec3{0.f}, lightDirection, up);
+    float texelSize = 2.f * radius / static_cast<float>(SHADOW_MAP_SIZE);
+    glm::vec3 lightSpaceCenter = glm::vec3(lightRotation * glm::vec4(center, 1.f));
+    lightSpaceCenter.x = std::floor(lightSpaceCenter.x / texelSize) * texelSize;
+    lightSpaceCenter.y = std::floor(lightSpaceCenter.y / texelSize) * texelSize;
+    center = glm::vec3(glm::inverse(lightRotation) * glm::vec4(lightSpaceCenter, 1.f));
+
+    // without depth clamp, casters between the light and the sphere need room in front
+    float pullback = sveDevice.supportsDepthClamp() ? 0.f : shadowDistance;
+    glm::mat4 view = glm::lookAt(center - lightDirection * (radius + pullback), center, up);
+    glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, 0.f, 2.f * radius + pullback);
+
+    auto &cascade = cascades[index];
+    cascade.center = center;
+    cascade.radius = radius;
+    cascade.depthRange = 2.f * radius + pullback;
+    cascade.viewProjection = projection * view;
+    cascade.valid = true;
+}
+
+// a cached cascade stays usable while the slice's sphere sits inside the padded one
+bool ShadowRenderSystem::cachedCascadeCovers(const Cascade &cascade, const glm::vec3 corners[8]) const {
+    glm::vec3 center;
+    float radius;
+    sliceSphere(corners, center, radius);
+    return glm::length(center - cascade.center) + radius <= cascade.radius;
+}
+
+size_t ShadowRenderSystem::hashStaticCasters(SveGameObject::Map &gameObjects, bool &hasDynamicCasters) const {
+    size_t seed = 0;
+    for (auto &kv : gameObjects) {
+        auto &obj = kv.second;
+        if (obj.model == nullptr) continue;
+        if (obj.dynamic) {
+            hasDynamicCasters = true;
+            continue;
+        }
+        const auto &t = obj.transform;
+        hashCombine(
+            seed,
+            kv.first,
+            obj.model.get(),
+            t.translation.x,
+            t.translation.y,
+            t.translation.z,
+            t.rotation.x,
+            t.rotation.y,
+            t.rotation.z,
+            t.scale.x,
+            t.scale.y,
+            t.scale.z);
+    }
+    return seed;
+}
+
+void ShadowRenderSystem::renderCascade(FrameInfo &frameInfo, uint32_t index, CasterFilter filter) {
+    const auto &cascade = cascades[index];
+    VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+
+    VkClearValue clearValue{};
+    clearValue.depthStencil = {1.f, 0};
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = filter == CasterFilter::Dynamic ? loadRenderPass : renderPass;
+    renderPassInfo.framebuffer = framebuffers[index];
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = {SHADOW_MAP_SIZE, SHADOW_MAP_SIZE};
+    renderPassInfo.clearValueCount = 1;
+    renderPassInfo.pClearValues = &clearValue;
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    VkViewport viewport{0.f, 0.f, static_cast<float>(SHADOW_MAP_SIZE), static_cast<float>(SHADOW_MAP_SIZE), 0.f, 1.f};
+    VkRect2D scissor{{0, 0}, {SHADOW_MAP_SIZE, SHADOW_MAP_SIZE}};
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    svePipeline->bind(commandBuffer);
+
+    for (auto &kv : frameInfo.gameObjects) {
+        auto &obj = kv.second;
+        if (obj.model == nullptr) continue;
+        if ((filter == CasterFilter::Static && obj.dynamic) || (filter == CasterFilter::Dynamic && !obj.dynamic)) {
+            continue;
+        }
+
+        // cull the caster's bounding sphere against the cascade box, in clip space since the
+        // projection is orthographic. Nothing is culled toward the light, those still cast
+        glm::mat4 modelMatrix = obj.transform.mat4();
+        glm::vec3 scale = glm::abs(obj.transform.scale);
+        float radius = obj.model->getBoundingRadius() * std::max({scale.x, scale.y, scale.z});
+        glm::vec4 center = cascade.viewProjection * modelMatrix * glm::vec4(obj.model->getBoundingCenter(), 1.f);
+        float ndcRadius = radius / cascade.radius;
+        if (std::abs(center.x) > 1.f + ndcRadius || std::abs(center.y) > 1.f + ndcRadius ||
+            center.z - radius / cascade.depthRange > 1.f) {
+            continue;
+        }
+
+        ShadowPushConstantData push{};
+        push.lightModelMatrix = cascade.viewProjection * modelMatrix;
+        SveCommandCounters::pushConstants(
+            commandBuffer,
+            pipelineLayout,
+            VK_SHADER_STAGE_VERTEX_BIT,
+            0,
+            sizeof(ShadowPushConstantData),
+            &push);
+        obj.model->bindPositions(commandBuffer);
+        obj.model->draw(commandBuffer);
+        drawCount++;
+    }
+
+    vkCmdEndRenderPass(commandBuffer);
+}
+
+
+static VkImageMemoryBarrier layerBarrier(
+    VkImage image,
+    uint32_t layer,
+    VkImageLayout oldLayout,
+    VkImageLayout newLayout,
+    VkAccessFlags srcAccessMask,
+    VkAccessFlags dstAccessMask) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, layer, 1};
+    barrier.srcAccessMask = srcAccessMask;
+    barrier.dstAccessMask = dstAccessMask;
+    return barrier;
+}
+
+// The shadow layer rests in DEPTH_STENCIL_READ_ONLY_OPTIMAL and the static image in
+// TRANSFER_SRC_OPTIMAL, both are back there when this returns. Whichever side is written is
+// transitioned from UNDEFINED since its old contents are replaced whole
+void ShadowRenderSystem::copyStaticDepth(VkCommandBuffer commandBuffer, uint32_t index, bool save) {
+    assert(index >= FIRST_CACHED_CASCADE && "Only cached cascades have static depth");
+    uint32_t staticLayer = index - FIRST_CACHED_CASCADE;
+    constexpr VkAccessFlags depthAccess =
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    std::array<VkImageMemoryBarrier, 2> before{};
+    std::array<VkImageMemoryBarrier, 2> after{};
+    if (save) {
+        before[0] = layerBarrier(
+            shadowImage,
+            index,
+            VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            VK_ACCESS_TRANSFER_READ_BIT);
+        before[1] = layerBarrier(
+            staticImage,
+            staticLayer,
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            0,
+            VK_ACCESS_TRANSFER_WRITE_BIT);
+        after[0] = layerBarrier(
+            shadowImage,
+            index,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+            0,
+            depthAccess | VK_ACCESS_SHADER_READ_BIT);
+        after[1] = layerBarrier(
+            staticImage,
+            staticLayer,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_ACCESS_TRANSFER_READ_BIT);
+    } else {
+        // earlier frames may still be sampling the layer or have just drawn into it
+        before[0] = layerBarrier(
+            shadowImage,
+            index,
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            VK_ACCESS_TRANSFER_WRITE_BIT);
+        after[0] = layerBarrier(
+            shadowImage,
+            index,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            depthAccess | VK_ACCESS_SHADER_READ_BIT);
+    }
+    uint32_t barrierCount = save ? 2 : 1;
+
+    SveCommandCounters::count(SveCommandCounters::Barriers);
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        barrierCount,
+        before.data());
+
+    VkImageCopy region{};
+    region.srcSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, save ? index : staticLayer, 1};
+    region.dstSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, save ? staticLayer : index, 1};
+    region.extent = {SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, 1};
+    SveCommandCounters::count(SveCommandCounters::Copies);
+    vkCmdCopyImage(
+        commandBuffer,
+        save ? shadowImage : staticImage,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        save ? staticImage : shadowImage,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        1,
+        &region);
+
+    SveCommandCounters::count(SveCommandCounters::Barriers);
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+            VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        barrierCount,
+        after.data());
+}
+
+}  // namespace sve
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "sve_device.hpp"
+#include "sve_frame_info.hpp"
+#include "sve_pipeline.hpp"
+
+// std
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace sve {
+
+// Cascaded shadow maps for one directional light. The camera frustum up to shadowDistance is
+// split into SHADOW_CASCADE_COUNT slices, each fitted with a bounding sphere so the cascade size
+// doesn't change as the camera turns, and its light space origin snapped to whole texels so
+// casters don't shimmer as it moves. Casters are culled per cascade against the cascade's box.
+//
+// The near cascades are rendered every frame. From FIRST_CACHED_CASCADE on, cascades are fitted
+// with extra padding and only re-rendered when the light changes, the casters change, or the
+// camera has moved far enough that the padded cascade no longer covers its slice. Only static
+// casters go into the cache: each cached cascade's static depth is kept in a second image, and
+// while there are dynamic casters it is copied back every frame before they are drawn on top
+class ShadowRenderSystem {
+   public:
+    static constexpr uint32_t SHADOW_MAP_SIZE = 2048;
+    static constexpr uint32_t FIRST_CACHED_CASCADE = 2;
+    static constexpr float CACHED_CASCADE_PADDING = .25f;  // fraction of the cascade radius
+
+    ShadowRenderSystem(SveDevice &device, float shadowDistance = 40.f);
+    ~ShadowRenderSystem();
+
+    ShadowRenderSystem(const ShadowRenderSystem &) = delete;
+    ShadowRenderSystem &operator=(const ShadowRenderSystem &) = delete;
+
+    void setLight(glm::vec3 direction, glm::vec4 color);
+    // forces the cached cascades to re-render next frame
+    void invalidateCachedCascades() { cachedCascadesDirty = true; }
+
+    // fits the cascades, renders the ones that are out of date and fills in the shadow fields of
+    // the ubo. Call outside of any render pass
+    void render(FrameInfo &frameInfo, GlobalUbo &ubo);
+
+    VkDescriptorImageInfo descriptorInfo() const;
+    uint32_t getCascadesRenderedLastFrame() const { return cascadesRendered; }
+    uint32_t getDrawCountLastFrame() const { return drawCount; }
+
+   private:
+    struct Cascade {
+        glm::vec3 center{0.f};  // texel snapped, world space
+        float radius = 0.f;
+        float depthRange = 0.f;  // near to far of the light projection
+        float splitDepth = 0.f;
+        glm::mat4 viewProjection{1.f};
+        bool valid = false;
+    };
+
+    void createShadowMap();
+    void createRenderPass();
+    void createFramebuffers();
+    void createPipelineLayout();
+    void createPipeline();
+
+    enum class CasterFilter { All, Static, Dynamic };
+
+    void fitCascade(uint32_t index, const glm::vec3 corners[8], float padding);
+    bool cachedCascadeCovers(const Cascade &cascade, const glm::vec3 corners[8]) const;
+    size_t hashStaticCasters(SveGameObject::Map &gameObjects, bool &hasDynamicCasters) const;
+    // Dynamic draws over the cascade's current depth, the others clear it first
+    void renderCascade(FrameInfo &frameInfo, uint32_t index, CasterFilter filter);
+    // copies a cached cascade's layer into the static depth image, or back out of it
+    void copyStaticDepth(VkCommandBuffer commandBuffer, uint32_t index, bool save);
+
+    SveDevice &sveDevice;
+    float shadowDistance;
+
+    VkFormat depthFormat;
+    VkImage shadowImage = VK_NULL_HANDLE;
+    SveAllocation shadowImageAllocation{};
+    VkImageView shadowArrayView = VK_NULL_HANDLE;  // sampled
+    std::array<VkImageView, SHADOW_CASCADE_COUNT> layerViews{};  // rendered
+    std::array<VkFramebuffer, SHADOW_CASCADE_COUNT> framebuffers{};
+    VkSampler shadowSampler = VK_NULL_HANDLE;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkRenderPass loadRenderPass = VK_NULL_HANDLE;  // compatible with renderPass, keeps the depth
+
+    // static casters only, one layer per cached cascade
+    VkImage staticImage = VK_NULL_HANDLE;
+    SveAllocation staticImageAllocation{};
+
+    std::unique_ptr<SvePipeline> svePipeline;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+
+    glm::vec3 lightDirection{glm::normalize(glm::vec3{1.f, 3.f, 1.f})};
+    glm::vec4 lightColor{1.f, 1.f, 1.f, .8f};
+    std::array<Cascade, SHADOW_CASCADE_COUNT> cascades{};
+    bool cachedCascadesDirty = true;
+    std::array<bool, SHADOW_CASCADE_COUNT> staticDepthSaved{};  // into staticImage since the last re-render
+    std::array<bool, SHADOW_CASCADE_COUNT> holdsDynamicCasters{};
+    size_t casterHash = 0;
+    uint32_t cascadesRendered = 0;
+    uint32_t drawCount = 0;
+};
+
+}  // namespace sve
@@ -1,4 +1,8 @@
 #include "simple_render_system.hpp"
+
+#include "sve_command_counters.hpp"
+#include "sve_cpu_profiler.hpp"
+
 // libs
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -18,21 +22,28 @@ struct SimplePushConstantData {
     glm::mat4 normalMatrix{1.f};
 };
 
-SimpleRenderSystem::SimpleRenderSystem(SveDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
+SimpleRenderSystem::SimpleRenderSystem(
+    SveDevice& device,
+    VkRenderPass renderPass,
+    VkDescriptorSetLayout globalSetLayout,
+    VkDescriptorSetLayout bindlessSetLayout)
     : sveDevice{device} {
-    createPipelineLayout(globalSetLayout);
+    createPipelineLayout(globalSetLayout, bindlessSetLayout);
     createPipeline(renderPass);
 }
 
 SimpleRenderSystem::~SimpleRenderSystem() { vkDestroyPipelineLayout(sveDevice.device(), pipelineLayout, nullptr); }
 
-void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
+void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout bindlessSetLayout) {
     // push constant
     VkPushConstantRange pushConstantRange{};
     pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
     pushConstantRange.size = sizeof(SimplePushConstantData);
 
     std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
+    if (bindlessSetLayout != VK_NULL_HANDLE) {
+        descriptorSetLayouts.push_back(bindlessSetLayout);  // set 1
+    }
 
     // pipeline info
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
@@ -59,20 +70,70 @@ void SimpleRenderSystem::createPipeline(VkRenderPass renderPass) {
         "shaders/simple_shader.vert.spv",
         "shaders/simple_shader.frag.spv",
         pipelineConfig);
+
+    // depth pre-pass shares the subpass, so the color attachment is still there, just masked off
+    PipelineConfigInfo depthConfig{};
+    SvePipeline::defaultPipelineConfigInfo(depthConfig);
+    depthConfig.renderPass = renderPass;
+    depthConfig.pipelineLayout = pipelineLayout;
+    depthConfig.colorBlendAttachment.colorWriteMask = 0;
+    depthConfig.bindingDescriptions = SveModel::Vertex::getPositionBindingDescriptions();
+    depthConfig.attributeDescriptions = SveModel::Vertex::getPositionAttributeDescriptions();
+    depthPrepassPipeline = std::make_unique<SvePipeline>(sveDevice, "shaders/depth_prepass.vert.spv", "", depthConfig);
+
+    PipelineConfigInfo equalConfig{};
+    SvePipeline::defaultPipelineConfigInfo(equalConfig);
+    equalConfig.renderPass = renderPass;
+    equalConfig.pipelineLayout = pipelineLayout;
+    equalConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+    equalConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+    depthEqualPipeline = std::make_unique<SvePipeline>(
+        sveDevice,
+        "shaders/simple_shader.vert.spv",
+        "shaders/simple_shader.frag.spv",
+        equalConfig);
 }
 
 void SimpleRenderSystem::renderGameObjects(FrameInfo& frameInfo) {
-    svePipeline->bind(frameInfo.commandBuffer);
-
-    vkCmdBindDescriptorSets(
+    SVE_PROFILE_FUNCTION();
+    SveCommandScope commandScope{"simple"};
+    drawCount = 0;
+    // global and bindless sets are bound once, objects only differ by push constants
+    VkDescriptorSet descriptorSets[] = {frameInfo.globalDescriptorSet, frameInfo.bindlessDescriptorSet};
+    SveCommandCounters::bindDescriptorSets(
         frameInfo.commandBuffer,
         VK_PIPELINE_BIND_POINT_GRAPHICS,
         pipelineLayout,
         0,
+        frameInfo.bindlessDescriptorSet != VK_NULL_HANDLE ? 2 : 1,
+        descriptorSets,
         1,
-        &frameInfo.globalDescriptorSet,
-        0,
-        nullptr);
+        &frameInfo.globalUboOffset);
+
+    // both pipelines share the layout, so the sets stay bound across the switch
+    if (depthPrepass) {
+        depthPrepassPipeline->bind(frameInfo.commandBuffer);
+        for (auto& kv : frameInfo.gameObjects) {
+            auto& obj = kv.second;
+            if (obj.model == nullptr) continue;
+            SimplePushConstantData push{};
+            push.modelMatrix = obj.transform.mat4();
+
+            SveCommandCounters::pushConstants(
+                frameInfo.commandBuffer,
+                pipelineLayout,
+                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                0,
+                sizeof(SimplePushConstantData),
+                &push);
+            obj.model->bindPositions(frameInfo.commandBuffer);
+            obj.model->draw(frameInfo.commandBuffer);
+            drawCount++;
+        }
+        depthEqualPipeline->bind(frameInfo.commandBuffer);
+    } else {
+        svePipeline->bind(frameInfo.commandBuffer);
+    }
 
     // set push constant
     for (auto& kv : frameInfo.gameObjects) {
@@ -82,7 +143,7 @@ void SimpleRenderSystem::renderGameObjects(FrameInfo& frameInfo) {
         push.modelMatrix = obj.transform.mat4();
         push.normalMatrix = obj.transform.normalMatrix();
 
-        vkCmdPushConstants(
+        SveCommandCounters::pushConstants(
             frameInfo.commandBuffer,
             pipelineLayout,
             VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
@@ -91,6 +152,7 @@ void SimpleRenderSystem::renderGameObjects(FrameInfo& frameInfo) {
             &push);
         obj.model->bind(frameInfo.commandBuffer);
         obj.model->draw(frameInfo.commandBuffer);
+        drawCount++;
     }
 }
 
@@ -15,7 +15,11 @@
 namespace sve {
 class SimpleRenderSystem {
    public:
-    SimpleRenderSystem(SveDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+    SimpleRenderSystem(
+        SveDevice &device,
+        VkRenderPass renderPass,
+        VkDescriptorSetLayout globalSetLayout,
+        VkDescriptorSetLayout bindlessSetLayout = VK_NULL_HANDLE);
     ~SimpleRenderSystem();
 
     SimpleRenderSystem(const SimpleRenderSystem &) = delete;
@@ -23,14 +27,27 @@ class SimpleRenderSystem {
 
     void renderGameObjects(FrameInfo &frameInfo);
 
+    // Lays down depth from the position-only stream first, then shades with depth EQUAL and writes
+    // off so every covered pixel runs the fragment shader exactly once. Pays for itself when
+    // meshes overlap heavily, costs an extra vertex pass when they don't
+    void setDepthPrepass(bool enabled) { depthPrepass = enabled; }
+    bool isDepthPrepassEnabled() const { return depthPrepass; }
+
+    // draws recorded by the last renderGameObjects, pre-pass included
+    uint32_t getDrawCountLastFrame() const { return drawCount; }
+
    private:
-    void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
+    void createPipelineLayout(VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout bindlessSetLayout);
     void createPipeline(VkRenderPass renderPass);
 
     SveDevice &sveDevice;
 
     std::unique_ptr<SvePipeline> svePipeline;
+    std::unique_ptr<SvePipeline> depthPrepassPipeline;
+    std::unique_ptr<SvePipeline> depthEqualPipeline;  // main pass after the pre-pass
     VkPipelineLayout pipelineLayout;
+    bool depthPrepass = false;
+    uint32_t drawCount = 0;
 };
 
 }  // namespace sve
\ No newline at end of file
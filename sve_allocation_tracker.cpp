@@ -0,0 +1,46 @@
+#include "sve_allocation_tracker.hpp"
+
+// std
+#include <cstdlib>
+#include <new>
+
+namespace sve {
+
+std::atomic<uint64_t> SveAllocationTracker::allocations{0};
+std::atomic<uint64_t> SveAllocationTracker::bytes{0};
+SveAllocationTracker::Counts SveAllocationTracker::frameStart{};
+SveAllocationTracker::Counts SveAllocationTracker::lastFrame{};
+
+void SveAllocationTracker::beginFrame() {
+    Counts now = total();
+    lastFrame = now - frameStart;
+    frameStart = now;
+}
+
+}  // namespace sve
+
+// The replacements for the whole program. Array and nothrow forms forward to these in libstdc++,
+// the deletes only have to match the allocation functions
+void *operator new(std::size_t size) {
+    sve::SveAllocationTracker::recordAllocation(size);
+    if (void *memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc{};
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    sve::SveAllocationTracker::recordAllocation(size);
+    // aligned_alloc wants the size in multiples of the alignment
+    std::size_t align = static_cast<std::size_t>(alignment);
+    std::size_t rounded = (size + align - 1) / align * align;
+    if (void *memory = std::aligned_alloc(align, rounded == 0 ? align : rounded)) {
+        return memory;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void *memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
@@ -0,0 +1,48 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <cstdint>
+
+namespace sve {
+
+// Counts the process's heap allocations through a replaced global operator new, so steady state
+// frames can be held to zero allocations. Only the count and size are recorded, with relaxed
+// atomics, so it stays on in release builds. Direct malloc calls, e.g. from the Vulkan driver or
+// GLFW, are not seen
+class SveAllocationTracker {
+   public:
+    struct Counts {
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+
+        Counts operator-(const Counts &other) const {
+            return {allocations - other.allocations, bytes - other.bytes};
+        }
+    };
+
+    // since the program started
+    static Counts total() {
+        return {allocations.load(std::memory_order_relaxed), bytes.load(std::memory_order_relaxed)};
+    }
+
+    // once per frame, the allocations since the last call become the last frame's
+    static void beginFrame();
+    static Counts getLastFrame() { return lastFrame; }
+    static Counts getCurrentFrame() { return total() - frameStart; }
+
+    // for the replaced operator new only
+    static void recordAllocation(uint64_t size) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+
+   private:
+    // constant initialized, so allocations made before main are counted too
+    static std::atomic<uint64_t> allocations;
+    static std::atomic<uint64_t> bytes;  // requested, never decreases
+    static Counts frameStart;
+    static Counts lastFrame;
+};
+
+}  // namespace sve
@@ -0,0 +1,235 @@
+#include "sve_benchmark.hpp"
+
+#include "light_culling_system.hpp"
+
+// std
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace sve {
+
+struct Summary {
+    float min = 0.f;
+    float avg = 0.f;
+    float p50 = 0.f;
+    float p95 = 0.f;
+    float p99 = 0.f;
+    float max = 0.f;
+};
+
+static Summary summarize(std::vector<float> values) {
+    Summary summary{};
+    if (values.empty()) {
+        return summary;
+    }
+    std::sort(values.begin(), values.end());
+    auto percentile = [&](float p) {
+        size_t index = static_cast<size_t>(p * static_cast<float>(values.size() - 1) + .5f);
+        return values[index];
+    };
+    float sum = 0.f;
+    for (float value : values) {
+        sum += value;
+    }
+    summary.min = values.front();
+    summary.avg = sum / static_cast<float>(values.size());
+    summary.p50 = percentile(.5f);
+    summary.p95 = percentile(.95f);
+    summary.p99 = percentile(.99f);
+    summary.max = values.back();
+    return summary;
+}
+
+// script names and paths are user input, device names come from the driver
+static std::string jsonEscape(const std::string &value) {
+    static const char hex[] = "0123456789abcdef";
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            escaped += "\\u00";
+            escaped += hex[(c >> 4) & 0xf];
+            escaped += hex[c & 0xf];
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+static void writeSummary(std::ofstream &file, const char *name, const Summary &summary) {
+    file << "  \"" << name << "\": {\"min\": " << summary.min << ", \"avg\": " << summary.avg
+         << ", \"p50\": " << summary.p50 << ", \"p95\": " << summary.p95 << ", \"p99\": " << summary.p99
+         << ", \"max\": " << summary.max << "},\n";
+}
+
+static glm::vec3 catmullRom(
+    const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2, const glm::vec3 &p3, float t) {
+    float t2 = t * t;
+    float t3 = t2 * t;
+    return .5f * ((2.f * p1) + (p2 - p0) * t + (2.f * p0 - 5.f * p1 + 4.f * p2 - p3) * t2 +
+                  (3.f * p1 - p0 - 3.f * p2 + p3) * t3);
+}
+
+SveBenchmark::SveBenchmark(const std::string &scriptPath) : scriptPath{scriptPath} {
+    parse(scriptPath);
+    samples.reserve(script.frames);
+}
+
+// one directive per line, # starts a comment:
+//   name <word>
+//   timestep <seconds>, warmup <frames>, frames <frames>, lights <count>, prepass <0|1>
+//   spawn <model path> [count x y z] [spacing s] [scale s] [origin x y z] [rotation x y z]
+//   keyframe <seconds> <position x y z> <rotation x y z>
+void SveBenchmark::parse(const std::string &path) {
+    std::ifstream file{path};
+    if (!file) {
+        throw std::runtime_error("failed to open benchmark script " + path + "!");
+    }
+    script.name = path;
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream in{line};
+        std::string directive;
+        if (!(in >> directive)) {
+            continue;  // blank or comment
+        }
+
+        bool valid = true;
+        if (directive == "name") {
+            valid = static_cast<bool>(in >> script.name);
+        } else if (directive == "timestep") {
+            valid = (in >> script.timestep) && script.timestep > 0.f;
+        } else if (directive == "warmup") {
+            valid = static_cast<bool>(in >> script.warmupFrames);
+        } else if (directive == "frames") {
+            valid = (in >> script.frames) && script.frames > 0;
+        } else if (directive == "lights") {
+            // the light buffers hold MAX_LIGHTS, anything past that would be dropped from the scene
+            valid = (in >> script.lightCount) && script.lightCount <= LightCullingSystem::MAX_LIGHTS;
+        } else if (directive == "prepass") {
+            valid = static_cast<bool>(in >> script.depthPrepass);
+        } else if (directive == "spawn") {
+            Spawn spawn{};
+            valid = static_cast<bool>(in >> spawn.modelPath);
+            std::string option;
+            while (valid && in >> option) {
+                if (option == "count") {
+                    valid = (in >> spawn.count.x >> spawn.count.y >> spawn.count.z) && spawn.count.x > 0 &&
+                            spawn.count.y > 0 && spawn.count.z > 0;
+                } else if (option == "spacing") {
+                    valid = static_cast<bool>(in >> spawn.spacing);
+                } else if (option == "scale") {
+                    valid = static_cast<bool>(in >> spawn.scale);
+                } else if (option == "origin") {
+                    valid = static_cast<bool>(in >> spawn.origin.x >> spawn.origin.y >> spawn.origin.z);
+                } else if (option == "rotation") {
+                    valid = static_cast<bool>(in >> spawn.rotation.x >> spawn.rotation.y >> spawn.rotation.z);
+                } else {
+                    valid = false;
+                }
+            }
+            script.spawns.push_back(spawn);
+        } else if (directive == "keyframe") {
+            Keyframe keyframe{};
+            valid = static_cast<bool>(
+                in >> keyframe.time >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z >>
+                keyframe.rotation.x >> keyframe.rotation.y >> keyframe.rotation.z);
+            script.keyframes.push_back(keyframe);
+        } else {
+            valid = false;
+        }
+
+        if (!valid) {
+            throw std::runtime_error(
+                "malformed benchmark script " + path + " at line " + std::to_string(lineNumber) + "!");
+        }
+    }
+
+    if (script.keyframes.empty()) {
+        throw std::runtime_error("benchmark script " + path + " has no camera keyframes!");
+    }
+    std::stable_sort(script.keyframes.begin(), script.keyframes.end(), [](const Keyframe &a, const Keyframe &b) {
+        return a.time < b.time;
+    });
+}
+
+void SveBenchmark::cameraAt(uint32_t frame, glm::vec3 &position, glm::vec3 &rotation) const {
+    // warm up frames hold the first keyframe
+    float time = static_cast<float>(frame > script.warmupFrames ? frame - script.warmupFrames : 0) * script.timestep;
+    const auto &keys = script.keyframes;
+    if (time <= keys.front().time || keys.size() == 1) {
+        position = keys.front().position;
+        rotation = keys.front().rotation;
+        return;
+    }
+    if (time >= keys.back().time) {
+        position = keys.back().position;
+        rotation = keys.back().rotation;
+        return;
+    }
+
+    size_t next = 1;
+    while (keys[next].time <= time) {
+        next++;
+    }
+    const auto &k0 = keys[next > 1 ? next - 2 : 0];
+    const auto &k1 = keys[next - 1];
+    const auto &k2 = keys[next];
+    const auto &k3 = keys[std::min(next + 1, keys.size() - 1)];
+    float span = k2.time - k1.time;
+    float t = span > 0.f ? (time - k1.time) / span : 1.f;
+    position = catmullRom(k0.position, k1.position, k2.position, k3.position, t);
+    rotation = catmullRom(k0.rotation, k1.rotation, k2.rotation, k3.rotation, t);
+}
+
+void SveBenchmark::recordFrame(uint32_t frame, const FrameSample &sample) {
+    if (frame >= script.warmupFrames) {
+        samples.push_back(sample);
+    }
+}
+
+bool SveBenchmark::writeJson(const std::string &path, const char *deviceName, VkExtent2D extent) const {
+    std::ofstream file{path};
+    if (!file) {
+        return false;
+    }
+
+    std::vector<float> frameMs;
+    std::vector<float> cpuMs;
+    std::vector<float> gpuMs;
+    std::vector<float> draws;
+    std::vector<float> heapAllocations;
+    for (const auto &sample : samples) {
+        frameMs.push_back(sample.frameMs);
+        cpuMs.push_back(sample.cpuMs);
+        gpuMs.push_back(sample.gpuMs);
+        draws.push_back(static_cast<float>(sample.drawCount));
+        heapAllocations.push_back(static_cast<float>(sample.heapAllocations));
+    }
+
+    file << "{\n  \"benchmark\": \"" << jsonEscape(script.name) << "\",\n  \"script\": \"" << jsonEscape(scriptPath)
+         << "\",\n  \"device\": \"" << jsonEscape(deviceName) << "\",\n  \"width\": " << extent.width
+         << ",\n  \"height\": " << extent.height << ",\n  \"timestep_ms\": " << script.timestep * 1000.f
+         << ",\n  \"warmup_frames\": " << script.warmupFrames << ",\n  \"frames\": " << samples.size() << ",\n";
+    writeSummary(file, "frame_ms", summarize(std::move(frameMs)));
+    writeSummary(file, "cpu_ms", summarize(std::move(cpuMs)));
+    writeSummary(file, "gpu_ms", summarize(std::move(gpuMs)));
+    Summary drawSummary = summarize(std::move(draws));
+    Summary allocationSummary = summarize(std::move(heapAllocations));
+    file << "  \"draws\": {\"min\": " << drawSummary.min << ", \"avg\": " << drawSummary.avg
+         << ", \"max\": " << drawSummary.max << "},\n  \"heap_allocations\": {\"min\": " << allocationSummary.min
+         << ", \"avg\": " << allocationSummary.avg << ", \"max\": " << allocationSummary.max << "}\n}\n";
+    return static_cast<bool>(file);
+}
+
+}  // namespace sve
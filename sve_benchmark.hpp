@@ -0,0 +1,79 @@
+#pragma once
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sve {
+
+// Scripted benchmark run. The script places the scene and a camera path, and the run is played
+// back with a fixed simulated timestep, so every run renders the same frames no matter how fast
+// the machine is. Frame, CPU and GPU times of the measured frames are summarised as JSON for
+// comparing commits. See benchmarks/scripts for the format
+class SveBenchmark {
+   public:
+    // a grid of instances of one model, a single object is a 1x1x1 grid
+    struct Spawn {
+        std::string modelPath;
+        glm::uvec3 count{1};
+        float spacing = 1.f;
+        float scale = 1.f;
+        glm::vec3 origin{0.f};  // center of the grid
+        glm::vec3 rotation{0.f};
+    };
+    struct Keyframe {
+        float time;  // seconds of simulated time
+        glm::vec3 position;
+        glm::vec3 rotation;  // euler angles as for SveCamera::setViewXYZ
+    };
+    struct Script {
+        std::string name;
+        float timestep = 1.f / 60.f;
+        uint32_t warmupFrames = 60;  // rendered at the start of the path but not measured
+        uint32_t frames = 600;
+        uint32_t lightCount = 6;
+        bool depthPrepass = false;  // forward path only, see SimpleRenderSystem::setDepthPrepass
+        std::vector<Spawn> spawns;
+        std::vector<Keyframe> keyframes;  // sorted by time
+    };
+    struct FrameSample {
+        float frameMs;  // wall time since the previous frame
+        float cpuMs;
+        float gpuMs;
+        uint32_t drawCount;
+        uint64_t heapAllocations;  // by the frame up to the sample, see SveAllocationTracker
+    };
+
+    // throws if the script can't be read or is malformed
+    explicit SveBenchmark(const std::string &scriptPath);
+
+    const Script &getScript() const { return script; }
+    float getTimestep() const { return script.timestep; }
+    uint32_t getTotalFrames() const { return script.warmupFrames + script.frames; }
+
+    // camera on the path at the given frame, a Catmull-Rom spline through the keyframes. Rotations
+    // are interpolated per angle, so keyframes should not wrap around
+    void cameraAt(uint32_t frame, glm::vec3 &position, glm::vec3 &rotation) const;
+
+    // once per rendered frame, warm up frames are dropped
+    void recordFrame(uint32_t frame, const FrameSample &sample);
+
+    // returns false if the file can't be written
+    bool writeJson(const std::string &path, const char *deviceName, VkExtent2D extent) const;
+
+   private:
+    void parse(const std::string &path);
+
+    std::string scriptPath;
+    Script script{};
+    std::vector<FrameSample> samples;
+};
+
+}  // namespace sve
@@ -0,0 +1,139 @@
+#include "sve_bindless.hpp"
+
+#include "sve_command_counters.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace sve {
+
+uint32_t SveBindlessSet::SlotAllocator::allocate() {
+    if (!freeSlots.empty()) {
+        uint32_t index = freeSlots.back();
+        freeSlots.pop_back();
+        return index;
+    }
+    if (next >= capacity) {
+        throw std::runtime_error("bindless descriptor array is full!");
+    }
+    return next++;
+}
+
+void SveBindlessSet::SlotAllocator::release(uint32_t index) {
+    assert(index < next && "Releasing a bindless slot that was never allocated");
+    freeSlots.push_back(index);
+}
+
+SveBindlessSet::SveBindlessSet(
+    SveDevice &device, uint32_t maxSampledImages, uint32_t maxSamplers, uint32_t maxStorageBuffers)
+    : sveDevice{device} {
+    if (!sveDevice.supportsBindless()) {
+        throw std::runtime_error("bindless descriptors require Vulkan 1.2 descriptor indexing!");
+    }
+
+    // stay inside the update-after-bind limits, they are much lower than the regular ones on some drivers
+    const auto &limits = sveDevice.descriptorIndexingProperties;
+    sampledImages.capacity = std::min({
+        maxSampledImages,
+        limits.maxDescriptorSetUpdateAfterBindSampledImages,
+        limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+    });
+    samplers.capacity = std::min({
+        maxSamplers,
+        limits.maxDescriptorSetUpdateAfterBindSamplers,
+        limits.maxPerStageDescriptorUpdateAfterBindSamplers,
+    });
+    storageBuffers.capacity = std::min({
+        maxStorageBuffers,
+        limits.maxDescriptorSetUpdateAfterBindStorageBuffers,
+        limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+    });
+
+    const VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                                                  VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                                                  VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+    setLayout = SveDescriptorSetLayout::Builder(sveDevice)
+                    .addBinding(SAMPLED_IMAGE_BINDING, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_SHADER_STAGE_ALL, sampledImages.capacity)
+                    .addBinding(SAMPLER_BINDING, VK_DESCRIPTOR_TYPE_SAMPLER, VK_SHADER_STAGE_ALL, samplers.capacity)
+                    .addBinding(STORAGE_BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_ALL, storageBuffers.capacity)
+                    .setBindingFlags(SAMPLED_IMAGE_BINDING, bindingFlags)
+                    .setBindingFlags(SAMPLER_BINDING, bindingFlags)
+                    .setBindingFlags(STORAGE_BUFFER_BINDING, bindingFlags)
+                    .setFlags(VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT)
+                    .build();
+
+    pool = SveDescriptorPool::Builder(sveDevice)
+               .setMaxSets(1)
+               .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+               .addPoolSize(VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, sampledImages.capacity)
+               .addPoolSize(VK_DESCRIPTOR_TYPE_SAMPLER, samplers.capacity)
+               .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, storageBuffers.capacity)
+               .build();
+
+    if (!pool->allocateDescriptor(setLayout->getDescriptorSetLayout(), descriptorSet)) {
+        throw std::runtime_error("failed to allocate bindless descriptor set!");
+    }
+}
+
+SveBindlessSet::~SveBindlessSet() {}  // set is freed with its pool
+
+uint32_t SveBindlessSet::registerSampledImage(VkImageView imageView, VkImageLayout imageLayout) {
+    uint32_t index = sampledImages.allocate();
+    VkDescriptorImageInfo imageInfo{VK_NULL_HANDLE, imageView, imageLayout};
+    write(SAMPLED_IMAGE_BINDING, index, &imageInfo, nullptr);
+    return index;
+}
+
+uint32_t SveBindlessSet::registerSampler(VkSampler sampler) {
+    uint32_t index = samplers.allocate();
+    VkDescriptorImageInfo imageInfo{sampler, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_UNDEFINED};
+    write(SAMPLER_BINDING, index, &imageInfo, nullptr);
+    return index;
+}
+
+uint32_t SveBindlessSet::registerStorageBuffer(const VkDescriptorBufferInfo &bufferInfo) {
+    uint32_t index = storageBuffers.allocate();
+    write(STORAGE_BUFFER_BINDING, index, nullptr, &bufferInfo);
+    return index;
+}
+
+// update-after-bind lets this run while the set is bound in command buffers still in flight,
+// as long as those don't access the slot being written
+void SveBindlessSet::write(
+    uint32_t binding, uint32_t index, const VkDescriptorImageInfo *imageInfo, const VkDescriptorBufferInfo *bufferInfo) {
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = descriptorSet;
+    write.dstBinding = binding;
+    write.dstArrayElement = index;
+    write.descriptorCount = 1;
+    switch (binding) {
+        case SAMPLED_IMAGE_BINDING:
+            write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            break;
+        case SAMPLER_BINDING:
+            write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+            break;
+        default:
+            write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            break;
+    }
+    write.pImageInfo = imageInfo;
+    write.pBufferInfo = bufferInfo;
+
+    vkUpdateDescriptorSets(sveDevice.device(), 1, &write, 0, nullptr);
+}
+
+void SveBindlessSet::bind(
+    VkCommandBuffer commandBuffer,
+    VkPipelineLayout pipelineLayout,
+    uint32_t set,
+    VkPipelineBindPoint bindPoint) {
+    SveCommandCounters::bindDescriptorSets(
+        commandBuffer, bindPoint, pipelineLayout, set, 1, &descriptorSet, 0, nullptr);
+}
+
+}  // namespace sve
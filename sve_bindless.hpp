@@ -0,0 +1,73 @@
+#pragma once
+
+#include "sve_descriptors.hpp"
+#include "sve_device.hpp"
+
+// std
+#include <memory>
+#include <vector>
+
+namespace sve {
+
+// One global descriptor set holding large partially bound, update-after-bind arrays of sampled
+// images, samplers and storage buffers. Resources get a stable index when registered and shaders
+// index the arrays with it (see shaders/bindless.glsl), so the set is bound once per frame
+class SveBindlessSet {
+   public:
+    static constexpr uint32_t SAMPLED_IMAGE_BINDING = 0;
+    static constexpr uint32_t SAMPLER_BINDING = 1;
+    static constexpr uint32_t STORAGE_BUFFER_BINDING = 2;
+    static constexpr uint32_t INVALID_INDEX = ~0u;
+
+    SveBindlessSet(
+        SveDevice &device,
+        uint32_t maxSampledImages = 16384,
+        uint32_t maxSamplers = 256,
+        uint32_t maxStorageBuffers = 4096);
+    ~SveBindlessSet();
+
+    SveBindlessSet(const SveBindlessSet &) = delete;
+    SveBindlessSet &operator=(const SveBindlessSet &) = delete;
+
+    uint32_t registerSampledImage(VkImageView imageView, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    uint32_t registerSampler(VkSampler sampler);
+    uint32_t registerStorageBuffer(const VkDescriptorBufferInfo &bufferInfo);
+
+    // slots are recycled, caller must make sure no in-flight frame still indexes them
+    void releaseSampledImage(uint32_t index) { sampledImages.release(index); }
+    void releaseSampler(uint32_t index) { samplers.release(index); }
+    void releaseStorageBuffer(uint32_t index) { storageBuffers.release(index); }
+
+    void bind(
+        VkCommandBuffer commandBuffer,
+        VkPipelineLayout pipelineLayout,
+        uint32_t set,
+        VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS);
+
+    VkDescriptorSetLayout getDescriptorSetLayout() const { return setLayout->getDescriptorSetLayout(); }
+    VkDescriptorSet getDescriptorSet() const { return descriptorSet; }
+
+   private:
+    // hands out array slots, reusing released ones first so indices stay dense
+    struct SlotAllocator {
+        uint32_t capacity = 0;
+        uint32_t next = 0;
+        std::vector<uint32_t> freeSlots{};
+
+        uint32_t allocate();
+        void release(uint32_t index);
+    };
+
+    void write(uint32_t binding, uint32_t index, const VkDescriptorImageInfo *imageInfo, const VkDescriptorBufferInfo *bufferInfo);
+
+    SveDevice &sveDevice;
+    std::unique_ptr<SveDescriptorSetLayout> setLayout;
+    std::unique_ptr<SveDescriptorPool> pool;
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+    SlotAllocator sampledImages;
+    SlotAllocator samplers;
+    SlotAllocator storageBuffers;
+};
+
+}  // namespace sve
@@ -43,18 +43,23 @@ SveBuffer::SveBuffer(
       memoryPropertyFlags{memoryPropertyFlags} {
     alignmentSize = getAlignment(instanceSize, minOffsetAlignment);
     bufferSize = alignmentSize * instanceCount;
-    device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, memory);
+    device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, allocation);
 }
 
 SveBuffer::~SveBuffer() {
     unmap();
-    vkDestroyBuffer(sveDevice.device(), buffer, nullptr);
-    vkFreeMemory(sveDevice.device(), memory, nullptr);
+    // a frame in flight may still read it
+    sveDevice.deferDestruction([&device = sveDevice, buffer = buffer, allocation = allocation]() mutable {
+        device.destroyBuffer(buffer, allocation);
+    });
 }
 
 /**
  * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
  *
+ * @note Host visible memory is persistently mapped by the device allocator, so this only hands
+ * out a pointer into that mapping
+ *
  * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
  * buffer range.
  * @param offset (Optional) Byte offset from beginning
@@ -62,21 +67,20 @@ SveBuffer::~SveBuffer() {
  * @return VkResult of the buffer mapping call
  */
 VkResult SveBuffer::map(VkDeviceSize size, VkDeviceSize offset) {
-    assert(buffer && memory && "Called map on buffer before create");
-    return vkMapMemory(sveDevice.device(), memory, offset, size, 0, &mapped);
+    assert(buffer && allocation.memory && "Called map on buffer before create");
+    if (allocation.mapped == nullptr) {
+        return VK_ERROR_MEMORY_MAP_FAILED;
+    }
+    mapped = static_cast<char *>(allocation.mapped) + offset;
+    return VK_SUCCESS;
 }
 
 /**
  * Unmap a mapped memory range
  *
- * @note Does not return a result as vkUnmapMemory can't fail
+ * @note The underlying memory block stays mapped, this just drops the pointer
  */
-void SveBuffer::unmap() {
-    if (mapped) {
-        vkUnmapMemory(sveDevice.device(), memory);
-        mapped = nullptr;
-    }
-}
+void SveBuffer::unmap() { mapped = nullptr; }
 
 /**
  * Copies the specified data to the mapped buffer. Default value writes whole buffer range
@@ -102,7 +106,8 @@ void SveBuffer::writeToBuffer(void *data, VkDeviceSize size, VkDeviceSize offset
 /**
  * Flush a memory range of the buffer to make it visible to the device
  *
- * @note Only required for non-coherent memory
+ * @note Only required for non-coherent memory, the allocator skips it otherwise and handles
+ * nonCoherentAtomSize alignment
  *
  * @param size (Optional) Size of the memory range to flush. Pass VK_WHOLE_SIZE to flush the
  * complete buffer range.
@@ -111,12 +116,7 @@ void SveBuffer::writeToBuffer(void *data, VkDeviceSize size, VkDeviceSize offset
  * @return VkResult of the flush call
  */
 VkResult SveBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
-    VkMappedMemoryRange mappedRange = {};
-    mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-    mappedRange.memory = memory;
-    mappedRange.offset = offset;
-    mappedRange.size = size;
-    return vkFlushMappedMemoryRanges(sveDevice.device(), 1, &mappedRange);
+    return sveDevice.allocator().flush(allocation, offset, size);
 }
 
 /**
@@ -131,12 +131,7 @@ VkResult SveBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
  * @return VkResult of the invalidate call
  */
 VkResult SveBuffer::invalidate(VkDeviceSize size, VkDeviceSize offset) {
-    VkMappedMemoryRange mappedRange = {};
-    mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-    mappedRange.memory = memory;
-    mappedRange.offset = offset;
-    mappedRange.size = size;
-    return vkInvalidateMappedMemoryRanges(sveDevice.device(), 1, &mappedRange);
+    return sveDevice.allocator().invalidate(allocation, offset, size);
 }
 
 /**
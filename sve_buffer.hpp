@@ -38,15 +38,16 @@ class SveBuffer {
     VkDeviceSize getAlignmentSize() const { return instanceSize; }
     VkBufferUsageFlags getUsageFlags() const { return usageFlags; }
     VkMemoryPropertyFlags getMemoryPropertyFlags() const { return memoryPropertyFlags; }
+    const SveAllocation& getAllocation() const { return allocation; }
     VkDeviceSize getBufferSize() const { return bufferSize; }
 
-   private:
     static VkDeviceSize getAlignment(VkDeviceSize instanceSize, VkDeviceSize minOffsetAlignment);
 
+   private:
     SveDevice& sveDevice;
     void* mapped = nullptr;
     VkBuffer buffer = VK_NULL_HANDLE;
-    VkDeviceMemory memory = VK_NULL_HANDLE;
+    SveAllocation allocation{};
 
     VkDeviceSize bufferSize;
     uint32_t instanceCount;
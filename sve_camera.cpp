@@ -18,6 +18,8 @@ void SveCamera::setOrthographicProjection(float left, float right, float top, fl
     projectionMatrix[3][0] = -(right + left) / (right - left);
     projectionMatrix[3][1] = -(bottom + top) / (bottom - top);
     projectionMatrix[3][2] = -near / (far - near);
+    nearPlane = near;
+    farPlane = far;
 }
 
 void SveCamera::setPerspectiveProjection(float fovy, float aspect, float near, float far) {
@@ -31,6 +33,8 @@ void SveCamera::setPerspectiveProjection(float fovy, float aspect, float near, f
     projectionMatrix[2][2] = far / (far - near);
     projectionMatrix[2][3] = 1.f;
     projectionMatrix[3][2] = -(far * near) / (far - near);
+    nearPlane = near;
+    farPlane = far;
 }
 
 void SveCamera::setViewDirection(glm::vec3 position, glm::vec3 direction, glm::vec3 up) {
@@ -19,10 +19,14 @@ class SveCamera {
 
     const glm::mat4 &getProjection() const { return projectionMatrix; }
     const glm::mat4 &getView() const { return viewMatrix; }
+    float getNear() const { return nearPlane; }
+    float getFar() const { return farPlane; }
 
    private:
     glm::mat4 projectionMatrix{1.f};
     glm::mat4 viewMatrix{1.f};
+    float nearPlane{.1f};
+    float farPlane{100.f};
 };
 
 }  // namespace sve
\ No newline at end of file
@@ -0,0 +1,207 @@
+#include "sve_command_counters.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace sve {
+
+bool SveCommandCounters::enabled = false;
+bool SveCommandCounters::requestedEnabled = false;
+std::vector<SveCommandCounters::ScopeCounts> SveCommandCounters::frame{{"unscoped", Counts{}}};
+std::vector<SveCommandCounters::ScopeCounts> SveCommandCounters::lastFrame{};
+std::vector<size_t> SveCommandCounters::scopeStack{};
+SveCommandCounters::BoundState SveCommandCounters::bound{};
+
+const char *SveCommandCounters::categoryName(Category category) {
+    switch (category) {
+        case PipelineBinds:
+            return "pipeline binds";
+        case VertexBufferBinds:
+            return "vertex buffer binds";
+        case IndexBufferBinds:
+            return "index buffer binds";
+        case DescriptorSetBinds:
+            return "descriptor set binds";
+        case PushConstants:
+            return "push constants";
+        case Draws:
+            return "draws";
+        case Copies:
+            return "copies";
+        case Barriers:
+            return "barriers";
+        case Submits:
+            return "submits";
+        default:
+            return "unknown";
+    }
+}
+
+void SveCommandCounters::beginFrame() {
+    assert(scopeStack.empty() && "Command scope left open across frames");
+    if (enabled) {
+        lastFrame = frame;
+    } else {
+        lastFrame.clear();
+    }
+    for (auto &scope : frame) {
+        scope.counts = {};
+    }
+    // nothing is known to be bound in the next frame's command buffers
+    bound = {};
+    enabled = requestedEnabled;
+}
+
+SveCommandCounters::Counts SveCommandCounters::getLastFrameTotal() {
+    Counts total{};
+    for (const auto &scope : lastFrame) {
+        for (uint32_t i = 0; i < CATEGORY_COUNT; i++) {
+            total.calls[i] += scope.counts.calls[i];
+            total.redundant[i] += scope.counts.redundant[i];
+        }
+    }
+    return total;
+}
+
+void SveCommandCounters::pushScope(const char *name) {
+    if (!enabled) {
+        return;
+    }
+    // a handful of render systems, a linear search is fine
+    auto it = std::find_if(frame.begin(), frame.end(), [&](const ScopeCounts &scope) {
+        return std::strcmp(scope.name, name) == 0;
+    });
+    if (it == frame.end()) {
+        frame.push_back({name, {}});
+        it = frame.end() - 1;
+    }
+    scopeStack.push_back(static_cast<size_t>(it - frame.begin()));
+}
+
+void SveCommandCounters::popScope() {
+    if (!enabled) {
+        return;
+    }
+    assert(!scopeStack.empty() && "Command scope popped without a push");
+    scopeStack.pop_back();
+}
+
+SveCommandCounters::BoundState &SveCommandCounters::boundState(VkCommandBuffer commandBuffer) {
+    // bindings don't carry over between command buffers
+    if (bound.commandBuffer != commandBuffer) {
+        bound = {};
+        bound.commandBuffer = commandBuffer;
+    }
+    return bound;
+}
+
+void SveCommandCounters::countPipelineBind(
+    VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipeline pipeline) {
+    auto &counts = current();
+    counts.calls[PipelineBinds]++;
+    auto &bound = boundState(commandBuffer).pipelines[bindPoint == VK_PIPELINE_BIND_POINT_COMPUTE ? 1 : 0];
+    if (bound == pipeline) {
+        counts.redundant[PipelineBinds]++;
+    }
+    bound = pipeline;
+}
+
+void SveCommandCounters::countVertexBufferBind(
+    VkCommandBuffer commandBuffer,
+    uint32_t firstBinding,
+    uint32_t bindingCount,
+    const VkBuffer *buffers,
+    const VkDeviceSize *offsets) {
+    auto &counts = current();
+    counts.calls[VertexBufferBinds]++;
+    auto &state = boundState(commandBuffer);
+    bool redundant = firstBinding + bindingCount <= MAX_TRACKED_BINDINGS;
+    for (uint32_t i = 0; i < bindingCount && firstBinding + i < MAX_TRACKED_BINDINGS; i++) {
+        uint32_t binding = firstBinding + i;
+        redundant =
+            redundant && state.vertexBuffers[binding] == buffers[i] && state.vertexOffsets[binding] == offsets[i];
+        state.vertexBuffers[binding] = buffers[i];
+        state.vertexOffsets[binding] = offsets[i];
+    }
+    if (redundant) {
+        counts.redundant[VertexBufferBinds]++;
+    }
+}
+
+void SveCommandCounters::countIndexBufferBind(
+    VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType) {
+    auto &counts = current();
+    counts.calls[IndexBufferBinds]++;
+    auto &state = boundState(commandBuffer);
+    if (state.indexBuffer == buffer && state.indexOffset == offset && state.indexType == indexType) {
+        counts.redundant[IndexBufferBinds]++;
+    }
+    state.indexBuffer = buffer;
+    state.indexOffset = offset;
+    state.indexType = indexType;
+}
+
+void SveCommandCounters::countDescriptorSetBind(
+    VkCommandBuffer commandBuffer,
+    VkPipelineBindPoint bindPoint,
+    VkPipelineLayout layout,
+    uint32_t firstSet,
+    uint32_t setCount,
+    const VkDescriptorSet *sets,
+    uint32_t dynamicOffsetCount,
+    const uint32_t *dynamicOffsets) {
+    auto &counts = current();
+    counts.calls[DescriptorSetBinds]++;
+    auto &state = boundState(commandBuffer);
+    if (setCount > MAX_TRACKED_SETS || dynamicOffsetCount > MAX_TRACKED_DYNAMIC_OFFSETS) {
+        state.setLayout = VK_NULL_HANDLE;  // too big to track, never redundant
+        return;
+    }
+
+    bool redundant = state.setLayout == layout && state.setBindPoint == bindPoint && state.firstSet == firstSet &&
+                     state.setCount == setCount && state.dynamicOffsetCount == dynamicOffsetCount &&
+                     std::equal(sets, sets + setCount, state.sets.begin()) &&
+                     std::equal(dynamicOffsets, dynamicOffsets + dynamicOffsetCount, state.dynamicOffsets.begin());
+    if (redundant) {
+        counts.redundant[DescriptorSetBinds]++;
+        return;
+    }
+    state.setBindPoint = bindPoint;
+    state.setLayout = layout;
+    state.firstSet = firstSet;
+    state.setCount = setCount;
+    std::copy(sets, sets + setCount, state.sets.begin());
+    state.dynamicOffsetCount = dynamicOffsetCount;
+    std::copy(dynamicOffsets, dynamicOffsets + dynamicOffsetCount, state.dynamicOffsets.begin());
+}
+
+void SveCommandCounters::countPushConstants(
+    VkCommandBuffer commandBuffer,
+    VkPipelineLayout layout,
+    VkShaderStageFlags stages,
+    uint32_t offset,
+    uint32_t size,
+    const void *values) {
+    auto &counts = current();
+    counts.calls[PushConstants]++;
+    auto &state = boundState(commandBuffer);
+    if (size > MAX_PUSH_CONSTANT_BYTES) {
+        state.pushLayout = VK_NULL_HANDLE;
+        return;
+    }
+
+    if (state.pushLayout == layout && state.pushStages == stages && state.pushOffset == offset &&
+        state.pushSize == size && std::memcmp(state.pushData.data(), values, size) == 0) {
+        counts.redundant[PushConstants]++;
+        return;
+    }
+    state.pushLayout = layout;
+    state.pushStages = stages;
+    state.pushOffset = offset;
+    state.pushSize = size;
+    std::memcpy(state.pushData.data(), values, size);
+}
+
+}  // namespace sve
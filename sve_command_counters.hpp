@@ -0,0 +1,236 @@
+#pragma once
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sve {
+
+// Per frame counts of recorded commands by category and by the render system that recorded them,
+// with redundant state changes flagged: a bind or push that sets exactly what the previous one in
+// the same command buffer already set. The engine's recording paths go through the wrappers below
+// instead of the vkCmd* functions; while counting is disabled a wrapper costs one predictable
+// branch, so it stays compiled in and is toggled at runtime. Counts are kept for a single
+// recording thread
+class SveCommandCounters {
+   public:
+    enum Category : uint32_t {
+        PipelineBinds,
+        VertexBufferBinds,
+        IndexBufferBinds,
+        DescriptorSetBinds,
+        PushConstants,
+        Draws,
+        Copies,
+        Barriers,
+        Submits,
+        CATEGORY_COUNT
+    };
+    struct Counts {
+        std::array<uint32_t, CATEGORY_COUNT> calls{};
+        std::array<uint32_t, CATEGORY_COUNT> redundant{};
+    };
+    struct ScopeCounts {
+        const char *name;  // of the SveCommandScope, "unscoped" for commands outside any
+        Counts counts;
+    };
+
+    // takes effect at the next beginFrame, so a frame is counted whole or not at all
+    static void setEnabled(bool enable) { requestedEnabled = enable; }
+    static bool isEnabled() { return requestedEnabled; }
+    static const char *categoryName(Category category);
+
+    // once per frame before recording, the counts since the last call become the last frame's
+    static void beginFrame();
+    static const std::vector<ScopeCounts> &getLastFrame() { return lastFrame; }
+    static Counts getLastFrameTotal();
+
+    // see SveCommandScope
+    static void pushScope(const char *name);
+    static void popScope();
+
+    // for calls without a wrapper, e.g. barriers and submits
+    static void count(Category category, uint32_t calls = 1) {
+        if (enabled) {
+            current().calls[category] += calls;
+        }
+    }
+
+    static void bindPipeline(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipeline pipeline) {
+        if (enabled) {
+            countPipelineBind(commandBuffer, bindPoint, pipeline);
+        }
+        vkCmdBindPipeline(commandBuffer, bindPoint, pipeline);
+    }
+    static void bindVertexBuffers(
+        VkCommandBuffer commandBuffer,
+        uint32_t firstBinding,
+        uint32_t bindingCount,
+        const VkBuffer *buffers,
+        const VkDeviceSize *offsets) {
+        if (enabled) {
+            countVertexBufferBind(commandBuffer, firstBinding, bindingCount, buffers, offsets);
+        }
+        vkCmdBindVertexBuffers(commandBuffer, firstBinding, bindingCount, buffers, offsets);
+    }
+    static void bindIndexBuffer(
+        VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType) {
+        if (enabled) {
+            countIndexBufferBind(commandBuffer, buffer, offset, indexType);
+        }
+        vkCmdBindIndexBuffer(commandBuffer, buffer, offset, indexType);
+    }
+    static void bindDescriptorSets(
+        VkCommandBuffer commandBuffer,
+        VkPipelineBindPoint bindPoint,
+        VkPipelineLayout layout,
+        uint32_t firstSet,
+        uint32_t setCount,
+        const VkDescriptorSet *sets,
+        uint32_t dynamicOffsetCount,
+        const uint32_t *dynamicOffsets) {
+        if (enabled) {
+            countDescriptorSetBind(
+                commandBuffer,
+                bindPoint,
+                layout,
+                firstSet,
+                setCount,
+                sets,
+                dynamicOffsetCount,
+                dynamicOffsets);
+        }
+        vkCmdBindDescriptorSets(
+            commandBuffer,
+            bindPoint,
+            layout,
+            firstSet,
+            setCount,
+            sets,
+            dynamicOffsetCount,
+            dynamicOffsets);
+    }
+    static void pushConstants(
+        VkCommandBuffer commandBuffer,
+        VkPipelineLayout layout,
+        VkShaderStageFlags stages,
+        uint32_t offset,
+        uint32_t size,
+        const void *values) {
+        if (enabled) {
+            countPushConstants(commandBuffer, layout, stages, offset, size, values);
+        }
+        vkCmdPushConstants(commandBuffer, layout, stages, offset, size, values);
+    }
+    static void draw(
+        VkCommandBuffer commandBuffer,
+        uint32_t vertexCount,
+        uint32_t instanceCount,
+        uint32_t firstVertex,
+        uint32_t firstInstance) {
+        count(Draws);
+        vkCmdDraw(commandBuffer, vertexCount, instanceCount, firstVertex, firstInstance);
+    }
+    static void drawIndexed(
+        VkCommandBuffer commandBuffer,
+        uint32_t indexCount,
+        uint32_t instanceCount,
+        uint32_t firstIndex,
+        int32_t vertexOffset,
+        uint32_t firstInstance) {
+        count(Draws);
+        vkCmdDrawIndexed(commandBuffer, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+    }
+    static void copyBuffer(
+        VkCommandBuffer commandBuffer,
+        VkBuffer srcBuffer,
+        VkBuffer dstBuffer,
+        uint32_t regionCount,
+        const VkBufferCopy *regions) {
+        count(Copies);
+        vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, regionCount, regions);
+    }
+
+   private:
+    static constexpr uint32_t MAX_TRACKED_BINDINGS = 4;
+    static constexpr uint32_t MAX_TRACKED_SETS = 4;
+    static constexpr uint32_t MAX_TRACKED_DYNAMIC_OFFSETS = 8;
+    static constexpr uint32_t MAX_PUSH_CONSTANT_BYTES = 128;
+
+    // what the command buffer being recorded has bound, reset when another one is recorded
+    struct BoundState {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        std::array<VkPipeline, 2> pipelines{};  // graphics and compute
+        std::array<VkBuffer, MAX_TRACKED_BINDINGS> vertexBuffers{};
+        std::array<VkDeviceSize, MAX_TRACKED_BINDINGS> vertexOffsets{};
+        VkBuffer indexBuffer = VK_NULL_HANDLE;
+        VkDeviceSize indexOffset = 0;
+        VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+        // the last descriptor bind and push in full, a call identical to it is redundant
+        VkPipelineBindPoint setBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        VkPipelineLayout setLayout = VK_NULL_HANDLE;
+        uint32_t firstSet = 0;
+        uint32_t setCount = 0;
+        std::array<VkDescriptorSet, MAX_TRACKED_SETS> sets{};
+        uint32_t dynamicOffsetCount = 0;
+        std::array<uint32_t, MAX_TRACKED_DYNAMIC_OFFSETS> dynamicOffsets{};
+        VkPipelineLayout pushLayout = VK_NULL_HANDLE;
+        VkShaderStageFlags pushStages = 0;
+        uint32_t pushOffset = 0;
+        uint32_t pushSize = 0;
+        std::array<uint8_t, MAX_PUSH_CONSTANT_BYTES> pushData{};
+    };
+
+    static Counts &current() { return frame[scopeStack.empty() ? 0 : scopeStack.back()].counts; }
+    static BoundState &boundState(VkCommandBuffer commandBuffer);
+
+    static void countPipelineBind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipeline pipeline);
+    static void countVertexBufferBind(
+        VkCommandBuffer commandBuffer,
+        uint32_t firstBinding,
+        uint32_t bindingCount,
+        const VkBuffer *buffers,
+        const VkDeviceSize *offsets);
+    static void countIndexBufferBind(
+        VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType);
+    static void countDescriptorSetBind(
+        VkCommandBuffer commandBuffer,
+        VkPipelineBindPoint bindPoint,
+        VkPipelineLayout layout,
+        uint32_t firstSet,
+        uint32_t setCount,
+        const VkDescriptorSet *sets,
+        uint32_t dynamicOffsetCount,
+        const uint32_t *dynamicOffsets);
+    static void countPushConstants(
+        VkCommandBuffer commandBuffer,
+        VkPipelineLayout layout,
+        VkShaderStageFlags stages,
+        uint32_t offset,
+        uint32_t size,
+        const void *values);
+
+    static bool enabled;
+    static bool requestedEnabled;
+    static std::vector<ScopeCounts> frame;  // first entry for unscoped commands
+    static std::vector<ScopeCounts> lastFrame;
+    static std::vector<size_t> scopeStack;  // indices into frame
+    static BoundState bound;
+};
+
+// attributes the commands recorded in its lifetime to a render system, scopes may nest
+class SveCommandScope {
+   public:
+    explicit SveCommandScope(const char *name) { SveCommandCounters::pushScope(name); }
+    ~SveCommandScope() { SveCommandCounters::popScope(); }
+
+    SveCommandScope(const SveCommandScope &) = delete;
+    SveCommandScope &operator=(const SveCommandScope &) = delete;
+};
+
+}  // namespace sve
@@ -0,0 +1,101 @@
+#include "sve_cpu_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace sve {
+
+struct ThreadBuffer {
+    uint32_t threadId = 0;
+    std::string name;  // guarded by the registry mutex
+    std::unique_ptr<SveCpuProfiler::Event[]> events{new SveCpuProfiler::Event[SveCpuProfiler::EVENTS_PER_THREAD]};
+    std::atomic<uint64_t> written{0};  // only the owning thread stores
+};
+
+// buffers outlive their threads, so zones of threads that already exited still end up in the trace
+struct ThreadRegistry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+};
+
+static ThreadRegistry &registry() {
+    static ThreadRegistry threadRegistry;
+    return threadRegistry;
+}
+
+static ThreadBuffer &threadBuffer() {
+    thread_local ThreadBuffer *buffer = nullptr;
+    if (buffer == nullptr) {
+        auto &threads = registry();
+        std::lock_guard<std::mutex> lock{threads.mutex};
+        threads.buffers.push_back(std::make_unique<ThreadBuffer>());
+        buffer = threads.buffers.back().get();
+        buffer->threadId = static_cast<uint32_t>(threads.buffers.size());
+    }
+    return *buffer;
+}
+
+void SveCpuProfiler::record(const char *name, uint64_t startNs, uint64_t endNs) {
+    auto &buffer = threadBuffer();
+    uint64_t index = buffer.written.load(std::memory_order_relaxed);
+    buffer.events[index % EVENTS_PER_THREAD] = {name, startNs, endNs};
+    buffer.written.store(index + 1, std::memory_order_release);
+}
+
+void SveCpuProfiler::setThreadName(const char *name) {
+    auto &buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock{registry().mutex};
+    buffer.name = name;
+}
+
+bool SveCpuProfiler::writeChromeTrace(const std::string &path) {
+    std::ofstream file{path};
+    if (!file) {
+        return false;
+    }
+
+    auto &threads = registry();
+    std::lock_guard<std::mutex> lock{threads.mutex};
+
+    // timestamps relative to the oldest zone, in microseconds as the format expects
+    uint64_t originNs = std::numeric_limits<uint64_t>::max();
+    for (const auto &buffer : threads.buffers) {
+        uint64_t written = buffer->written.load(std::memory_order_acquire);
+        uint64_t count = std::min<uint64_t>(written, EVENTS_PER_THREAD);
+        for (uint64_t i = written - count; i < written; i++) {
+            originNs = std::min(originNs, buffer->events[i % EVENTS_PER_THREAD].startNs);
+        }
+    }
+
+    // zone names are code literals and function names, no escaping needed
+    file << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool first = true;
+    for (const auto &buffer : threads.buffers) {
+        if (!buffer->name.empty()) {
+            file << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+                 << buffer->threadId << ", \"args\": {\"name\": \"" << buffer->name << "\"}}";
+            first = false;
+        }
+
+        uint64_t written = buffer->written.load(std::memory_order_acquire);
+        uint64_t count = std::min<uint64_t>(written, EVENTS_PER_THREAD);
+        for (uint64_t i = written - count; i < written; i++) {
+            const auto &event = buffer->events[i % EVENTS_PER_THREAD];
+            file << (first ? "" : ",\n") << "{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": "
+                 << buffer->threadId << ", \"ts\": " << static_cast<double>(event.startNs - originNs) * 1e-3
+                 << ", \"dur\": " << static_cast<double>(event.endNs - event.startNs) * 1e-3 << "}";
+            first = false;
+        }
+    }
+    file << "\n]}\n";
+    return static_cast<bool>(file);
+}
+
+}  // namespace sve
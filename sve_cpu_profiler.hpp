@@ -0,0 +1,70 @@
+#pragma once
+
+// std
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace sve {
+
+// CPU zone profiler. Every thread records finished zones into its own ring buffer, so recording
+// never locks and never allocates after a thread's first zone. Only the newest EVENTS_PER_THREAD
+// zones of each thread are kept. The trace opens in chrome://tracing or ui.perfetto.dev.
+// Zones are added with the SVE_PROFILE_* macros below, which compile to nothing unless
+// SVE_ENABLE_PROFILER is defined (make PROFILE=1)
+class SveCpuProfiler {
+   public:
+#ifdef SVE_ENABLE_PROFILER
+    static constexpr bool ENABLED = true;
+#else
+    static constexpr bool ENABLED = false;
+#endif
+    static constexpr size_t EVENTS_PER_THREAD = 1 << 16;
+
+    struct Event {
+        const char *name;  // must outlive the trace export, e.g. a literal
+        uint64_t startNs;
+        uint64_t endNs;
+    };
+
+    static uint64_t now() {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+                .count());
+    }
+    static void record(const char *name, uint64_t startNs, uint64_t endNs);
+    static void setThreadName(const char *name);
+
+    // export while other threads are idle, a thread recording meanwhile may tear its oldest zones.
+    // Returns false if the file can't be written
+    static bool writeChromeTrace(const std::string &path);
+};
+
+class SveCpuProfileScope {
+   public:
+    explicit SveCpuProfileScope(const char *name) : name{name}, startNs{SveCpuProfiler::now()} {}
+    ~SveCpuProfileScope() { SveCpuProfiler::record(name, startNs, SveCpuProfiler::now()); }
+
+    SveCpuProfileScope(const SveCpuProfileScope &) = delete;
+    SveCpuProfileScope &operator=(const SveCpuProfileScope &) = delete;
+
+   private:
+    const char *name;
+    uint64_t startNs;
+};
+
+}  // namespace sve
+
+#ifdef SVE_ENABLE_PROFILER
+#define SVE_PROFILE_CONCAT_INNER(a, b) a##b
+#define SVE_PROFILE_CONCAT(a, b) SVE_PROFILE_CONCAT_INNER(a, b)
+// zone from here to the end of the enclosing block
+#define SVE_PROFILE_SCOPE(name) ::sve::SveCpuProfileScope SVE_PROFILE_CONCAT(sveProfileScope, __LINE__){name}
+#define SVE_PROFILE_FUNCTION() SVE_PROFILE_SCOPE(__func__)
+#define SVE_PROFILE_THREAD(name) ::sve::SveCpuProfiler::setThreadName(name)
+#else
+#define SVE_PROFILE_SCOPE(name) ((void)0)
+#define SVE_PROFILE_FUNCTION() ((void)0)
+#define SVE_PROFILE_THREAD(name) ((void)0)
+#endif
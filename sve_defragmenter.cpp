@@ -0,0 +1,82 @@
+#include "sve_defragmenter.hpp"
+
+#include "sve_command_counters.hpp"
+
+// std
+#include <algorithm>
+
+namespace sve {
+
+SveDefragmenter::SveDefragmenter(
+    SveDevice &device, VkDeviceSize bytesPerFrame, float maxOccupancy, uint32_t scanInterval)
+    : sveDevice{device}, bytesPerFrame{bytesPerFrame}, maxOccupancy{maxOccupancy}, scanInterval{scanInterval} {}
+
+SveDefragmenter::~SveDefragmenter() {
+    if (sveDevice.allocator().isDefragmenting()) {
+        sveDevice.allocator().endDefragmentation();
+    }
+}
+
+void SveDefragmenter::recordRelocations(FrameInfo &frameInfo) {
+    if (!enabled) {
+        return;
+    }
+
+    auto &allocator = sveDevice.allocator();
+    if (!allocator.isDefragmenting()) {
+        if (++framesSinceScan < scanInterval) {
+            return;
+        }
+        framesSinceScan = 0;
+        if (allocator.beginDefragmentation(maxOccupancy) == 0) {
+            return;
+        }
+    }
+
+    VkDeviceSize budget = bytesPerFrame;
+    bool pending = false;
+    bool moved = false;
+    for (auto &kv : frameInfo.gameObjects) {
+        auto &model = kv.second.model;
+        if (model == nullptr || !model->needsRelocation()) {
+            continue;
+        }
+        // always make progress, but never go over budget once something has been moved this frame
+        if (moved && model->getRelocationSize() > budget) {
+            pending = true;
+            break;
+        }
+        VkDeviceSize bytes = model->relocate(frameInfo.commandBuffer, stats.buffersMoved);
+        budget -= std::min(budget, bytes);
+        stats.bytesMoved += bytes;
+        moved = true;
+    }
+
+    if (moved) {
+        // copies must land before this frame's draws pull vertices and indices from the new buffers
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+        SveCommandCounters::count(SveCommandCounters::Barriers);
+        vkCmdPipelineBarrier(
+            frameInfo.commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+            0,
+            1,
+            &barrier,
+            0,
+            nullptr,
+            0,
+            nullptr);
+    }
+
+    // anything left in the draining blocks isn't relocatable, let them be used again
+    if (!moved && !pending) {
+        allocator.endDefragmentation();
+        stats.passes++;
+    }
+}
+
+}  // namespace sve
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "sve_buffer.hpp"
+#include "sve_device.hpp"
+#include "sve_frame_info.hpp"
+
+namespace sve {
+
+// Compacts device memory over long sessions by moving model buffers out of sparsely used blocks.
+// Every few frames the allocator is asked to mark sparse blocks as draining; the buffers living in
+// them are then copied into fresh allocations a few megabytes per frame, recorded at the start of
+// the frame's command buffer. Models pick up the new buffers immediately (the draws recorded later
+// in the same command buffer already use them) and the old ones go through SveBuffer's deferred
+// destruction, so they outlive every frame that can still reference them
+class SveDefragmenter {
+   public:
+    struct Stats {
+        VkDeviceSize bytesMoved = 0;
+        uint32_t buffersMoved = 0;
+        uint32_t passes = 0;  // completed defragmentation passes
+    };
+
+    SveDefragmenter(
+        SveDevice &device,
+        VkDeviceSize bytesPerFrame = 8ull << 20,
+        float maxOccupancy = .25f,
+        uint32_t scanInterval = 300);
+    ~SveDefragmenter();
+
+    SveDefragmenter(const SveDefragmenter &) = delete;
+    SveDefragmenter &operator=(const SveDefragmenter &) = delete;
+
+    // call after beginFrame and before the render pass is started
+    void recordRelocations(FrameInfo &frameInfo);
+
+    void setEnabled(bool value) { enabled = value; }
+    bool isEnabled() const { return enabled; }
+    const Stats &getStats() const { return stats; }
+
+   private:
+    SveDevice &sveDevice;
+    VkDeviceSize bytesPerFrame;
+    float maxOccupancy;
+    uint32_t scanInterval;
+    uint32_t framesSinceScan = 0;
+    bool enabled = true;
+
+    Stats stats{};
+};
+
+}  // namespace sve
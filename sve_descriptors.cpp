@@ -1,7 +1,11 @@
 #include "sve_descriptors.hpp"
 
+#include "sve_utils.hpp"
+
 // std
+#include <algorithm>
 #include <cassert>
+#include <functional>
 #include <stdexcept>
 
 namespace sve {
@@ -23,24 +27,60 @@ SveDescriptorSetLayout::Builder &SveDescriptorSetLayout::Builder::addBinding(
     return *this;
 }
 
+SveDescriptorSetLayout::Builder &SveDescriptorSetLayout::Builder::setFlags(
+    VkDescriptorSetLayoutCreateFlags flags) {
+    this->flags = flags;
+    return *this;
+}
+
+SveDescriptorSetLayout::Builder &SveDescriptorSetLayout::Builder::setBindingFlags(
+    uint32_t binding, VkDescriptorBindingFlags bindingFlags) {
+    assert(bindings.count(binding) == 1 && "Binding flags set for a binding that was never added");
+    this->bindingFlags[binding] = bindingFlags;
+    return *this;
+}
+
 std::unique_ptr<SveDescriptorSetLayout> SveDescriptorSetLayout::Builder::build() const {
-    return std::make_unique<SveDescriptorSetLayout>(sveDevice, bindings);
+    return std::make_unique<SveDescriptorSetLayout>(sveDevice, bindings, flags, bindingFlags);
+}
+
+std::shared_ptr<SveDescriptorSetLayout> SveDescriptorSetLayout::Builder::build(
+    SveDescriptorLayoutCache &cache) const {
+    return cache.getLayout(bindings, flags, bindingFlags);
 }
 
 // *************** Descriptor Set Layout *********************
 
 SveDescriptorSetLayout::SveDescriptorSetLayout(
-    SveDevice &sveDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings)
-    : sveDevice{sveDevice}, bindings{bindings} {
+    SveDevice &sveDevice,
+    std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+    VkDescriptorSetLayoutCreateFlags flags,
+    const std::unordered_map<uint32_t, VkDescriptorBindingFlags> &bindingFlags)
+    : sveDevice{sveDevice}, bindings{bindings}, flags{flags} {
+    assert(
+        (!isPushDescriptor() || sveDevice.supportsPushDescriptors()) &&
+        "Push descriptor layout requires VK_KHR_push_descriptor");
+
     std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+    std::vector<VkDescriptorBindingFlags> setLayoutBindingFlags{};
     for (auto kv : bindings) {
         setLayoutBindings.push_back(kv.second);
+        auto flagsIt = bindingFlags.find(kv.first);
+        setLayoutBindingFlags.push_back(flagsIt != bindingFlags.end() ? flagsIt->second : 0);
     }
 
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsInfo.bindingCount = static_cast<uint32_t>(setLayoutBindingFlags.size());
+    bindingFlagsInfo.pBindingFlags = setLayoutBindingFlags.data();
+
     VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
     descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
     descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
     descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
+    descriptorSetLayoutInfo.flags = flags;
+    // only chain binding flags when used, the struct needs Vulkan 1.2
+    descriptorSetLayoutInfo.pNext = bindingFlags.empty() ? nullptr : &bindingFlagsInfo;
 
     if (vkCreateDescriptorSetLayout(
             sveDevice.device(),
@@ -55,6 +95,181 @@ SveDescriptorSetLayout::~SveDescriptorSetLayout() {
     vkDestroyDescriptorSetLayout(sveDevice.device(), descriptorSetLayout, nullptr);
 }
 
+// *************** Descriptor Update Template Builder *********************
+
+SveDescriptorUpdateTemplate::Builder &SveDescriptorUpdateTemplate::Builder::addEntry(
+    uint32_t binding, size_t offset, size_t stride, uint32_t count) {
+    // descriptor type and default stride are filled in from the layout on creation
+    VkDescriptorUpdateTemplateEntry entry{};
+    entry.dstBinding = binding;
+    entry.dstArrayElement = 0;
+    entry.descriptorCount = count;
+    entry.offset = offset;
+    entry.stride = stride;
+    entries.push_back(entry);
+    return *this;
+}
+
+std::unique_ptr<SveDescriptorUpdateTemplate> SveDescriptorUpdateTemplate::Builder::build() const {
+    assert(!setLayout.isPushDescriptor() && "Use buildForPush for push descriptor layouts");
+    return std::make_unique<SveDescriptorUpdateTemplate>(
+        setLayout,
+        entries,
+        VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET);
+}
+
+std::unique_ptr<SveDescriptorUpdateTemplate> SveDescriptorUpdateTemplate::Builder::buildForPush(
+    VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t set) const {
+    assert(setLayout.isPushDescriptor() && "Layout was not created with the push descriptor flag");
+    return std::make_unique<SveDescriptorUpdateTemplate>(
+        setLayout,
+        entries,
+        VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR,
+        bindPoint,
+        pipelineLayout,
+        set);
+}
+
+// *************** Descriptor Update Template *********************
+
+SveDescriptorUpdateTemplate::SveDescriptorUpdateTemplate(
+    SveDescriptorSetLayout &setLayout,
+    const std::vector<VkDescriptorUpdateTemplateEntry> &entries,
+    VkDescriptorUpdateTemplateType templateType,
+    VkPipelineBindPoint bindPoint,
+    VkPipelineLayout pipelineLayout,
+    uint32_t set)
+    : sveDevice{setLayout.sveDevice}, templateType{templateType}, pipelineLayout{pipelineLayout}, set{set} {
+    std::vector<VkDescriptorUpdateTemplateEntry> templateEntries{entries};
+    for (auto &entry : templateEntries) {
+        assert(setLayout.bindings.count(entry.dstBinding) == 1 && "Layout does not contain specified binding");
+
+        auto &bindingDescription = setLayout.bindings[entry.dstBinding];
+        assert(
+            entry.descriptorCount <= bindingDescription.descriptorCount &&
+            "Entry writes more descriptors than binding holds");
+
+        entry.descriptorType = bindingDescription.descriptorType;
+        if (entry.stride == 0) {
+            switch (entry.descriptorType) {
+                case VK_DESCRIPTOR_TYPE_SAMPLER:
+                case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+                case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+                case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+                case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+                    entry.stride = sizeof(VkDescriptorImageInfo);
+                    break;
+                case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+                case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+                    entry.stride = sizeof(VkBufferView);
+                    break;
+                default:
+                    entry.stride = sizeof(VkDescriptorBufferInfo);
+                    break;
+            }
+        }
+    }
+
+    VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+    templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+    templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(templateEntries.size());
+    templateInfo.pDescriptorUpdateEntries = templateEntries.data();
+    templateInfo.templateType = templateType;
+    templateInfo.descriptorSetLayout = setLayout.getDescriptorSetLayout();
+    templateInfo.pipelineBindPoint = bindPoint;
+    templateInfo.pipelineLayout = pipelineLayout;
+    templateInfo.set = set;
+
+    if (vkCreateDescriptorUpdateTemplate(sveDevice.device(), &templateInfo, nullptr, &updateTemplate) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor update template!");
+    }
+}
+
+SveDescriptorUpdateTemplate::~SveDescriptorUpdateTemplate() {
+    vkDestroyDescriptorUpdateTemplate(sveDevice.device(), updateTemplate, nullptr);
+}
+
+void SveDescriptorUpdateTemplate::update(VkDescriptorSet set, const void *data) const {
+    assert(templateType == VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET && "Push template cannot update sets");
+    vkUpdateDescriptorSetWithTemplate(sveDevice.device(), set, updateTemplate, data);
+}
+
+void SveDescriptorUpdateTemplate::push(VkCommandBuffer commandBuffer, const void *data) const {
+    assert(
+        templateType == VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR &&
+        "Template was not built for push descriptors");
+    sveDevice.cmdPushDescriptorSetWithTemplate(commandBuffer, updateTemplate, pipelineLayout, set, data);
+}
+
+// *************** Descriptor Layout Cache *********************
+
+bool SveDescriptorLayoutCache::LayoutKey::operator==(const LayoutKey &other) const {
+    if (flags != other.flags || bindings.size() != other.bindings.size() || bindingFlags != other.bindingFlags) {
+        return false;
+    }
+    for (size_t i = 0; i < bindings.size(); i++) {
+        const auto &a = bindings[i];
+        const auto &b = other.bindings[i];
+        if (a.binding != b.binding || a.descriptorType != b.descriptorType ||
+            a.descriptorCount != b.descriptorCount || a.stageFlags != b.stageFlags ||
+            a.pImmutableSamplers != b.pImmutableSamplers) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t SveDescriptorLayoutCache::LayoutKeyHash::operator()(const LayoutKey &key) const {
+    size_t seed = 0;
+    hashCombine(seed, static_cast<uint32_t>(key.flags));
+    for (auto bindingFlags : key.bindingFlags) {
+        hashCombine(seed, static_cast<uint32_t>(bindingFlags));
+    }
+    for (const auto &b : key.bindings) {
+        hashCombine(
+            seed,
+            b.binding,
+            static_cast<uint32_t>(b.descriptorType),
+            b.descriptorCount,
+            static_cast<uint32_t>(b.stageFlags));
+    }
+    return seed;
+}
+
+std::shared_ptr<SveDescriptorSetLayout> SveDescriptorLayoutCache::getLayout(
+    const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> &bindings,
+    VkDescriptorSetLayoutCreateFlags flags,
+    const std::unordered_map<uint32_t, VkDescriptorBindingFlags> &bindingFlags) {
+    LayoutKey key{};
+    key.flags = flags;
+    key.bindings.reserve(bindings.size());
+    for (auto &kv : bindings) {
+        key.bindings.push_back(kv.second);
+    }
+    // unordered_map iteration order is unspecified, sort so equal binding sets hash equally
+    std::sort(
+        key.bindings.begin(),
+        key.bindings.end(),
+        [](const VkDescriptorSetLayoutBinding &a, const VkDescriptorSetLayoutBinding &b) {
+            return a.binding < b.binding;
+        });
+    key.bindingFlags.reserve(key.bindings.size());
+    for (auto &b : key.bindings) {
+        auto flagsIt = bindingFlags.find(b.binding);
+        key.bindingFlags.push_back(flagsIt != bindingFlags.end() ? flagsIt->second : 0);
+    }
+
+    auto it = layouts.find(key);
+    if (it != layouts.end()) {
+        return it->second;
+    }
+
+    auto layout = std::make_shared<SveDescriptorSetLayout>(sveDevice, bindings, flags, bindingFlags);
+    layouts.emplace(std::move(key), layout);
+    return layout;
+}
+
 // *************** Descriptor Pool Builder *********************
 
 SveDescriptorPool::Builder &SveDescriptorPool::Builder::addPoolSize(
@@ -110,8 +325,7 @@ bool SveDescriptorPool::allocateDescriptor(
     allocInfo.pSetLayouts = &descriptorSetLayout;
     allocInfo.descriptorSetCount = 1;
 
-    // Might want to create a "DescriptorPoolManager" class that handles this case, and builds
-    // a new pool whenever an old pool fills up. But this is beyond our current scope
+    // fixed size pool, use SveDescriptorAllocator when the number of sets isn't known up front
     if (vkAllocateDescriptorSets(sveDevice.device(), &allocInfo, &descriptor) != VK_SUCCESS) {
         return false;
     }
@@ -130,10 +344,135 @@ void SveDescriptorPool::resetPool() {
     vkResetDescriptorPool(sveDevice.device(), descriptorPool, 0);
 }
 
+// *************** Descriptor Allocator Builder *********************
+
+SveDescriptorAllocator::Builder &SveDescriptorAllocator::Builder::addPoolRatio(
+    VkDescriptorType descriptorType, float descriptorsPerSet) {
+    poolRatios.push_back({descriptorType, descriptorsPerSet});
+    return *this;
+}
+
+SveDescriptorAllocator::Builder &SveDescriptorAllocator::Builder::setPoolFlags(
+    VkDescriptorPoolCreateFlags flags) {
+    poolFlags = flags;
+    return *this;
+}
+
+SveDescriptorAllocator::Builder &SveDescriptorAllocator::Builder::setSetsPerPool(uint32_t count) {
+    setsPerPool = count;
+    return *this;
+}
+
+std::unique_ptr<SveDescriptorAllocator> SveDescriptorAllocator::Builder::build() const {
+    return std::make_unique<SveDescriptorAllocator>(sveDevice, setsPerPool, poolFlags, poolRatios);
+}
+
+// *************** Descriptor Allocator *********************
+
+SveDescriptorAllocator::SveDescriptorAllocator(
+    SveDevice &sveDevice,
+    uint32_t setsPerPool,
+    VkDescriptorPoolCreateFlags poolFlags,
+    const std::vector<std::pair<VkDescriptorType, float>> &poolRatios)
+    : sveDevice{sveDevice}, setsPerPool{setsPerPool}, poolFlags{poolFlags}, poolRatios{poolRatios} {
+    assert(setsPerPool > 0 && "Descriptor allocator needs at least one set per pool");
+    assert(!poolRatios.empty() && "Descriptor allocator needs at least one pool ratio");
+}
+
+SveDescriptorAllocator::~SveDescriptorAllocator() {
+    for (auto pool : usedPools) {
+        vkDestroyDescriptorPool(sveDevice.device(), pool, nullptr);
+    }
+    for (auto pool : freePools) {
+        vkDestroyDescriptorPool(sveDevice.device(), pool, nullptr);
+    }
+}
+
+VkDescriptorPool SveDescriptorAllocator::createPool(uint32_t maxSets) {
+    std::vector<VkDescriptorPoolSize> poolSizes{};
+    poolSizes.reserve(poolRatios.size());
+    for (auto &ratio : poolRatios) {
+        uint32_t count = static_cast<uint32_t>(ratio.second * static_cast<float>(maxSets));
+        poolSizes.push_back({ratio.first, std::max(count, 1u)});
+    }
+
+    VkDescriptorPoolCreateInfo descriptorPoolInfo{};
+    descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descriptorPoolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    descriptorPoolInfo.pPoolSizes = poolSizes.data();
+    descriptorPoolInfo.maxSets = maxSets;
+    descriptorPoolInfo.flags = poolFlags;
+
+    VkDescriptorPool pool;
+    if (vkCreateDescriptorPool(sveDevice.device(), &descriptorPoolInfo, nullptr, &pool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor pool!");
+    }
+    return pool;
+}
+
+VkDescriptorPool SveDescriptorAllocator::grabPool() {
+    VkDescriptorPool pool;
+    if (!freePools.empty()) {
+        pool = freePools.back();
+        freePools.pop_back();
+    } else {
+        pool = createPool(setsPerPool);
+        // grow geometrically so a long lived allocator ends up with a handful of large pools
+        setsPerPool = std::min(setsPerPool * 2, MAX_SETS_PER_POOL);
+    }
+    usedPools.push_back(pool);
+    return pool;
+}
+
+bool SveDescriptorAllocator::allocateDescriptor(
+    const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet &descriptor) {
+    if (currentPool == VK_NULL_HANDLE) {
+        currentPool = grabPool();
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = currentPool;
+    allocInfo.pSetLayouts = &descriptorSetLayout;
+    allocInfo.descriptorSetCount = 1;
+
+    VkResult result = vkAllocateDescriptorSets(sveDevice.device(), &allocInfo, &descriptor);
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+        // current pool is full, chain a fresh one and retry once
+        currentPool = grabPool();
+        allocInfo.descriptorPool = currentPool;
+        result = vkAllocateDescriptorSets(sveDevice.device(), &allocInfo, &descriptor);
+    }
+    return result == VK_SUCCESS;
+}
+
+void SveDescriptorAllocator::resetPools() {
+    for (auto pool : usedPools) {
+        vkResetDescriptorPool(sveDevice.device(), pool, 0);
+        freePools.push_back(pool);
+    }
+    usedPools.clear();
+    currentPool = VK_NULL_HANDLE;
+}
+
 // *************** Descriptor Writer *********************
 
-SveDescriptorWriter::SveDescriptorWriter(SveDescriptorSetLayout &setLayout, SveDescriptorPool &pool)
-    : setLayout{setLayout}, pool{pool} {}
+SveDescriptorWriter::SveDescriptorWriter(
+    SveDescriptorSetLayout &setLayout, SveDescriptorPool &pool, std::pmr::memory_resource *memory)
+    : setLayout{setLayout}, pool{&pool}, writes{memory} {
+    writes.reserve(setLayout.bindings.size());
+}
+
+SveDescriptorWriter::SveDescriptorWriter(
+    SveDescriptorSetLayout &setLayout, SveDescriptorAllocator &allocator, std::pmr::memory_resource *memory)
+    : setLayout{setLayout}, allocator{&allocator}, writes{memory} {
+    writes.reserve(setLayout.bindings.size());
+}
+
+SveDescriptorWriter::SveDescriptorWriter(SveDescriptorSetLayout &setLayout, std::pmr::memory_resource *memory)
+    : setLayout{setLayout}, writes{memory} {
+    writes.reserve(setLayout.bindings.size());
+}
 
 SveDescriptorWriter &SveDescriptorWriter::writeBuffer(
     uint32_t binding, VkDescriptorBufferInfo *bufferInfo) {
@@ -178,7 +517,10 @@ SveDescriptorWriter &SveDescriptorWriter::writeImage(
 }
 
 bool SveDescriptorWriter::build(VkDescriptorSet &set) {
-    bool success = pool.allocateDescriptor(setLayout.getDescriptorSetLayout(), set);
+    assert((allocator != nullptr || pool != nullptr) && "Writer has no pool to allocate from");
+    bool success = allocator != nullptr
+                       ? allocator->allocateDescriptor(setLayout.getDescriptorSetLayout(), set)
+                       : pool->allocateDescriptor(setLayout.getDescriptorSetLayout(), set);
     if (!success) {
         return false;
     }
@@ -190,7 +532,23 @@ void SveDescriptorWriter::overwrite(VkDescriptorSet &set) {
     for (auto &write : writes) {
         write.dstSet = set;
     }
-    vkUpdateDescriptorSets(pool.sveDevice.device(), writes.size(), writes.data(), 0, nullptr);
+    vkUpdateDescriptorSets(setLayout.sveDevice.device(), writes.size(), writes.data(), 0, nullptr);
+}
+
+void SveDescriptorWriter::push(
+    VkCommandBuffer commandBuffer,
+    VkPipelineBindPoint bindPoint,
+    VkPipelineLayout pipelineLayout,
+    uint32_t set) {
+    assert(setLayout.isPushDescriptor() && "Layout was not created with the push descriptor flag");
+    // dstSet is ignored for push descriptors
+    setLayout.sveDevice.cmdPushDescriptorSet(
+        commandBuffer,
+        bindPoint,
+        pipelineLayout,
+        set,
+        static_cast<uint32_t>(writes.size()),
+        writes.data());
 }
 
 }  // namespace sve
\ No newline at end of file
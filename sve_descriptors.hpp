@@ -4,11 +4,14 @@
 
 // std
 #include <memory>
+#include <memory_resource>
 #include <unordered_map>
 #include <vector>
 
 namespace sve {
 
+class SveDescriptorLayoutCache;
+
 class SveDescriptorSetLayout {
    public:
     class Builder {
@@ -20,27 +23,114 @@ class SveDescriptorSetLayout {
             VkDescriptorType descriptorType,
             VkShaderStageFlags stageFlags,
             uint32_t count = 1);
+        Builder &setFlags(VkDescriptorSetLayoutCreateFlags flags);
+        // descriptor indexing flags (partially bound, update after bind, ...) for an added binding
+        Builder &setBindingFlags(uint32_t binding, VkDescriptorBindingFlags bindingFlags);
         std::unique_ptr<SveDescriptorSetLayout> build() const;
+        std::shared_ptr<SveDescriptorSetLayout> build(SveDescriptorLayoutCache &cache) const;
 
        private:
         SveDevice &sveDevice;
         std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
+        std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingFlags{};
+        VkDescriptorSetLayoutCreateFlags flags = 0;
     };
 
     SveDescriptorSetLayout(
-        SveDevice &sveDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+        SveDevice &sveDevice,
+        std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+        VkDescriptorSetLayoutCreateFlags flags = 0,
+        const std::unordered_map<uint32_t, VkDescriptorBindingFlags> &bindingFlags = {});
     ~SveDescriptorSetLayout();
     SveDescriptorSetLayout(const SveDescriptorSetLayout &) = delete;
     SveDescriptorSetLayout &operator=(const SveDescriptorSetLayout &) = delete;
 
     VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptorSetLayout; }
+    bool isPushDescriptor() const { return (flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR) != 0; }
 
    private:
     SveDevice &sveDevice;
     VkDescriptorSetLayout descriptorSetLayout;
     std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings;
+    VkDescriptorSetLayoutCreateFlags flags;
 
     friend class SveDescriptorWriter;
+    friend class SveDescriptorUpdateTemplate;
+};
+
+// Updates every binding of a set in one call from a packed struct of descriptor infos, instead of
+// building VkWriteDescriptorSets each time. Built for push descriptor layouts it writes the
+// bindings straight into the command buffer, no set or pool allocation needed
+class SveDescriptorUpdateTemplate {
+   public:
+    class Builder {
+       public:
+        Builder(SveDescriptorSetLayout &setLayout) : setLayout{setLayout} {}
+
+        // offset of the binding's VkDescriptorBufferInfo/VkDescriptorImageInfo in the packed struct,
+        // stride 0 means tightly packed infos for array bindings
+        Builder &addEntry(uint32_t binding, size_t offset, size_t stride = 0, uint32_t count = 1);
+        std::unique_ptr<SveDescriptorUpdateTemplate> build() const;
+        std::unique_ptr<SveDescriptorUpdateTemplate> buildForPush(
+            VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t set) const;
+
+       private:
+        SveDescriptorSetLayout &setLayout;
+        std::vector<VkDescriptorUpdateTemplateEntry> entries{};
+    };
+
+    SveDescriptorUpdateTemplate(
+        SveDescriptorSetLayout &setLayout,
+        const std::vector<VkDescriptorUpdateTemplateEntry> &entries,
+        VkDescriptorUpdateTemplateType templateType,
+        VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE,
+        uint32_t set = 0);
+    ~SveDescriptorUpdateTemplate();
+    SveDescriptorUpdateTemplate(const SveDescriptorUpdateTemplate &) = delete;
+    SveDescriptorUpdateTemplate &operator=(const SveDescriptorUpdateTemplate &) = delete;
+
+    void update(VkDescriptorSet set, const void *data) const;
+    void push(VkCommandBuffer commandBuffer, const void *data) const;
+
+   private:
+    SveDevice &sveDevice;
+    VkDescriptorUpdateTemplate updateTemplate;
+    VkDescriptorUpdateTemplateType templateType;
+    VkPipelineLayout pipelineLayout;
+    uint32_t set;
+};
+
+// Hands out one shared SveDescriptorSetLayout per unique set of bindings, so per-material and
+// per-pass sets with the same shape don't each create their own VkDescriptorSetLayout
+class SveDescriptorLayoutCache {
+   public:
+    SveDescriptorLayoutCache(SveDevice &sveDevice) : sveDevice{sveDevice} {}
+    SveDescriptorLayoutCache(const SveDescriptorLayoutCache &) = delete;
+    SveDescriptorLayoutCache &operator=(const SveDescriptorLayoutCache &) = delete;
+
+    std::shared_ptr<SveDescriptorSetLayout> getLayout(
+        const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> &bindings,
+        VkDescriptorSetLayoutCreateFlags flags = 0,
+        const std::unordered_map<uint32_t, VkDescriptorBindingFlags> &bindingFlags = {});
+
+    size_t size() const { return layouts.size(); }
+
+   private:
+    struct LayoutKey {
+        std::vector<VkDescriptorSetLayoutBinding> bindings;  // sorted by binding index
+        std::vector<VkDescriptorBindingFlags> bindingFlags;  // parallel to bindings
+        VkDescriptorSetLayoutCreateFlags flags = 0;
+
+        bool operator==(const LayoutKey &other) const;
+    };
+
+    struct LayoutKeyHash {
+        size_t operator()(const LayoutKey &key) const;
+    };
+
+    SveDevice &sveDevice;
+    std::unordered_map<LayoutKey, std::shared_ptr<SveDescriptorSetLayout>, LayoutKeyHash> layouts;
 };
 
 class SveDescriptorPool {
@@ -84,20 +174,86 @@ class SveDescriptorPool {
     friend class SveDescriptorWriter;
 };
 
+// Growable allocator: chains a new pool whenever the current one runs out and recycles every
+// pool through a free list on resetPools(), so per-frame sets can be dropped wholesale
+class SveDescriptorAllocator {
+   public:
+    class Builder {
+       public:
+        Builder(SveDevice &sveDevice) : sveDevice{sveDevice} {}
+
+        Builder &addPoolRatio(VkDescriptorType descriptorType, float descriptorsPerSet);
+        Builder &setPoolFlags(VkDescriptorPoolCreateFlags flags);
+        Builder &setSetsPerPool(uint32_t count);
+        std::unique_ptr<SveDescriptorAllocator> build() const;
+
+       private:
+        SveDevice &sveDevice;
+        std::vector<std::pair<VkDescriptorType, float>> poolRatios{};
+        uint32_t setsPerPool = 64;
+        VkDescriptorPoolCreateFlags poolFlags = 0;
+    };
+
+    static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+    SveDescriptorAllocator(
+        SveDevice &sveDevice,
+        uint32_t setsPerPool,
+        VkDescriptorPoolCreateFlags poolFlags,
+        const std::vector<std::pair<VkDescriptorType, float>> &poolRatios);
+    ~SveDescriptorAllocator();
+    SveDescriptorAllocator(const SveDescriptorAllocator &) = delete;
+    SveDescriptorAllocator &operator=(const SveDescriptorAllocator &) = delete;
+
+    bool allocateDescriptor(const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet &descriptor);
+
+    // every set handed out since the last reset becomes invalid
+    void resetPools();
+
+    size_t poolCount() const { return usedPools.size() + freePools.size(); }
+
+   private:
+    VkDescriptorPool grabPool();
+    VkDescriptorPool createPool(uint32_t maxSets);
+
+    SveDevice &sveDevice;
+    uint32_t setsPerPool;
+    VkDescriptorPoolCreateFlags poolFlags;
+    std::vector<std::pair<VkDescriptorType, float>> poolRatios;
+
+    VkDescriptorPool currentPool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorPool> usedPools;
+    std::vector<VkDescriptorPool> freePools;
+};
+
 class SveDescriptorWriter {
    public:
-    SveDescriptorWriter(SveDescriptorSetLayout &setLayout, SveDescriptorPool &pool);
+    // the writes are gathered in `memory`, pass the frame arena for writers built every frame
+    SveDescriptorWriter(
+        SveDescriptorSetLayout &setLayout,
+        SveDescriptorPool &pool,
+        std::pmr::memory_resource *memory = std::pmr::get_default_resource());
+    SveDescriptorWriter(
+        SveDescriptorSetLayout &setLayout,
+        SveDescriptorAllocator &allocator,
+        std::pmr::memory_resource *memory = std::pmr::get_default_resource());
+    // push descriptors only
+    SveDescriptorWriter(
+        SveDescriptorSetLayout &setLayout, std::pmr::memory_resource *memory = std::pmr::get_default_resource());
 
     SveDescriptorWriter &writeBuffer(uint32_t binding, VkDescriptorBufferInfo *bufferInfo);
     SveDescriptorWriter &writeImage(uint32_t binding, VkDescriptorImageInfo *imageInfo);
 
     bool build(VkDescriptorSet &set);
     void overwrite(VkDescriptorSet &set);
+    // VK_KHR_push_descriptor: record the writes into the command buffer, layout must be a push descriptor layout
+    void push(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t set);
 
    private:
     SveDescriptorSetLayout &setLayout;
-    SveDescriptorPool &pool;
-    std::vector<VkWriteDescriptorSet> writes;
+    SveDescriptorPool *pool = nullptr;
+    SveDescriptorAllocator *allocator = nullptr;
+    std::pmr::vector<VkWriteDescriptorSet> writes;
 };
 
 }  // namespace sve
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "sve_device.hpp"
 
 // std headers
+#include <cassert>
 #include <cstring>
 #include <iostream>
 #include <set>
@@ -53,21 +54,59 @@ SveDevice::SveDevice(SveWindow &window) : window{window} {
     createSurface();
     pickPhysicalDevice();
     createLogicalDevice();
+    loadExtensionFunctions();
+    memoryAllocator = std::make_unique<SveMemoryAllocator>(physicalDevice, device_, properties, supportsMemoryBudget());
     createCommandPool();
 }
 
 SveDevice::~SveDevice() {
+    flushDeferredDestruction();
     vkDestroyCommandPool(device_, commandPool, nullptr);
+    memoryAllocator.reset();
     vkDestroyDevice(device_, nullptr);
 
     if (enableValidationLayers) {
         DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
     }
 
-    vkDestroySurfaceKHR(instance, surface_, nullptr);
+    if (surface_ != VK_NULL_HANDLE) {
+        vkDestroySurfaceKHR(instance, surface_, nullptr);
+    }
     vkDestroyInstance(instance, nullptr);
 }
 
+void SveDevice::deferDestruction(std::function<void()> destroy) {
+    if (pendingFrameValue <= completedFrameValue) {
+        destroy();
+        return;
+    }
+    deferredDestructions.push_back({pendingFrameValue, std::move(destroy)});
+}
+
+void SveDevice::updateFrameProgress(uint64_t pendingFrameValue, uint64_t completedFrameValue) {
+    this->pendingFrameValue = pendingFrameValue;
+    this->completedFrameValue = completedFrameValue;
+    while (!deferredDestructions.empty() && deferredDestructions.front().frameValue <= completedFrameValue) {
+        // popped first, destroying an object may release (and queue) others
+        auto destroy = std::move(deferredDestructions.front().destroy);
+        deferredDestructions.pop_front();
+        destroy();
+    }
+}
+
+void SveDevice::flushDeferredDestruction() {
+    if (deferredDestructions.empty()) {
+        return;
+    }
+    vkDeviceWaitIdle(device_);
+    completedFrameValue = pendingFrameValue;
+    while (!deferredDestructions.empty()) {
+        auto destroy = std::move(deferredDestructions.front().destroy);
+        deferredDestructions.pop_front();
+        destroy();
+    }
+}
+
 void SveDevice::createInstance() {
     if (enableValidationLayers && !checkValidationLayerSupport()) {
         throw std::runtime_error("validation layers requested, but not available!");
@@ -79,13 +118,33 @@ void SveDevice::createInstance() {
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    appInfo.apiVersion = VK_API_VERSION_1_2;  // highest version used, device may still be 1.1
 
     VkInstanceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
     createInfo.pApplicationInfo = &appInfo;
 
     auto extensions = getRequiredExtensions();
+    if (!window.isHeadless()) {
+        uint32_t extensionCount = 0;
+        vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, availableExtensions.data());
+
+        size_t found = 0;
+        for (const char *optional : optionalInstanceExtensions) {
+            for (const auto &extension : availableExtensions) {
+                if (strcmp(optional, extension.extensionName) == 0) {
+                    found++;
+                    break;
+                }
+            }
+        }
+        surfaceMaintenance1Enabled = found == optionalInstanceExtensions.size();
+        if (surfaceMaintenance1Enabled) {
+            extensions.insert(extensions.end(), optionalInstanceExtensions.begin(), optionalInstanceExtensions.end());
+        }
+    }
     createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
     createInfo.ppEnabledExtensionNames = extensions.data();
 
@@ -130,7 +189,32 @@ void SveDevice::pickPhysicalDevice() {
     }
 
     vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
     std::cout << "physical device: " << properties.deviceName << std::endl;
+
+    if (properties.apiVersion >= VK_API_VERSION_1_2) {
+        supportedFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &supportedFeatures12;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+        descriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &descriptorIndexingProperties;
+        vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+        bindlessSupported = supportedFeatures12.descriptorIndexing &&
+                            supportedFeatures12.runtimeDescriptorArray &&
+                            supportedFeatures12.descriptorBindingPartiallyBound &&
+                            supportedFeatures12.descriptorBindingUpdateUnusedWhilePending &&
+                            supportedFeatures12.descriptorBindingSampledImageUpdateAfterBind &&
+                            supportedFeatures12.descriptorBindingStorageBufferUpdateAfterBind &&
+                            supportedFeatures12.shaderSampledImageArrayNonUniformIndexing &&
+                            supportedFeatures12.shaderStorageBufferArrayNonUniformIndexing;
+    }
+    std::cout << "bindless descriptors: " << (bindlessSupported ? "yes" : "no") << std::endl;
 }
 
 void SveDevice::createLogicalDevice() {
@@ -149,8 +233,29 @@ void SveDevice::createLogicalDevice() {
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
-    VkPhysicalDeviceFeatures deviceFeatures = {};
-    deviceFeatures.samplerAnisotropy = VK_TRUE;
+    VkPhysicalDeviceVulkan12Features features12 = {};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    if (bindlessSupported) {
+        features12.descriptorIndexing = VK_TRUE;
+        features12.runtimeDescriptorArray = VK_TRUE;
+        features12.descriptorBindingPartiallyBound = VK_TRUE;
+        features12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        features12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+        features12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        features12.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+    }
+    features12.timelineSemaphore = VK_TRUE;
+
+    VkPhysicalDeviceFeatures2 deviceFeatures = {};
+    deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    deviceFeatures.features.samplerAnisotropy = VK_TRUE;
+    deviceFeatures.features.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+    deviceFeatures.features.depthClamp = supportedFeatures.depthClamp;
+    deviceFeatures.features.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+    deviceFeatures.features.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+    // the 1.2 feature struct may only be chained on a 1.2 device
+    deviceFeatures.pNext = properties.apiVersion >= VK_API_VERSION_1_2 ? &features12 : nullptr;
 
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -158,9 +263,67 @@ void SveDevice::createLogicalDevice() {
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
-    createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    // required extensions plus whichever optional ones this device has
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+    std::vector<const char *> extensions = requiredDeviceExtensions();
+    for (const char *optional : optionalDeviceExtensions) {
+        if (strcmp(optional, VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME) == 0 && !surfaceMaintenance1Enabled) {
+            continue;
+        }
+        for (const auto &extension : availableExtensions) {
+            if (strcmp(optional, extension.extensionName) == 0) {
+                extensions.push_back(optional);
+                break;
+            }
+        }
+    }
+    enabledDeviceExtensions = std::unordered_set<std::string>(extensions.begin(), extensions.end());
+
+    VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2Features{};
+    synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+    if (isExtensionEnabled(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME)) {
+        VkPhysicalDeviceFeatures2 supported{};
+        supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supported.pNext = &synchronization2Features;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &supported);
+        synchronization2Supported = synchronization2Features.synchronization2;
+        if (synchronization2Supported) {
+            synchronization2Features.pNext = deviceFeatures.pNext;
+            deviceFeatures.pNext = &synchronization2Features;
+        }
+    }
+
+    VkPhysicalDeviceSwapchainMaintenance1FeaturesEXT swapchainMaintenance1Features{};
+    swapchainMaintenance1Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SWAPCHAIN_MAINTENANCE_1_FEATURES_EXT;
+    if (isExtensionEnabled(VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME)) {
+        VkPhysicalDeviceFeatures2 supported{};
+        supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supported.pNext = &swapchainMaintenance1Features;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &supported);
+        swapchainMaintenance1Supported = swapchainMaintenance1Features.swapchainMaintenance1;
+        if (swapchainMaintenance1Supported) {
+            swapchainMaintenance1Features.pNext = deviceFeatures.pNext;
+            deviceFeatures.pNext = &swapchainMaintenance1Features;
+        }
+    }
+
+    // below 1.2 timeline semaphores come from the extension, with their own feature struct
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures{};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+    timelineFeatures.timelineSemaphore = VK_TRUE;
+    if (properties.apiVersion < VK_API_VERSION_1_2) {
+        timelineFeatures.pNext = deviceFeatures.pNext;
+        deviceFeatures.pNext = &timelineFeatures;
+    }
+
+    createInfo.pNext = &deviceFeatures;
+    createInfo.pEnabledFeatures = nullptr;  // features come through VkPhysicalDeviceFeatures2 in pNext
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
 
     if (enableValidationLayers) {
         createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -177,6 +340,30 @@ void SveDevice::createLogicalDevice() {
     vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
 }
 
+void SveDevice::loadExtensionFunctions() {
+    if (supportsPushDescriptors()) {
+        cmdPushDescriptorSet = (PFN_vkCmdPushDescriptorSetKHR)vkGetDeviceProcAddr(
+            device_,
+            "vkCmdPushDescriptorSetKHR");
+        cmdPushDescriptorSetWithTemplate = (PFN_vkCmdPushDescriptorSetWithTemplateKHR)vkGetDeviceProcAddr(
+            device_,
+            "vkCmdPushDescriptorSetWithTemplateKHR");
+    }
+    bool core12 = properties.apiVersion >= VK_API_VERSION_1_2;
+    waitSemaphores = (PFN_vkWaitSemaphoresKHR)vkGetDeviceProcAddr(device_, core12 ? "vkWaitSemaphores" : "vkWaitSemaphoresKHR");
+    getSemaphoreCounterValue = (PFN_vkGetSemaphoreCounterValueKHR)vkGetDeviceProcAddr(
+        device_,
+        core12 ? "vkGetSemaphoreCounterValue" : "vkGetSemaphoreCounterValueKHR");
+    if (waitSemaphores == nullptr || getSemaphoreCounterValue == nullptr) {
+        throw std::runtime_error("failed to load timeline semaphore functions!");
+    }
+
+    if (supportsSynchronization2()) {
+        cmdPipelineBarrier2 = (PFN_vkCmdPipelineBarrier2KHR)vkGetDeviceProcAddr(device_, "vkCmdPipelineBarrier2KHR");
+        synchronization2Supported = cmdPipelineBarrier2 != nullptr;
+    }
+}
+
 void SveDevice::createCommandPool() {
     QueueFamilyIndices queueFamilyIndices = findPhysicalQueueFamilies();
 
@@ -190,15 +377,19 @@ void SveDevice::createCommandPool() {
     }
 }
 
-void SveDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
+void SveDevice::createSurface() {
+    if (!window.isHeadless()) {
+        window.createWindowSurface(instance, &surface_);
+    }
+}
 
 bool SveDevice::isDeviceSuitable(VkPhysicalDevice device) {
     QueueFamilyIndices indices = findQueueFamilies(device);
 
     bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-    bool swapChainAdequate = false;
-    if (extensionsSupported) {
+    bool swapChainAdequate = window.isHeadless();  // renders to offscreen images instead
+    if (extensionsSupported && !window.isHeadless()) {
         SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
         swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
     }
@@ -206,8 +397,12 @@ bool SveDevice::isDeviceSuitable(VkPhysicalDevice device) {
     VkPhysicalDeviceFeatures supportedFeatures;
     vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(device, &deviceProperties);
+
     return indices.isComplete() && extensionsSupported && swapChainAdequate &&
-           supportedFeatures.samplerAnisotropy;
+           supportedFeatures.samplerAnisotropy && deviceProperties.apiVersion >= VK_API_VERSION_1_1 &&
+           checkTimelineSemaphoreSupport(device);
 }
 
 void SveDevice::populateDebugMessengerCreateInfo(
@@ -258,11 +453,13 @@ bool SveDevice::checkValidationLayerSupport() {
 }
 
 std::vector<const char *> SveDevice::getRequiredExtensions() {
-    uint32_t glfwExtensionCount = 0;
-    const char **glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-    std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    std::vector<const char *> extensions;
+    if (!window.isHeadless()) {  // GLFW isn't even initialized without a window
+        uint32_t glfwExtensionCount = 0;
+        const char **glfwExtensions;
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
 
     if (enableValidationLayers) {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -305,7 +502,8 @@ bool SveDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
         &extensionCount,
         availableExtensions.data());
 
-    std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+    auto required = requiredDeviceExtensions();
+    std::set<std::string> requiredExtensions(required.begin(), required.end());
 
     for (const auto &extension : availableExtensions) {
         requiredExtensions.erase(extension.extensionName);
@@ -314,6 +512,42 @@ bool SveDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
     return requiredExtensions.empty();
 }
 
+std::vector<const char *> SveDevice::requiredDeviceExtensions() const {
+    if (window.isHeadless()) {
+        return {};  // nothing is presented
+    }
+    return deviceExtensions;
+}
+
+// frame pacing is built on timeline semaphores, core since 1.2 and an extension on 1.1 devices
+bool SveDevice::checkTimelineSemaphoreSupport(VkPhysicalDevice device) {
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(device, &deviceProperties);
+
+    if (deviceProperties.apiVersion < VK_API_VERSION_1_2) {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+        bool extensionFound = false;
+        for (const auto &extension : availableExtensions) {
+            extensionFound = extensionFound || strcmp(extension.extensionName, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) == 0;
+        }
+        if (!extensionFound) {
+            return false;
+        }
+    }
+
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures{};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &timelineFeatures;
+    vkGetPhysicalDeviceFeatures2(device, &features2);
+    return timelineFeatures.timelineSemaphore;
+}
+
 QueueFamilyIndices SveDevice::findQueueFamilies(VkPhysicalDevice device) {
     QueueFamilyIndices indices;
 
@@ -330,7 +564,11 @@ QueueFamilyIndices SveDevice::findQueueFamilies(VkPhysicalDevice device) {
             indices.graphicsFamilyHasValue = true;
         }
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+        if (window.isHeadless()) {
+            presentSupport = indices.graphicsFamilyHasValue && indices.graphicsFamily == static_cast<uint32_t>(i);  // never presents
+        } else {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+        }
         if (queueFamily.queueCount > 0 && presentSupport) {
             indices.presentFamily = i;
             indices.presentFamilyHasValue = true;
@@ -346,6 +584,7 @@ QueueFamilyIndices SveDevice::findQueueFamilies(VkPhysicalDevice device) {
 }
 
 SwapChainSupportDetails SveDevice::querySwapChainSupport(VkPhysicalDevice device) {
+    assert(!window.isHeadless() && "Headless devices have no surface to query");
     SwapChainSupportDetails details;
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface_, &details.capabilities);
 
@@ -388,23 +627,43 @@ VkFormat SveDevice::findSupportedFormat(
 }
 
 uint32_t SveDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-        if ((typeFilter & (1 << i)) &&
-            (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
-        }
+    return memoryAllocator->findMemoryType(typeFilter, properties);
+}
+
+static SveMemoryCategory bufferCategory(VkBufferUsageFlags usage, VkMemoryPropertyFlags properties) {
+    if (usage & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT)) {
+        return SveMemoryCategory::Geometry;
+    }
+    if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
+        return SveMemoryCategory::Uniforms;
+    }
+    if (usage & (VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT)) {
+        return SveMemoryCategory::Storage;
     }
+    if ((usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT) && (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) {
+        return SveMemoryCategory::Staging;
+    }
+    return SveMemoryCategory::Other;
+}
 
-    throw std::runtime_error("failed to find suitable memory type!");
+static SveMemoryCategory imageCategory(const VkImageCreateInfo &imageInfo) {
+    if (imageInfo.usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+        return SveMemoryCategory::Depth;
+    }
+    if (imageInfo.usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT)) {
+        return SveMemoryCategory::RenderTargets;
+    }
+    if (imageInfo.usage & VK_IMAGE_USAGE_SAMPLED_BIT) {
+        return SveMemoryCategory::Textures;
+    }
+    return SveMemoryCategory::Other;
 }
 
 void SveDevice::createBuffer(VkDeviceSize size,
                              VkBufferUsageFlags usage,
                              VkMemoryPropertyFlags properties,
                              VkBuffer &buffer,
-                             VkDeviceMemory &bufferMemory) {
+                             SveAllocation &bufferAllocation) {
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferInfo.size = size;
@@ -415,19 +674,12 @@ void SveDevice::createBuffer(VkDeviceSize size,
         throw std::runtime_error("failed to create vertex buffer!");
     }
 
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate vertex buffer memory!");
-    }
+    bufferAllocation = memoryAllocator->allocateForBuffer(buffer, properties, bufferCategory(usage, properties));
+}
 
-    vkBindBufferMemory(device_, buffer, bufferMemory, 0);
+void SveDevice::destroyBuffer(VkBuffer buffer, SveAllocation &bufferAllocation) {
+    vkDestroyBuffer(device_, buffer, nullptr);
+    memoryAllocator->free(bufferAllocation);
 }
 
 VkCommandBuffer SveDevice::beginSingleTimeCommands() {
@@ -505,26 +757,17 @@ void SveDevice::createImageWithInfo(
     const VkImageCreateInfo &imageInfo,
     VkMemoryPropertyFlags properties,
     VkImage &image,
-    VkDeviceMemory &imageMemory) {
+    SveAllocation &imageAllocation) {
     if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS) {
         throw std::runtime_error("failed to create image!");
     }
 
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(device_, image, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate image memory!");
-    }
+    imageAllocation = memoryAllocator->allocateForImage(image, imageInfo.tiling, properties, imageCategory(imageInfo));
+}
 
-    if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) {
-        throw std::runtime_error("failed to bind image memory!");
-    }
+void SveDevice::destroyImage(VkImage image, SveAllocation &imageAllocation) {
+    vkDestroyImage(device_, image, nullptr);
+    memoryAllocator->free(imageAllocation);
 }
 
 }  // namespace sve
\ No newline at end of file
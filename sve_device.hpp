@@ -1,9 +1,14 @@
 #pragma once
 
+#include "sve_memory_allocator.hpp"
 #include "sve_window.hpp"
 
 // std lib headers
+#include <deque>
+#include <functional>
+#include <memory>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 namespace sve {
@@ -40,10 +45,15 @@ class SveDevice {
     SveDevice &operator=(SveDevice &&) = delete;
 
     VkCommandPool getCommandPool() { return commandPool; }
+    VkPhysicalDevice getPhysicalDevice() { return physicalDevice; }
     VkDevice device() { return device_; }
-    VkSurfaceKHR surface() { return surface_; }
+    VkSurfaceKHR surface() { return surface_; }  // null when headless
     VkQueue graphicsQueue() { return graphicsQueue_; }
     VkQueue presentQueue() { return presentQueue_; }
+    // created for a headless window: no surface, no swap chain extension, and any device with a
+    // graphics queue will do, software rasterizers like lavapipe or SwiftShader included (pick one
+    // with the loader's VK_ICD_FILENAMES)
+    bool isHeadless() const { return window.isHeadless(); }
 
     SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -51,13 +61,14 @@ class SveDevice {
     VkFormat findSupportedFormat(
         const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
-    // Buffer Helper Functions
+    // Buffer Helper Functions, the memory is accounted to a SveMemoryCategory picked from the usage
     void createBuffer(
         VkDeviceSize size,
         VkBufferUsageFlags usage,
         VkMemoryPropertyFlags properties,
         VkBuffer &buffer,
-        VkDeviceMemory &bufferMemory);
+        SveAllocation &bufferAllocation);
+    void destroyBuffer(VkBuffer buffer, SveAllocation &bufferAllocation);
     VkCommandBuffer beginSingleTimeCommands();
     void endSingleTimeCommands(VkCommandBuffer commandBuffer);
     void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
@@ -68,9 +79,53 @@ class SveDevice {
         const VkImageCreateInfo &imageInfo,
         VkMemoryPropertyFlags properties,
         VkImage &image,
-        VkDeviceMemory &imageMemory);
+        SveAllocation &imageAllocation);
+    void destroyImage(VkImage image, SveAllocation &imageAllocation);
+
+    SveMemoryAllocator &allocator() { return *memoryAllocator; }
+
+    // Deferred destruction. Whatever is released while frame N is being recorded, or after it was
+    // submitted and before the next one begins, may still be in use by frame N on the GPU, so it is
+    // destroyed once frame N has completed. SveRenderer reports the frame progress; with no frame
+    // submitted yet, destruction happens right away
+    void deferDestruction(std::function<void()> destroy);
+    void updateFrameProgress(uint64_t pendingFrameValue, uint64_t completedFrameValue);
+    // waits for the device and destroys everything still queued
+    void flushDeferredDestruction();
+    size_t deferredDestructionCount() const { return deferredDestructions.size(); }
+
+    bool isExtensionEnabled(const char *extensionName) const {
+        return enabledDeviceExtensions.count(extensionName) > 0;
+    }
+    bool supportsPushDescriptors() const { return isExtensionEnabled(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME); }
+    // Vulkan 1.2 descriptor indexing: partially bound, update-after-bind, non-uniformly indexed arrays
+    bool supportsBindless() const { return bindlessSupported; }
+    bool supportsPipelineStatistics() const { return supportedFeatures.pipelineStatisticsQuery; }
+    bool supportsDepthClamp() const { return supportedFeatures.depthClamp; }
+    // many draws from one indirect buffer, each with its own firstInstance to index per draw data
+    bool supportsMultiDrawIndirect() const {
+        return supportedFeatures.multiDrawIndirect && supportedFeatures.drawIndirectFirstInstance;
+    }
+    // VK_KHR_synchronization2: vkCmdPipelineBarrier2 with 64-bit stage and access masks
+    bool supportsSynchronization2() const { return synchronization2Supported; }
+    // VK_EXT_memory_budget: live per heap budget and usage, see SveMemoryAllocator::getHeapBudgets
+    bool supportsMemoryBudget() const { return isExtensionEnabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME); }
+    // VK_EXT_swapchain_maintenance1: present fences, signaled once the presentation engine is done
+    // with a present's semaphores and swap chain
+    bool supportsSwapchainMaintenance1() const { return swapchainMaintenance1Supported; }
 
     VkPhysicalDeviceProperties properties;
+    VkPhysicalDeviceDescriptorIndexingProperties descriptorIndexingProperties{};  // zeroed below Vulkan 1.2
+
+    // VK_KHR_push_descriptor entry points, null when the extension isn't available
+    PFN_vkCmdPushDescriptorSetKHR cmdPushDescriptorSet = nullptr;
+    PFN_vkCmdPushDescriptorSetWithTemplateKHR cmdPushDescriptorSetWithTemplate = nullptr;
+    // VK_KHR_synchronization2 entry point, null when unsupported
+    PFN_vkCmdPipelineBarrier2KHR cmdPipelineBarrier2 = nullptr;
+    // timeline semaphores, core in Vulkan 1.2 and VK_KHR_timeline_semaphore below. Always loaded,
+    // a device without them isn't picked
+    PFN_vkWaitSemaphoresKHR waitSemaphores = nullptr;
+    PFN_vkGetSemaphoreCounterValueKHR getSemaphoreCounterValue = nullptr;
 
    private:
     void createInstance();
@@ -79,6 +134,7 @@ class SveDevice {
     void pickPhysicalDevice();
     void createLogicalDevice();
     void createCommandPool();
+    void loadExtensionFunctions();
 
     // helper functions
     bool isDeviceSuitable(VkPhysicalDevice device);
@@ -88,6 +144,8 @@ class SveDevice {
     void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo);
     void hasGflwRequiredInstanceExtensions();
     bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+    std::vector<const char *> requiredDeviceExtensions() const;
+    bool checkTimelineSemaphoreSupport(VkPhysicalDevice device);
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
     VkInstance instance;
@@ -97,12 +155,39 @@ class SveDevice {
     VkCommandPool commandPool;
 
     VkDevice device_;
-    VkSurfaceKHR surface_;
+    VkSurfaceKHR surface_ = VK_NULL_HANDLE;
     VkQueue graphicsQueue_;
     VkQueue presentQueue_;
+    std::unique_ptr<SveMemoryAllocator> memoryAllocator;
+
+    struct DeferredDestruction {
+        uint64_t frameValue;
+        std::function<void()> destroy;
+    };
+    std::deque<DeferredDestruction> deferredDestructions;  // in frame value order
+    uint64_t pendingFrameValue = 0;    // newest frame that can reference something released now
+    uint64_t completedFrameValue = 0;  // newest frame known to have completed
 
     const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
     const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+    const std::vector<const char *> optionalDeviceExtensions = {
+        VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME,
+        VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME,
+        VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME,
+        VK_EXT_MEMORY_BUDGET_EXTENSION_NAME,
+        VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME};
+    // only enabled together, swapchain maintenance1 needs both
+    const std::vector<const char *> optionalInstanceExtensions = {
+        VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME,
+        VK_EXT_SURFACE_MAINTENANCE_1_EXTENSION_NAME};
+    std::unordered_set<std::string> enabledDeviceExtensions;
+
+    VkPhysicalDeviceFeatures supportedFeatures{};
+    VkPhysicalDeviceVulkan12Features supportedFeatures12{};
+    bool bindlessSupported = false;
+    bool synchronization2Supported = false;
+    bool surfaceMaintenance1Enabled = false;  // instance side of swapchain maintenance1
+    bool swapchainMaintenance1Supported = false;
 };
 
 }  // namespace sve
\ No newline at end of file
@@ -0,0 +1,53 @@
+#include "sve_frame_arena.hpp"
+
+// std
+#include <cassert>
+#include <cstdint>
+
+namespace sve {
+
+SveFrameArena::SveFrameArena(uint32_t frameCount, size_t bytesPerFrame) {
+    assert(frameCount > 0 && bytesPerFrame > 0 && "Frame arena needs at least one non-empty slot");
+    slots.resize(frameCount);
+    for (auto &slot : slots) {
+        slot.memory = std::make_unique<std::byte[]>(bytesPerFrame);
+        slot.capacity = bytesPerFrame;
+    }
+}
+
+void SveFrameArena::beginFrame(int frameIndex) {
+    assert(frameIndex < static_cast<int>(slots.size()) && "Frame index out of range");
+    // the frame being left records its high water mark for when its slot comes around again
+    slots[currentFrame].peakBytes = head + overflowBytes;
+
+    currentFrame = frameIndex;
+    head = 0;
+    overflowBytes = 0;
+
+    auto &slot = slots[currentFrame];
+    slot.overflow.clear();
+    if (slot.peakBytes > slot.capacity) {
+        // a quarter extra for the slack lost to alignment and for frames that grow a little more
+        slot.capacity = slot.peakBytes + slot.peakBytes / 4;
+        slot.memory = std::make_unique<std::byte[]>(slot.capacity);
+    }
+}
+
+void *SveFrameArena::do_allocate(size_t bytes, size_t alignment) {
+    auto &slot = slots[currentFrame];
+    uintptr_t base = reinterpret_cast<uintptr_t>(slot.memory.get());
+    uintptr_t aligned = (base + head + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+    size_t offset = aligned - base;
+    if (offset + bytes <= slot.capacity) {
+        head = offset + bytes;
+        return slot.memory.get() + offset;
+    }
+
+    // out of space, this frame takes it from the heap and the block grows on the next round
+    slot.overflow.push_back(std::make_unique<std::byte[]>(bytes + alignment));
+    overflowBytes += bytes + alignment;
+    uintptr_t overflow = reinterpret_cast<uintptr_t>(slot.overflow.back().get());
+    return reinterpret_cast<void *>((overflow + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1));
+}
+
+}  // namespace sve
@@ -0,0 +1,57 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <vector>
+
+namespace sve {
+
+// Linear allocator for CPU data that only lives while a frame is recorded, the host side sibling
+// of SveUniformAllocator: one block per frame in flight, bump allocated and rewound when its frame
+// slot comes around again, so the memory stays valid as long as the frame's descriptor sets and
+// uniform blocks do. It is a std::pmr::memory_resource, so std::pmr containers can be built on it
+// and their push_backs cost a pointer bump. Deallocation is a no-op.
+// A frame that outgrows its block falls back to the heap, and the block is regrown to fit the next
+// time the slot begins, so the steady state allocates nothing
+class SveFrameArena : public std::pmr::memory_resource {
+   public:
+    explicit SveFrameArena(uint32_t frameCount, size_t bytesPerFrame = 64 << 10);
+
+    SveFrameArena(const SveFrameArena &) = delete;
+    SveFrameArena &operator=(const SveFrameArena &) = delete;
+
+    // rewinds the slot, only call once nothing from the frame that last used it is referenced
+    void beginFrame(int frameIndex);
+
+    // uninitialized storage for count objects, never destroyed, so trivially destructible only
+    template <typename T>
+    T *allocateArray(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "Frame arena memory is never destroyed");
+        return static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    size_t bytesUsed() const { return head + overflowBytes; }
+    size_t getCapacity() const { return slots[currentFrame].capacity; }
+
+   private:
+    struct Slot {
+        std::unique_ptr<std::byte[]> memory;
+        size_t capacity;
+        std::vector<std::unique_ptr<std::byte[]>> overflow;  // heap fallbacks, freed on beginFrame
+        size_t peakBytes = 0;  // of the last frame in this slot, overflow included
+    };
+
+    void *do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void *, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+    std::vector<Slot> slots;
+    int currentFrame = 0;
+    size_t head = 0;
+    size_t overflowBytes = 0;
+};
+
+}  // namespace sve
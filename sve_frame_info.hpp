@@ -1,19 +1,42 @@
 #pragma once
 
 #include "sve_camera.hpp"
+#include "sve_descriptors.hpp"
+#include "sve_frame_arena.hpp"
 #include "sve_game_object.hpp"
+#include "sve_uniform_allocator.hpp"
 
 // lib
 #include <vulkan/vulkan.h>
 
 namespace sve {
 
+// matches SHADOW_CASCADE_COUNT in shaders/global_ubo.glsl
+constexpr uint32_t SHADOW_CASCADE_COUNT = 4;
+
+// matches shaders/global_ubo.glsl
+struct GlobalUbo {
+    glm::mat4 projectionView{1.f};
+    glm::vec4 ambientColor{1.f, 1.f, 1.f, .02f};
+    glm::uvec4 clusterGrid{0};     // cluster counts in x, y and z, w is the light count
+    glm::vec4 clusterParams{0.f};  // near, far, framebuffer width and height
+    glm::vec4 directionalLightDirection{0.f};  // direction the light travels
+    glm::vec4 directionalLightColor{0.f};      // w is intensity
+    glm::vec4 cascadeSplits{0.f};              // far view depth of each shadow cascade
+    glm::mat4 lightViewProjection[SHADOW_CASCADE_COUNT];
+};
+
 struct FrameInfo {
     int framIndex;
     float frameTime;
     VkCommandBuffer commandBuffer;
     SveCamera camera;
     VkDescriptorSet globalDescriptorSet;
+    uint32_t globalUboOffset;  // dynamic offset of this frame's GlobalUbo
+    VkDescriptorSet bindlessDescriptorSet;  // VK_NULL_HANDLE when descriptor indexing is unsupported
+    SveDescriptorAllocator &frameDescriptorAllocator;  // sets allocated here only live for this frame
+    SveUniformAllocator &uniformAllocator;             // per-frame uniform blocks, bind with dynamic offsets
+    SveFrameArena &frameArena;                         // CPU scratch memory, e.g. for std::pmr containers
     SveGameObject::Map &gameObjects;
 };
 
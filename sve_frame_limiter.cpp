@@ -0,0 +1,78 @@
+#include "sve_frame_limiter.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <thread>
+
+namespace sve {
+
+SveFrameLimiter::SveFrameLimiter(float targetFps, size_t historySize) : frameTimes(historySize, 0.f) {
+    assert(historySize > 0 && "Frame limiter needs room for at least one frame time");
+    setTargetFps(targetFps);
+}
+
+void SveFrameLimiter::setTargetFps(float fps) {
+    targetFps = std::max(fps, 0.f);
+    period = targetFps > 0.f ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(1.f / targetFps))
+                             : Clock::duration{0};
+    deadline = Clock::time_point{};  // restart the schedule on the next frame
+}
+
+void SveFrameLimiter::wait() {
+    if (period > Clock::duration{0}) {
+        auto now = Clock::now();
+        deadline += period;
+        // first frame, or more than a frame behind: don't try to catch up with a burst of frames
+        if (now - deadline > period) {
+            deadline = now;
+        }
+
+        auto sleepUntil = deadline - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float, std::milli>(spinMarginMs));
+        if (sleepUntil > now) {
+            std::this_thread::sleep_until(sleepUntil);
+            float overshootMs = std::chrono::duration<float, std::milli>(Clock::now() - sleepUntil).count();
+            spinMarginMs = std::clamp(.9f * spinMarginMs + .1f * 2.f * overshootMs, .1f, 4.f);
+        }
+        while (Clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+    }
+    record(Clock::now());
+}
+
+void SveFrameLimiter::record(Clock::time_point now) {
+    if (lastFrame != Clock::time_point{}) {
+        frameTimes[nextFrameTime] = std::chrono::duration<float, std::milli>(now - lastFrame).count();
+        nextFrameTime = (nextFrameTime + 1) % frameTimes.size();
+        frameTimeCount = std::min(frameTimeCount + 1, frameTimes.size());
+    }
+    lastFrame = now;
+    if (frameTimeCount == 0) {
+        return;
+    }
+
+    float sum = 0.f;
+    float minMs = frameTimes[0];
+    float maxMs = frameTimes[0];
+    for (size_t i = 0; i < frameTimeCount; i++) {
+        sum += frameTimes[i];
+        minMs = std::min(minMs, frameTimes[i]);
+        maxMs = std::max(maxMs, frameTimes[i]);
+    }
+    float mean = sum / frameTimeCount;
+    float squares = 0.f;
+    for (size_t i = 0; i < frameTimeCount; i++) {
+        squares += (frameTimes[i] - mean) * (frameTimes[i] - mean);
+    }
+
+    stats.meanMs = mean;
+    stats.varianceMs2 = squares / frameTimeCount;
+    stats.stdDevMs = std::sqrt(stats.varianceMs2);
+    stats.minMs = minMs;
+    stats.maxMs = maxMs;
+    stats.frames = frameTimeCount;
+}
+
+}  // namespace sve
@@ -0,0 +1,52 @@
+#pragma once
+
+// std
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+namespace sve {
+
+// Caps the frame rate on the CPU. A sleep only wakes up to a scheduler tick late, so it sleeps
+// until shortly before the deadline and spins for the rest, with the spin margin following how
+// much the sleeps actually overshoot. Frame time statistics are kept whether limiting or not
+class SveFrameLimiter {
+   public:
+    struct Stats {
+        float meanMs = 0.f;
+        float varianceMs2 = 0.f;  // of the frame time, in ms squared
+        float stdDevMs = 0.f;
+        float minMs = 0.f;
+        float maxMs = 0.f;
+        size_t frames = 0;  // the statistics cover this many of the last frames
+    };
+
+    explicit SveFrameLimiter(float targetFps = 0.f, size_t historySize = 240);
+
+    // 0 turns limiting off
+    void setTargetFps(float fps);
+    float getTargetFps() const { return targetFps; }
+
+    // once per frame, blocks until the frame is due
+    void wait();
+
+    const Stats &getStats() const { return stats; }
+
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    void record(Clock::time_point now);
+
+    float targetFps = 0.f;
+    Clock::duration period{0};
+    Clock::time_point deadline{};
+    float spinMarginMs = 1.f;
+
+    Clock::time_point lastFrame{};
+    std::vector<float> frameTimes;  // ring buffer, ms
+    size_t nextFrameTime = 0;
+    size_t frameTimeCount = 0;
+    Stats stats{};
+};
+
+}  // namespace sve
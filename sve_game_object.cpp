@@ -60,4 +60,13 @@ glm::mat3 TransformComponent::normalMatrix() {
     };
 }
 
+SveGameObject SveGameObject::makePointLight(float intensity, float range, glm::vec3 color) {
+    SveGameObject gameObj = SveGameObject::createGameObject();
+    gameObj.color = color;
+    gameObj.pointLight = std::make_unique<PointLightComponent>();
+    gameObj.pointLight->lightIntensity = intensity;
+    gameObj.pointLight->range = range;
+    return gameObj;
+}
+
 }  // namespace sve
\ No newline at end of file
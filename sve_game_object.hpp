@@ -23,6 +23,12 @@ struct TransformComponent {
     glm::mat3 normalMatrix();
 };
 
+// lit position is transform.translation, color is the game object's color
+struct PointLightComponent {
+    float lightIntensity = 1.f;
+    float range = 10.f;  // light is faded to zero at this distance so it can be culled per cluster
+};
+
 class SveGameObject {
    public:
     using id_t = unsigned int;
@@ -33,6 +39,8 @@ class SveGameObject {
         return SveGameObject(currentId++);
     }
 
+    static SveGameObject makePointLight(float intensity = 10.f, float range = 10.f, glm::vec3 color = glm::vec3(1.f));
+
     SveGameObject(const SveGameObject &) = delete;
     SveGameObject &operator=(const SveGameObject &) = delete;
     SveGameObject(SveGameObject &&) = default;
@@ -43,6 +51,11 @@ class SveGameObject {
     std::shared_ptr<SveModel> model;  // shared model among all game objects
     glm::vec3 color{};
     TransformComponent transform{};
+    // expected to move every frame: left out of the cached shadow cascades and drawn over them instead
+    bool dynamic = false;
+
+    // optional components
+    std::unique_ptr<PointLightComponent> pointLight = nullptr;
 
    private:
     SveGameObject(id_t objId) : id(objId) {}  // private constructor to force use of factory method
@@ -0,0 +1,243 @@
+#include "sve_gpu_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <stdexcept>
+
+namespace sve {
+
+SveGpuProfiler::SveGpuProfiler(SveDevice &device, uint32_t maxScopesPerFrame, size_t historySize)
+    : sveDevice{device}, maxScopes{maxScopesPerFrame}, historySize{historySize} {
+    assert(maxScopesPerFrame > 0 && historySize > 0 && "GPU profiler needs room for scopes and history");
+
+    uint32_t graphicsFamily = sveDevice.findPhysicalQueueFamilies().graphicsFamily;
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(sveDevice.getPhysicalDevice(), &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(sveDevice.getPhysicalDevice(), &familyCount, families.data());
+    uint32_t validBits = families[graphicsFamily].timestampValidBits;
+
+    supported = validBits > 0;
+    if (!supported) {
+        return;
+    }
+    timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+    timestampPeriodMs = sveDevice.properties.limits.timestampPeriod * 1e-6f;
+
+    for (auto &slot : frameSlots) {
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = 2 * maxScopes;
+        if (vkCreateQueryPool(sveDevice.device(), &queryPoolInfo, nullptr, &slot.timestampPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create profiler timestamp query pool!");
+        }
+
+        if (sveDevice.supportsPipelineStatistics()) {
+            queryPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+            queryPoolInfo.queryCount = maxScopes;
+            queryPoolInfo.pipelineStatistics = STATISTICS;
+            if (vkCreateQueryPool(sveDevice.device(), &queryPoolInfo, nullptr, &slot.statisticsPool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create profiler statistics query pool!");
+            }
+        }
+        slot.scopes.reserve(maxScopes);
+    }
+    timestamps.resize(2 * maxScopes);
+    statistics.resize(STATISTICS_COUNT * maxScopes);
+}
+
+SveGpuProfiler::~SveGpuProfiler() {
+    for (auto &slot : frameSlots) {
+        if (slot.timestampPool != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(sveDevice.device(), slot.timestampPool, nullptr);
+        }
+        if (slot.statisticsPool != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(sveDevice.device(), slot.statisticsPool, nullptr);
+        }
+    }
+}
+
+void SveGpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+    if (!supported) {
+        return;
+    }
+    assert(activeStatisticsScope == NO_SCOPE && "Statistics scope left open across frames");
+    currentSlot = &frameSlots[frameIndex];
+    collect(*currentSlot);
+
+    vkCmdResetQueryPool(commandBuffer, currentSlot->timestampPool, 0, 2 * maxScopes);
+    if (currentSlot->statisticsPool != VK_NULL_HANDLE) {
+        vkCmdResetQueryPool(commandBuffer, currentSlot->statisticsPool, 0, maxScopes);
+    }
+}
+
+uint32_t SveGpuProfiler::beginScope(VkCommandBuffer commandBuffer, const std::string &name, bool statistics) {
+    if (!supported) {
+        return NO_SCOPE;
+    }
+    assert(currentSlot != nullptr && "Profiler scope begun before beginFrame");
+    auto &slot = *currentSlot;
+    if (slot.scopes.size() >= maxScopes) {
+        return NO_SCOPE;  // out of queries, dropped rather than overflowing the pool
+    }
+
+    uint32_t scope = static_cast<uint32_t>(slot.scopes.size());
+    RecordedScope recorded{historyIndex(name), NO_SCOPE};
+    if (statistics && slot.statisticsPool != VK_NULL_HANDLE) {
+        assert(activeStatisticsScope == NO_SCOPE && "Statistics scopes can't nest");
+        recorded.statisticsQuery = slot.statisticsCount++;
+        vkCmdBeginQuery(commandBuffer, slot.statisticsPool, recorded.statisticsQuery, 0);
+        activeStatisticsScope = scope;
+    }
+    slot.scopes.push_back(recorded);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, slot.timestampPool, 2 * scope);
+    return scope;
+}
+
+void SveGpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t scope) {
+    if (scope == NO_SCOPE) {
+        return;
+    }
+    auto &slot = *currentSlot;
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, slot.timestampPool, 2 * scope + 1);
+    if (slot.scopes[scope].statisticsQuery != NO_SCOPE) {
+        vkCmdEndQuery(commandBuffer, slot.statisticsPool, slot.scopes[scope].statisticsQuery);
+        activeStatisticsScope = NO_SCOPE;
+    }
+}
+
+// the renderer waited for the slot's frame before beginFrame, so nothing here waits. If a result
+// isn't available anyway, that frame's scopes are skipped
+void SveGpuProfiler::collect(FrameSlot &slot) {
+    uint32_t scopeCount = static_cast<uint32_t>(slot.scopes.size());
+    if (scopeCount == 0) {
+        return;
+    }
+
+    bool timesValid = vkGetQueryPoolResults(
+                          sveDevice.device(),
+                          slot.timestampPool,
+                          0,
+                          2 * scopeCount,
+                          2 * scopeCount * sizeof(uint64_t),
+                          timestamps.data(),
+                          sizeof(uint64_t),
+                          VK_QUERY_RESULT_64_BIT) == VK_SUCCESS;
+    bool statisticsValid = slot.statisticsCount > 0 &&
+                           vkGetQueryPoolResults(
+                               sveDevice.device(),
+                               slot.statisticsPool,
+                               0,
+                               slot.statisticsCount,
+                               slot.statisticsCount * STATISTICS_COUNT * sizeof(uint64_t),
+                               statistics.data(),
+                               STATISTICS_COUNT * sizeof(uint64_t),
+                               VK_QUERY_RESULT_64_BIT) == VK_SUCCESS;
+
+    for (uint32_t i = 0; i < scopeCount && timesValid; i++) {
+        auto &history = histories[slot.scopes[i].historyIndex];
+        uint64_t ticks = (timestamps[2 * i + 1] - timestamps[2 * i]) & timestampMask;
+        history.timesMs[history.next] = static_cast<float>(ticks) * timestampPeriodMs;
+        history.next = (history.next + 1) % historySize;
+        history.count = std::min(history.count + 1, historySize);
+
+        uint32_t query = slot.scopes[i].statisticsQuery;
+        if (statisticsValid && query != NO_SCOPE) {
+            for (uint32_t s = 0; s < STATISTICS_COUNT; s++) {
+                history.statisticsSum[s] += statistics[STATISTICS_COUNT * query + s];
+            }
+            history.statisticsSamples++;
+        }
+    }
+    slot.scopes.clear();
+    slot.statisticsCount = 0;
+}
+
+uint32_t SveGpuProfiler::historyIndex(const std::string &name) {
+    auto it = historyIndices.find(name);
+    if (it != historyIndices.end()) {
+        return it->second;
+    }
+    uint32_t index = static_cast<uint32_t>(histories.size());
+    histories.push_back({name, std::vector<float>(historySize, 0.f)});
+    historyIndices.emplace(name, index);
+    return index;
+}
+
+std::vector<SveGpuProfiler::ScopeStats> SveGpuProfiler::getStats() const {
+    std::vector<ScopeStats> result;
+    result.reserve(histories.size());
+    std::vector<float> sorted;
+    for (const auto &history : histories) {
+        ScopeStats stats{};
+        stats.name = history.name;
+        stats.samples = history.count;
+        if (history.count > 0) {
+            sorted.assign(history.timesMs.begin(), history.timesMs.begin() + history.count);
+            std::sort(sorted.begin(), sorted.end());
+            auto percentile = [&](float p) {
+                size_t index = static_cast<size_t>(p * static_cast<float>(sorted.size() - 1) + .5f);
+                return sorted[index];
+            };
+            float sum = 0.f;
+            for (float ms : sorted) {
+                sum += ms;
+            }
+            stats.avgMs = sum / static_cast<float>(sorted.size());
+            stats.p50Ms = percentile(.5f);
+            stats.p95Ms = percentile(.95f);
+            stats.p99Ms = percentile(.99f);
+            stats.maxMs = sorted.back();
+        }
+        if (history.statisticsSamples > 0) {
+            stats.vertexInvocations = history.statisticsSum[0] / history.statisticsSamples;
+            stats.clippingInvocations = history.statisticsSum[1] / history.statisticsSamples;
+            stats.clippingPrimitives = history.statisticsSum[2] / history.statisticsSamples;
+            stats.fragmentInvocations = history.statisticsSum[3] / history.statisticsSamples;
+        }
+        result.push_back(std::move(stats));
+    }
+    return result;
+}
+
+bool SveGpuProfiler::writeCsv(const std::string &path) const {
+    std::ofstream file{path};
+    if (!file) {
+        return false;
+    }
+    file << "scope,samples,avg_ms,p50_ms,p95_ms,p99_ms,max_ms,vertex_invocations,clipping_invocations,"
+            "clipping_primitives,fragment_invocations\n";
+    for (const auto &stats : getStats()) {
+        file << stats.name << ',' << stats.samples << ',' << stats.avgMs << ',' << stats.p50Ms << ','
+             << stats.p95Ms << ',' << stats.p99Ms << ',' << stats.maxMs << ',' << stats.vertexInvocations << ','
+             << stats.clippingInvocations << ',' << stats.clippingPrimitives << ',' << stats.fragmentInvocations
+             << '\n';
+    }
+    return static_cast<bool>(file);
+}
+
+bool SveGpuProfiler::writeJson(const std::string &path) const {
+    std::ofstream file{path};
+    if (!file) {
+        return false;
+    }
+    // scope names are code literals, no escaping needed
+    file << "{\n  \"scopes\": [";
+    auto allStats = getStats();
+    for (size_t i = 0; i < allStats.size(); i++) {
+        const auto &stats = allStats[i];
+        file << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << stats.name << "\", \"samples\": " << stats.samples
+             << ", \"avg_ms\": " << stats.avgMs << ", \"p50_ms\": " << stats.p50Ms << ", \"p95_ms\": "
+             << stats.p95Ms << ", \"p99_ms\": " << stats.p99Ms << ", \"max_ms\": " << stats.maxMs
+             << ", \"vertex_invocations\": " << stats.vertexInvocations << ", \"clipping_invocations\": "
+             << stats.clippingInvocations << ", \"clipping_primitives\": " << stats.clippingPrimitives
+             << ", \"fragment_invocations\": " << stats.fragmentInvocations << "}";
+    }
+    file << "\n  ]\n}\n";
+    return static_cast<bool>(file);
+}
+
+}  // namespace sve
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "sve_device.hpp"
+#include "sve_swap_chain.hpp"
+
+// std
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sve {
+
+// GPU time per scope. Scopes are bracketed with timestamps written into the frame slot's query
+// pools, and optionally with a pipeline statistics query counting vertex, clipping and fragment
+// work. Results are read back without waiting when the slot comes around again, frames in flight
+// later, and kept as a history per scope name for averages and percentiles
+class SveGpuProfiler {
+   public:
+    struct ScopeStats {
+        std::string name;
+        size_t samples = 0;  // frames the scope was recorded in, up to the history size
+        float avgMs = 0.f;
+        float p50Ms = 0.f;
+        float p95Ms = 0.f;
+        float p99Ms = 0.f;
+        float maxMs = 0.f;
+        // averages over the frames the scope had statistics in, zero without
+        uint64_t vertexInvocations = 0;
+        uint64_t clippingInvocations = 0;  // primitives entering clipping
+        uint64_t clippingPrimitives = 0;   // primitives leaving it
+        uint64_t fragmentInvocations = 0;
+    };
+
+    SveGpuProfiler(SveDevice &device, uint32_t maxScopesPerFrame = 32, size_t historySize = 256);
+    ~SveGpuProfiler();
+
+    SveGpuProfiler(const SveGpuProfiler &) = delete;
+    SveGpuProfiler &operator=(const SveGpuProfiler &) = delete;
+
+    // false when the queue doesn't support timestamps, every call is a no-op then
+    bool isSupported() const { return supported; }
+
+    // right after SveRenderer::beginFrame, outside any render pass. The slot's last frame has
+    // completed by then, so its results are collected before the queries are reset
+    void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+    // scopes may nest, scopes with statistics may not, and neither may overlap another pipeline
+    // statistics query (like SveRenderer's fragment statistics). A statistics scope begun inside
+    // a render pass has to end in the same subpass. Returns the id for endScope
+    uint32_t beginScope(VkCommandBuffer commandBuffer, const std::string &name, bool statistics = false);
+    void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+    std::vector<ScopeStats> getStats() const;
+    // one row per scope, times in milliseconds. Return false if the file can't be written
+    bool writeCsv(const std::string &path) const;
+    bool writeJson(const std::string &path) const;
+
+   private:
+    static constexpr uint32_t NO_SCOPE = ~0u;
+    // statistics values in the order Vulkan writes them, by ascending flag bit
+    static constexpr VkQueryPipelineStatisticFlags STATISTICS =
+        VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+    static constexpr uint32_t STATISTICS_COUNT = 4;
+
+    struct RecordedScope {
+        uint32_t historyIndex;
+        uint32_t statisticsQuery;  // NO_SCOPE without statistics
+    };
+    struct FrameSlot {
+        VkQueryPool timestampPool = VK_NULL_HANDLE;   // begin and end per scope
+        VkQueryPool statisticsPool = VK_NULL_HANDLE;  // null without pipelineStatisticsQuery
+        std::vector<RecordedScope> scopes;
+        uint32_t statisticsCount = 0;
+    };
+    struct History {
+        std::string name;
+        std::vector<float> timesMs;  // ring buffer
+        size_t next = 0;
+        size_t count = 0;
+        std::array<uint64_t, STATISTICS_COUNT> statisticsSum{};
+        uint64_t statisticsSamples = 0;
+    };
+
+    void collect(FrameSlot &slot);
+    uint32_t historyIndex(const std::string &name);
+
+    SveDevice &sveDevice;
+    bool supported = false;
+    uint32_t maxScopes;
+    size_t historySize;
+    float timestampPeriodMs;
+    uint64_t timestampMask;  // only timestampValidBits of a timestamp are meaningful
+
+    std::array<FrameSlot, SveSwapChain::MAX_FRAMES_IN_FLIGHT> frameSlots;
+    FrameSlot *currentSlot = nullptr;
+    uint32_t activeStatisticsScope = NO_SCOPE;
+
+    std::vector<History> histories;
+    std::unordered_map<std::string, uint32_t> historyIndices;
+
+    // scratch for collect
+    std::vector<uint64_t> timestamps;
+    std::vector<uint64_t> statistics;
+};
+
+}  // namespace sve
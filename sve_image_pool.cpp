@@ -0,0 +1,106 @@
+#include "sve_image_pool.hpp"
+
+// std
+#include <iterator>
+#include <stdexcept>
+
+namespace sve {
+
+SveImagePool::SveImagePool(SveDevice &device, size_t maxFreeImages)
+    : sveDevice{device}, maxFreeImages{maxFreeImages} {}
+
+SveImagePool::~SveImagePool() {
+    for (auto &image : freeImages) {
+        destroy(image);
+    }
+}
+
+VkExtent2D SveImagePool::sizeClass(VkExtent2D extent) {
+    auto roundUp = [](uint32_t size) {
+        return (size + SIZE_CLASS_GRANULARITY - 1) / SIZE_CLASS_GRANULARITY * SIZE_CLASS_GRANULARITY;
+    };
+    return {roundUp(extent.width), roundUp(extent.height)};
+}
+
+SveImagePool::Image SveImagePool::acquire(
+    VkFormat format,
+    VkImageUsageFlags usage,
+    VkMemoryPropertyFlags properties,
+    VkExtent2D extent) {
+    VkExtent2D classExtent = sizeClass(extent);
+    // newest first, it's the most likely to still be resident
+    for (auto it = freeImages.rbegin(); it != freeImages.rend(); ++it) {
+        if (it->format == format && it->usage == usage && it->properties == properties &&
+            it->extent.width == classExtent.width && it->extent.height == classExtent.height) {
+            Image image = *it;
+            freeImages.erase(std::next(it).base());
+            return image;
+        }
+    }
+    return create(format, usage, properties, classExtent);
+}
+
+void SveImagePool::release(Image &image) {
+    if (image.image == VK_NULL_HANDLE) {
+        return;
+    }
+    freeImages.push_back(image);
+    image = Image{};
+    while (freeImages.size() > maxFreeImages) {
+        destroy(freeImages.front());
+        freeImages.erase(freeImages.begin());
+    }
+}
+
+SveImagePool::Image SveImagePool::create(
+    VkFormat format,
+    VkImageUsageFlags usage,
+    VkMemoryPropertyFlags properties,
+    VkExtent2D extent) {
+    Image image{};
+    image.format = format;
+    image.usage = usage;
+    image.properties = properties;
+    image.extent = extent;
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = extent.width;
+    imageInfo.extent.height = extent.height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = format;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = usage;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    sveDevice.createImageWithInfo(imageInfo, properties, image.image, image.allocation);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange.aspectMask = (usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)
+                                               ? VK_IMAGE_ASPECT_DEPTH_BIT
+                                               : VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+    if (vkCreateImageView(sveDevice.device(), &viewInfo, nullptr, &image.view) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pooled image view!");
+    }
+    return image;
+}
+
+void SveImagePool::destroy(Image &image) {
+    vkDestroyImageView(sveDevice.device(), image.view, nullptr);
+    sveDevice.destroyImage(image.image, image.allocation);
+    image = Image{};
+}
+
+}  // namespace sve
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "sve_device.hpp"
+
+// std
+#include <vector>
+
+namespace sve {
+
+// Recycles 2D attachment images across swap chain recreations. Extents are rounded up to a size
+// class, so while a window is being resized most new swap chains find images that fit in the pool
+// instead of allocating. Images handed out are at least as large as requested, framebuffers and
+// render areas use the requested extent
+class SveImagePool {
+   public:
+    static constexpr uint32_t SIZE_CLASS_GRANULARITY = 128;  // pixels
+
+    struct Image {
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        SveAllocation allocation{};
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        VkImageUsageFlags usage = 0;
+        VkMemoryPropertyFlags properties = 0;
+        VkExtent2D extent{0, 0};  // of the size class, not of the request
+    };
+
+    SveImagePool(SveDevice &device, size_t maxFreeImages = 16);
+    ~SveImagePool();
+
+    SveImagePool(const SveImagePool &) = delete;
+    SveImagePool &operator=(const SveImagePool &) = delete;
+
+    Image acquire(VkFormat format, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkExtent2D extent);
+    // the GPU must be done with the image, the pool may hand it out again right away
+    void release(Image &image);
+
+    size_t freeImageCount() const { return freeImages.size(); }
+
+   private:
+    static VkExtent2D sizeClass(VkExtent2D extent);
+    Image create(VkFormat format, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkExtent2D extent);
+    void destroy(Image &image);
+
+    SveDevice &sveDevice;
+    size_t maxFreeImages;
+    std::vector<Image> freeImages;  // oldest first
+};
+
+}  // namespace sve
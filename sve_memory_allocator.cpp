@@ -0,0 +1,540 @@
+#include "sve_memory_allocator.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace sve {
+
+// *************** Memory Block *********************
+
+SveMemoryBlock::SveMemoryBlock(VkDevice device, uint32_t memoryTypeIndex, VkDeviceSize size, bool hostVisible)
+    : device{device}, size{size} {
+    assert(size >= MIN_ALLOCATION_SIZE && (size & (size - 1)) == 0 && "Block size must be a power of two");
+
+    maxOrder = 0;
+    while (orderSize(maxOrder) < size) {
+        maxOrder++;
+    }
+    freeLists.resize(maxOrder + 1);
+    freeLists[maxOrder].insert(0);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate device memory block!");
+    }
+
+    if (hostVisible && vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+        vkFreeMemory(device, memory, nullptr);  // the destructor doesn't run for a throwing constructor
+        throw std::runtime_error("failed to map device memory block!");
+    }
+}
+
+SveMemoryBlock::~SveMemoryBlock() {
+    if (mapped) {
+        vkUnmapMemory(device, memory);
+    }
+    vkFreeMemory(device, memory, nullptr);
+}
+
+bool SveMemoryBlock::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset, uint32_t &order) {
+    // sub-blocks are aligned to their size, so rounding up to the alignment satisfies it too
+    VkDeviceSize needed = std::max({size, alignment, MIN_ALLOCATION_SIZE});
+    order = 0;
+    while (orderSize(order) < needed) {
+        order++;
+    }
+    if (order > maxOrder) {
+        return false;
+    }
+
+    uint32_t splitOrder = order;
+    while (splitOrder <= maxOrder && freeLists[splitOrder].empty()) {
+        splitOrder++;
+    }
+    if (splitOrder > maxOrder) {
+        return false;
+    }
+
+    offset = *freeLists[splitOrder].begin();
+    freeLists[splitOrder].erase(freeLists[splitOrder].begin());
+
+    // split down, the upper halves go back on the free lists
+    while (splitOrder > order) {
+        splitOrder--;
+        freeLists[splitOrder].insert(offset + orderSize(splitOrder));
+    }
+
+    usedBytes += orderSize(order);
+    allocationCount++;
+    return true;
+}
+
+void SveMemoryBlock::free(VkDeviceSize offset, uint32_t order) {
+    assert(allocationCount > 0 && "Freeing from an empty memory block");
+    usedBytes -= orderSize(order);
+    allocationCount--;
+
+    // merge with the buddy for as long as it is free
+    while (order < maxOrder) {
+        VkDeviceSize buddy = offset ^ orderSize(order);
+        auto it = freeLists[order].find(buddy);
+        if (it == freeLists[order].end()) {
+            break;
+        }
+        freeLists[order].erase(it);
+        offset = std::min(offset, buddy);
+        order++;
+    }
+    freeLists[order].insert(offset);
+}
+
+// *************** Memory Allocator *********************
+
+SveMemoryAllocator::SveMemoryAllocator(
+    VkPhysicalDevice physicalDevice,
+    VkDevice device,
+    const VkPhysicalDeviceProperties &properties,
+    bool memoryBudgetSupported)
+    : physicalDevice{physicalDevice}, device{device}, memoryBudgetSupported{memoryBudgetSupported} {
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+    bufferImageGranularity = properties.limits.bufferImageGranularity;
+    maxAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+    pools.resize(memoryProperties.memoryTypeCount * 2);
+    heapStats.resize(memoryProperties.memoryHeapCount);
+    blockSizes.resize(memoryProperties.memoryHeapCount);
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+        VkDeviceSize heapSize = memoryProperties.memoryHeaps[i].size;
+        heapStats[i].heapSize = heapSize;
+
+        // small heaps (e.g. the 256 MiB host visible BAR) get smaller blocks, at most 1/8 of the heap
+        VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE;
+        while (blockSize > heapSize / 8 && blockSize > (1ull << 20)) {
+            blockSize >>= 1;
+        }
+        blockSizes[i] = blockSize;
+    }
+}
+
+SveMemoryAllocator::~SveMemoryAllocator() {
+    for (auto &stats : heapStats) {
+        assert(stats.allocationCount == 0 && "Memory allocator destroyed with live allocations");
+    }
+}
+
+uint32_t SveMemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) &&
+            (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+bool SveMemoryAllocator::isHostVisible(uint32_t memoryTypeIndex) const {
+    return memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+}
+
+bool SveMemoryAllocator::isHostCoherent(uint32_t memoryTypeIndex) const {
+    return memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+}
+
+SveMemoryAllocator::Pool &SveMemoryAllocator::getPool(uint32_t memoryTypeIndex, bool linear) {
+    // buddy sub-blocks are at least MIN_ALLOCATION_SIZE aligned, so below that granularity linear and
+    // optimal resources can never share a page and one pool is enough
+    bool separate = bufferImageGranularity > SveMemoryBlock::MIN_ALLOCATION_SIZE;
+    return pools[memoryTypeIndex * 2 + (separate && !linear ? 1 : 0)];
+}
+
+SveAllocation SveMemoryAllocator::allocateForBuffer(
+    VkBuffer buffer, VkMemoryPropertyFlags properties, SveMemoryCategory category) {
+    VkMemoryDedicatedRequirements dedicatedRequirements{};
+    dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+    VkMemoryRequirements2 memRequirements{};
+    memRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    memRequirements.pNext = &dedicatedRequirements;
+
+    VkBufferMemoryRequirementsInfo2 requirementsInfo{};
+    requirementsInfo.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+    requirementsInfo.buffer = buffer;
+    vkGetBufferMemoryRequirements2(device, &requirementsInfo, &memRequirements);
+
+    bool dedicated = dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+    SveAllocation allocation = allocate(
+        memRequirements.memoryRequirements,
+        properties,
+        category,
+        true,
+        dedicated,
+        buffer,
+        VK_NULL_HANDLE);
+
+    if (vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+        free(allocation);
+        throw std::runtime_error("failed to bind buffer memory!");
+    }
+    return allocation;
+}
+
+SveAllocation SveMemoryAllocator::allocateForImage(
+    VkImage image, VkImageTiling tiling, VkMemoryPropertyFlags properties, SveMemoryCategory category) {
+    VkMemoryDedicatedRequirements dedicatedRequirements{};
+    dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+    VkMemoryRequirements2 memRequirements{};
+    memRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    memRequirements.pNext = &dedicatedRequirements;
+
+    VkImageMemoryRequirementsInfo2 requirementsInfo{};
+    requirementsInfo.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+    requirementsInfo.image = image;
+    vkGetImageMemoryRequirements2(device, &requirementsInfo, &memRequirements);
+
+    bool dedicated = dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+    SveAllocation allocation = allocate(
+        memRequirements.memoryRequirements,
+        properties,
+        category,
+        tiling == VK_IMAGE_TILING_LINEAR,
+        dedicated,
+        VK_NULL_HANDLE,
+        image);
+
+    if (vkBindImageMemory(device, image, allocation.memory, allocation.offset) != VK_SUCCESS) {
+        free(allocation);
+        throw std::runtime_error("failed to bind image memory!");
+    }
+    return allocation;
+}
+
+SveAllocation SveMemoryAllocator::allocateMemory(
+    const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties, SveMemoryCategory category) {
+    return allocate(requirements, properties, category, false, false, VK_NULL_HANDLE, VK_NULL_HANDLE);
+}
+
+SveAllocation SveMemoryAllocator::allocate(
+    const VkMemoryRequirements &requirements,
+    VkMemoryPropertyFlags properties,
+    SveMemoryCategory category,
+    bool linear,
+    bool dedicated,
+    VkBuffer dedicatedBuffer,
+    VkImage dedicatedImage) {
+    std::lock_guard<std::mutex> lock{mutex};
+
+    uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+    uint32_t heap = heapIndex(memoryTypeIndex);
+    VkDeviceSize blockSize = blockSizes[heap];
+
+    // anything over half a block would waste most of a buddy block, give it its own memory
+    if (dedicated || requirements.size > blockSize / 2) {
+        SveAllocation allocation = allocateDedicated(requirements, memoryTypeIndex, dedicatedBuffer, dedicatedImage);
+        allocation.category = category;
+        trackCategory(allocation, true);
+        return allocation;
+    }
+
+    SveAllocation allocation{};
+    allocation.size = requirements.size;
+    allocation.memoryTypeIndex = memoryTypeIndex;
+    allocation.category = category;
+
+    Pool &pool = getPool(memoryTypeIndex, linear);
+    for (auto &block : pool.blocks) {
+        if (!block->isDraining() && block->allocate(requirements.size, requirements.alignment, allocation.offset, allocation.order)) {
+            allocation.block = block.get();
+            break;
+        }
+    }
+
+    if (allocation.block == nullptr) {
+        if (deviceAllocationCount >= maxAllocationCount) {
+            throw std::runtime_error("maxMemoryAllocationCount reached!");
+        }
+        pool.blocks.push_back(std::make_unique<SveMemoryBlock>(device, memoryTypeIndex, blockSize, isHostVisible(memoryTypeIndex)));
+        deviceAllocationCount++;
+        heapStats[heap].blockBytes += blockSize;
+        heapStats[heap].blockCount++;
+
+        allocation.block = pool.blocks.back().get();
+        if (!allocation.block->allocate(requirements.size, requirements.alignment, allocation.offset, allocation.order)) {
+            throw std::runtime_error("failed to sub-allocate from a fresh memory block!");
+        }
+    }
+
+    allocation.memory = allocation.block->getMemory();
+    if (allocation.block->getMapped()) {
+        allocation.mapped = static_cast<char *>(allocation.block->getMapped()) + allocation.offset;
+    }
+
+    heapStats[heap].allocatedBytes += reservedSize(allocation);
+    heapStats[heap].allocationCount++;
+    trackCategory(allocation, true);
+    return allocation;
+}
+
+SveAllocation SveMemoryAllocator::allocateDedicated(
+    const VkMemoryRequirements &requirements,
+    uint32_t memoryTypeIndex,
+    VkBuffer dedicatedBuffer,
+    VkImage dedicatedImage) {
+    if (deviceAllocationCount >= maxAllocationCount) {
+        throw std::runtime_error("maxMemoryAllocationCount reached!");
+    }
+
+    VkMemoryDedicatedAllocateInfo dedicatedInfo{};
+    dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+    dedicatedInfo.buffer = dedicatedBuffer;
+    dedicatedInfo.image = dedicatedImage;
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.pNext = &dedicatedInfo;
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    SveAllocation allocation{};
+    allocation.size = requirements.size;
+    allocation.memoryTypeIndex = memoryTypeIndex;
+
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &allocation.memory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate dedicated device memory!");
+    }
+    if (isHostVisible(memoryTypeIndex) &&
+        vkMapMemory(device, allocation.memory, 0, VK_WHOLE_SIZE, 0, &allocation.mapped) != VK_SUCCESS) {
+        vkFreeMemory(device, allocation.memory, nullptr);
+        throw std::runtime_error("failed to map dedicated device memory!");
+    }
+    deviceAllocationCount++;
+
+    auto &stats = heapStats[heapIndex(memoryTypeIndex)];
+    stats.blockBytes += requirements.size;
+    stats.allocatedBytes += requirements.size;
+    stats.allocationCount++;
+    stats.dedicatedCount++;
+    return allocation;
+}
+
+void SveMemoryAllocator::free(SveAllocation &allocation) {
+    if (allocation.memory == VK_NULL_HANDLE) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock{mutex};
+
+    uint32_t heap = heapIndex(allocation.memoryTypeIndex);
+    auto &stats = heapStats[heap];
+    stats.allocationCount--;
+    trackCategory(allocation, false);
+
+    if (allocation.block == nullptr) {
+        if (allocation.mapped) {
+            vkUnmapMemory(device, allocation.memory);
+        }
+        vkFreeMemory(device, allocation.memory, nullptr);
+        deviceAllocationCount--;
+        stats.blockBytes -= allocation.size;
+        stats.allocatedBytes -= allocation.size;
+        stats.dedicatedCount--;
+    } else {
+        SveMemoryBlock *block = allocation.block;
+        block->free(allocation.offset, allocation.order);
+        stats.allocatedBytes -= reservedSize(allocation);
+
+        // give empty blocks back to the driver, but keep the last one of each pool around so a
+        // single allocation going back and forth doesn't hit vkAllocateMemory every time
+        if (block->empty()) {
+            for (auto &pool : pools) {
+                auto it = std::find_if(pool.blocks.begin(), pool.blocks.end(), [block](const std::unique_ptr<SveMemoryBlock> &b) {
+                    return b.get() == block;
+                });
+                if (it == pool.blocks.end()) {
+                    continue;
+                }
+                if (pool.blocks.size() > 1) {
+                    stats.blockBytes -= block->getSize();
+                    stats.blockCount--;
+                    deviceAllocationCount--;
+                    pool.blocks.erase(it);
+                }
+                break;
+            }
+        }
+    }
+
+    allocation = SveAllocation{};
+}
+
+VkDeviceSize SveMemoryAllocator::reservedSize(const SveAllocation &allocation) {
+    return allocation.block ? SveMemoryBlock::orderSize(allocation.order) : allocation.size;
+}
+
+void SveMemoryAllocator::trackCategory(const SveAllocation &allocation, bool allocated) {
+    auto &stats = categoryStats[static_cast<uint32_t>(allocation.category)];
+    VkDeviceSize size = reservedSize(allocation);
+    uint32_t heap = heapIndex(allocation.memoryTypeIndex);
+    bool deviceLocal = memoryProperties.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+    if (allocated) {
+        stats.allocatedBytes += size;
+        stats.deviceLocalBytes += deviceLocal ? size : 0;
+        stats.allocationCount++;
+    } else {
+        assert(stats.allocationCount > 0 && "Freeing from an empty memory category");
+        stats.allocatedBytes -= size;
+        stats.deviceLocalBytes -= deviceLocal ? size : 0;
+        stats.allocationCount--;
+    }
+}
+
+VkMappedMemoryRange SveMemoryAllocator::mappedRange(
+    const SveAllocation &allocation, VkDeviceSize offset, VkDeviceSize size) const {
+    VkDeviceSize memorySize = allocation.block ? allocation.block->getSize() : allocation.size;
+    VkDeviceSize begin = allocation.offset + offset;
+    VkDeviceSize end = size == VK_WHOLE_SIZE ? allocation.offset + allocation.size : begin + size;
+
+    // ranges must be multiples of nonCoherentAtomSize, or run to the end of the memory object
+    begin = begin / nonCoherentAtomSize * nonCoherentAtomSize;
+    end = std::min((end + nonCoherentAtomSize - 1) / nonCoherentAtomSize * nonCoherentAtomSize, memorySize);
+
+    VkMappedMemoryRange range{};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = allocation.memory;
+    range.offset = begin;
+    range.size = end == memorySize ? VK_WHOLE_SIZE : end - begin;
+    return range;
+}
+
+VkResult SveMemoryAllocator::flush(const SveAllocation &allocation, VkDeviceSize offset, VkDeviceSize size) {
+    if (isHostCoherent(allocation.memoryTypeIndex)) {
+        return VK_SUCCESS;
+    }
+    VkMappedMemoryRange range = mappedRange(allocation, offset, size);
+    return vkFlushMappedMemoryRanges(device, 1, &range);
+}
+
+VkResult SveMemoryAllocator::invalidate(const SveAllocation &allocation, VkDeviceSize offset, VkDeviceSize size) {
+    if (isHostCoherent(allocation.memoryTypeIndex)) {
+        return VK_SUCCESS;
+    }
+    VkMappedMemoryRange range = mappedRange(allocation, offset, size);
+    return vkInvalidateMappedMemoryRanges(device, 1, &range);
+}
+
+uint32_t SveMemoryAllocator::beginDefragmentation(float maxOccupancy) {
+    std::lock_guard<std::mutex> lock{mutex};
+
+    uint32_t marked = 0;
+    for (auto &pool : pools) {
+        if (pool.blocks.size() < 2) {
+            continue;
+        }
+        // the fullest block stays open so relocated resources have somewhere to land
+        auto fullest = std::max_element(
+            pool.blocks.begin(), pool.blocks.end(), [](const std::unique_ptr<SveMemoryBlock> &a, const std::unique_ptr<SveMemoryBlock> &b) {
+                return a->getUsedBytes() < b->getUsedBytes();
+            });
+        for (auto it = pool.blocks.begin(); it != pool.blocks.end(); it++) {
+            auto &block = *it;
+            float occupancy = static_cast<float>(block->getUsedBytes()) / static_cast<float>(block->getSize());
+            if (it != fullest && !block->empty() && occupancy <= maxOccupancy) {
+                block->setDraining(true);
+                marked++;
+            }
+        }
+    }
+    defragmenting = marked > 0;
+    return marked;
+}
+
+void SveMemoryAllocator::endDefragmentation() {
+    std::lock_guard<std::mutex> lock{mutex};
+    for (auto &pool : pools) {
+        for (auto &block : pool.blocks) {
+            block->setDraining(false);
+        }
+    }
+    defragmenting = false;
+}
+
+bool SveMemoryAllocator::isDefragmenting() const {
+    std::lock_guard<std::mutex> lock{mutex};
+    return defragmenting;
+}
+
+bool SveMemoryAllocator::isInDrainingBlock(const SveAllocation &allocation) const {
+    std::lock_guard<std::mutex> lock{mutex};
+    return allocation.block != nullptr && allocation.block->isDraining();
+}
+
+std::vector<SveMemoryAllocator::HeapStats> SveMemoryAllocator::getHeapStats() const {
+    std::lock_guard<std::mutex> lock{mutex};
+    return heapStats;
+}
+
+std::array<SveMemoryAllocator::CategoryStats, SveMemoryAllocator::CATEGORY_COUNT> SveMemoryAllocator::getCategoryStats()
+    const {
+    std::lock_guard<std::mutex> lock{mutex};
+    return categoryStats;
+}
+
+const char *SveMemoryAllocator::categoryName(SveMemoryCategory category) {
+    switch (category) {
+        case SveMemoryCategory::Geometry:
+            return "geometry";
+        case SveMemoryCategory::Uniforms:
+            return "uniforms";
+        case SveMemoryCategory::Storage:
+            return "storage";
+        case SveMemoryCategory::Staging:
+            return "staging";
+        case SveMemoryCategory::Textures:
+            return "textures";
+        case SveMemoryCategory::RenderTargets:
+            return "render targets";
+        case SveMemoryCategory::Depth:
+            return "depth";
+        default:
+            return "other";
+    }
+}
+
+std::vector<SveMemoryAllocator::HeapBudget> SveMemoryAllocator::getHeapBudgets() const {
+    std::vector<HeapBudget> budgets(memoryProperties.memoryHeapCount);
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+        budgets[i].deviceLocal = memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+    }
+
+    if (memoryBudgetSupported) {
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+        budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+        VkPhysicalDeviceMemoryProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+        properties2.pNext = &budgetProperties;
+        vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &properties2);
+        for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+            budgets[i].budget = budgetProperties.heapBudget[i];
+            budgets[i].usage = budgetProperties.heapUsage[i];
+        }
+        return budgets;
+    }
+
+    // without the extension only our own blocks are known, and other processes share the heap
+    std::lock_guard<std::mutex> lock{mutex};
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+        budgets[i].budget = memoryProperties.memoryHeaps[i].size / 10 * 8;
+        budgets[i].usage = heapStats[i].blockBytes;
+        budgets[i].estimated = true;
+    }
+    return budgets;
+}
+
+}  // namespace sve
@@ -0,0 +1,200 @@
+#pragma once
+
+// lib
+#include <vulkan/vulkan.h>
+
+// std
+#include <array>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace sve {
+
+class SveMemoryBlock;
+
+// what an allocation holds, for the per category accounting. SveDevice derives it from the
+// buffer or image usage
+enum class SveMemoryCategory : uint32_t {
+    Geometry,       // vertex and index buffers
+    Uniforms,       // uniform buffers
+    Storage,        // storage and indirect buffers
+    Staging,        // host visible transfer sources
+    Textures,       // sampled images
+    RenderTargets,  // color and input attachments
+    Depth,          // depth attachments, shadow maps included
+    Other,
+};
+
+// A sub-range of a VkDeviceMemory handed out by SveMemoryAllocator
+struct SveAllocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;  // into memory, already applied to mapped
+    VkDeviceSize size = 0;
+    void *mapped = nullptr;  // persistent mapping, null unless the memory type is host visible
+    uint32_t memoryTypeIndex = 0;
+    SveMemoryCategory category = SveMemoryCategory::Other;
+
+    // bookkeeping for SveMemoryAllocator::free
+    SveMemoryBlock *block = nullptr;  // null for dedicated allocations
+    uint32_t order = 0;
+};
+
+// Buddy allocator over one large VkDeviceMemory. Sub-blocks are powers of two from
+// MIN_ALLOCATION_SIZE up to the block size and naturally aligned to their own size
+class SveMemoryBlock {
+   public:
+    static constexpr VkDeviceSize MIN_ALLOCATION_SIZE = 256;
+
+    SveMemoryBlock(VkDevice device, uint32_t memoryTypeIndex, VkDeviceSize size, bool hostVisible);
+    ~SveMemoryBlock();
+
+    SveMemoryBlock(const SveMemoryBlock &) = delete;
+    SveMemoryBlock &operator=(const SveMemoryBlock &) = delete;
+
+    bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset, uint32_t &order);
+    void free(VkDeviceSize offset, uint32_t order);
+
+    static VkDeviceSize orderSize(uint32_t order) { return MIN_ALLOCATION_SIZE << order; }
+
+    VkDeviceMemory getMemory() const { return memory; }
+    void *getMapped() const { return mapped; }
+    VkDeviceSize getSize() const { return size; }
+    VkDeviceSize getUsedBytes() const { return usedBytes; }
+    uint32_t getAllocationCount() const { return allocationCount; }
+    bool empty() const { return allocationCount == 0; }
+
+    // draining blocks are skipped by new allocations so their resources can be moved out
+    bool isDraining() const { return draining; }
+    void setDraining(bool value) { draining = value; }
+
+   private:
+    VkDevice device;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    void *mapped = nullptr;
+    VkDeviceSize size;
+    uint32_t maxOrder;
+
+    std::vector<std::unordered_set<VkDeviceSize>> freeLists;  // free offsets per order
+    VkDeviceSize usedBytes = 0;
+    uint32_t allocationCount = 0;
+    bool draining = false;
+};
+
+// Sub-allocates buffers and images out of large per-memory-type blocks instead of one
+// vkAllocateMemory per resource. Large resources, or ones the driver prefers dedicated, get their
+// own allocation. Host visible memory is mapped once when the block is created
+class SveMemoryAllocator {
+   public:
+    static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull << 20;  // 64 MiB
+    static constexpr uint32_t CATEGORY_COUNT = static_cast<uint32_t>(SveMemoryCategory::Other) + 1;
+
+    struct HeapStats {
+        VkDeviceSize heapSize = 0;
+        VkDeviceSize blockBytes = 0;      // reserved from the driver, including dedicated allocations
+        VkDeviceSize allocatedBytes = 0;  // handed out to resources
+        uint32_t blockCount = 0;
+        uint32_t allocationCount = 0;
+        uint32_t dedicatedCount = 0;
+    };
+    struct CategoryStats {
+        VkDeviceSize allocatedBytes = 0;    // including the buddy allocator's rounding up
+        VkDeviceSize deviceLocalBytes = 0;  // the part of it in device local heaps
+        uint32_t allocationCount = 0;
+    };
+    // how much of a heap the process may use before the OS starts evicting or failing allocations.
+    // Live from the driver with VK_EXT_memory_budget, otherwise estimated from this allocator
+    struct HeapBudget {
+        VkDeviceSize budget = 0;
+        VkDeviceSize usage = 0;  // by the whole process, other allocators and the driver included
+        bool deviceLocal = false;
+        bool estimated = false;  // no VK_EXT_memory_budget: 80% of the heap size, usage is our blocks
+    };
+
+    SveMemoryAllocator(
+        VkPhysicalDevice physicalDevice,
+        VkDevice device,
+        const VkPhysicalDeviceProperties &properties,
+        bool memoryBudgetSupported);
+    ~SveMemoryAllocator();
+
+    SveMemoryAllocator(const SveMemoryAllocator &) = delete;
+    SveMemoryAllocator &operator=(const SveMemoryAllocator &) = delete;
+
+    // allocate and bind memory for the resource
+    SveAllocation allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, SveMemoryCategory category);
+    SveAllocation allocateForImage(
+        VkImage image, VkImageTiling tiling, VkMemoryPropertyFlags properties, SveMemoryCategory category);
+    // memory the caller binds itself, e.g. several optimally tiled images aliasing one range
+    SveAllocation allocateMemory(
+        const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties, SveMemoryCategory category);
+    void free(SveAllocation &allocation);
+
+    // offset and size are relative to the allocation, no-ops on host coherent memory
+    VkResult flush(const SveAllocation &allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+    VkResult invalidate(const SveAllocation &allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
+    // Defragmentation: blocks at most maxOccupancy full are marked draining, new allocations go
+    // elsewhere and the blocks are released once their last resource has been relocated (see
+    // SveDefragmenter). The fullest block of each pool is never marked. Returns the number marked
+    uint32_t beginDefragmentation(float maxOccupancy);
+    void endDefragmentation();
+    bool isDefragmenting() const;
+    bool isInDrainingBlock(const SveAllocation &allocation) const;
+
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+    const VkPhysicalDeviceMemoryProperties &getMemoryProperties() const { return memoryProperties; }
+    std::vector<HeapStats> getHeapStats() const;
+    std::array<CategoryStats, CATEGORY_COUNT> getCategoryStats() const;
+    static const char *categoryName(SveMemoryCategory category);
+    // queries the driver, so once a frame at most
+    std::vector<HeapBudget> getHeapBudgets() const;
+    bool isMemoryBudgetSupported() const { return memoryBudgetSupported; }
+
+   private:
+    // linear and optimally tiled resources only share blocks when bufferImageGranularity can't bite
+    struct Pool {
+        std::vector<std::unique_ptr<SveMemoryBlock>> blocks;
+    };
+
+    SveAllocation allocate(
+        const VkMemoryRequirements &requirements,
+        VkMemoryPropertyFlags properties,
+        SveMemoryCategory category,
+        bool linear,
+        bool dedicated,
+        VkBuffer dedicatedBuffer,
+        VkImage dedicatedImage);
+    SveAllocation allocateDedicated(
+        const VkMemoryRequirements &requirements,
+        uint32_t memoryTypeIndex,
+        VkBuffer dedicatedBuffer,
+        VkImage dedicatedImage);
+    Pool &getPool(uint32_t memoryTypeIndex, bool linear);
+    VkMappedMemoryRange mappedRange(const SveAllocation &allocation, VkDeviceSize offset, VkDeviceSize size) const;
+    bool isHostVisible(uint32_t memoryTypeIndex) const;
+    bool isHostCoherent(uint32_t memoryTypeIndex) const;
+    uint32_t heapIndex(uint32_t memoryTypeIndex) const { return memoryProperties.memoryTypes[memoryTypeIndex].heapIndex; }
+    // the bytes an allocation takes out of its memory, counted in the heap and category stats
+    static VkDeviceSize reservedSize(const SveAllocation &allocation);
+    void trackCategory(const SveAllocation &allocation, bool allocated);
+
+    VkPhysicalDevice physicalDevice;
+    VkDevice device;
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    bool memoryBudgetSupported;
+    VkDeviceSize nonCoherentAtomSize;
+    VkDeviceSize bufferImageGranularity;
+    uint32_t maxAllocationCount;
+    std::vector<VkDeviceSize> blockSizes;  // per heap
+
+    std::vector<Pool> pools;  // memoryTypeCount * 2, linear then optimal
+    std::vector<HeapStats> heapStats;
+    std::array<CategoryStats, CATEGORY_COUNT> categoryStats{};
+    uint32_t deviceAllocationCount = 0;  // live vkAllocateMemory calls
+    bool defragmenting = false;
+    mutable std::mutex mutex;
+};
+
+}  // namespace sve
@@ -0,0 +1,73 @@
+#include "sve_memory_budget.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+namespace sve {
+
+SveMemoryBudget::SveMemoryBudget(SveDevice &device, float warningFraction, float criticalFraction)
+    : sveDevice{device} {
+    setThresholds(warningFraction, criticalFraction);
+    levels.resize(sveDevice.allocator().getMemoryProperties().memoryHeapCount, Level::Normal);
+}
+
+void SveMemoryBudget::setThresholds(float warningFraction, float criticalFraction) {
+    assert(warningFraction > 0.f && warningFraction <= criticalFraction && "Memory thresholds out of order");
+    this->warningFraction = warningFraction;
+    this->criticalFraction = criticalFraction;
+}
+
+SveMemoryBudget::Level SveMemoryBudget::levelFor(float usage, Level current) const {
+    // rising takes the threshold itself, falling back takes usage HYSTERESIS below it
+    float critical = criticalFraction - (current == Level::Critical ? HYSTERESIS : 0.f);
+    float warning = warningFraction - (current != Level::Normal ? HYSTERESIS : 0.f);
+    if (usage >= critical) {
+        return Level::Critical;
+    }
+    return usage >= warning ? Level::Warning : Level::Normal;
+}
+
+void SveMemoryBudget::update() {
+    budgets = sveDevice.allocator().getHeapBudgets();
+    for (uint32_t i = 0; i < budgets.size(); i++) {
+        const auto &budget = budgets[i];
+        if (budget.budget == 0) {
+            continue;
+        }
+        float usage = static_cast<float>(budget.usage) / static_cast<float>(budget.budget);
+        Level level = levelFor(usage, levels[i]);
+        if (level == levels[i]) {
+            continue;
+        }
+
+        HeapEvent event{i, level, levels[i], budget};
+        levels[i] = level;
+        if (logWarnings && level > event.previousLevel) {
+            std::cerr << "memory heap " << i << (budget.deviceLocal ? " (device local)" : "") << " "
+                      << levelName(level) << ": " << (budget.usage >> 20) << " of " << (budget.budget >> 20)
+                      << " MiB" << (budget.estimated ? " (estimated)" : "") << std::endl;
+        }
+        for (const auto &callback : callbacks) {
+            callback(event);
+        }
+    }
+}
+
+SveMemoryBudget::Level SveMemoryBudget::getHighestLevel() const {
+    return levels.empty() ? Level::Normal : *std::max_element(levels.begin(), levels.end());
+}
+
+const char *SveMemoryBudget::levelName(Level level) {
+    switch (level) {
+        case Level::Warning:
+            return "warning";
+        case Level::Critical:
+            return "critical";
+        default:
+            return "normal";
+    }
+}
+
+}  // namespace sve
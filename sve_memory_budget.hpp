@@ -0,0 +1,62 @@
+#pragma once
+
+#include "sve_device.hpp"
+
+// std
+#include <functional>
+#include <vector>
+
+namespace sve {
+
+// Watches the per heap budgets and reports when a heap's usage crosses a fraction of its budget,
+// so streaming systems can stop loading or evict before the OS starts paging device memory out.
+// Levels only drop once usage is HYSTERESIS below the threshold, so a heap hovering around one
+// doesn't fire a callback every frame
+class SveMemoryBudget {
+   public:
+    static constexpr float HYSTERESIS = .05f;  // of the budget
+
+    enum class Level {
+        Normal,
+        Warning,   // past the warning fraction, time to stop streaming in
+        Critical,  // past the critical fraction, time to evict
+    };
+    struct HeapEvent {
+        uint32_t heapIndex;
+        Level level;
+        Level previousLevel;
+        SveMemoryAllocator::HeapBudget budget;
+    };
+    using Callback = std::function<void(const HeapEvent &)>;
+
+    explicit SveMemoryBudget(SveDevice &device, float warningFraction = .8f, float criticalFraction = .95f);
+
+    void setThresholds(float warningFraction, float criticalFraction);
+    float getWarningFraction() const { return warningFraction; }
+    float getCriticalFraction() const { return criticalFraction; }
+
+    // called from update on every level change, in the order added
+    void addCallback(Callback callback) { callbacks.push_back(std::move(callback)); }
+    // a line on stderr whenever a heap rises to Warning or Critical, on by default
+    void setLogWarnings(bool enable) { logWarnings = enable; }
+
+    // once per frame, queries the budgets and fires the callbacks
+    void update();
+    const std::vector<SveMemoryAllocator::HeapBudget> &getHeapBudgets() const { return budgets; }
+    Level getLevel(uint32_t heapIndex) const { return levels[heapIndex]; }
+    Level getHighestLevel() const;
+    static const char *levelName(Level level);
+
+   private:
+    Level levelFor(float usage, Level current) const;
+
+    SveDevice &sveDevice;
+    float warningFraction;
+    float criticalFraction;
+    bool logWarnings = true;
+    std::vector<Callback> callbacks;
+    std::vector<SveMemoryAllocator::HeapBudget> budgets;
+    std::vector<Level> levels;  // per heap
+};
+
+}  // namespace sve
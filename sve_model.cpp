@@ -1,5 +1,7 @@
 #include "sve_model.hpp"
 
+#include "sve_command_counters.hpp"
+#include "sve_cpu_profiler.hpp"
 #include "sve_utils.hpp"
 
 // libs
@@ -10,8 +12,11 @@
 
 // std
 #include <cassert>
+#include <chrono>
 #include <cstring>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 #include <unordered_map>
 
 namespace std {
@@ -32,12 +37,15 @@ namespace sve {
 
 SveModel::SveModel(SveDevice& device, const SveModel::Builder& builder) : sveDevice{device} {
     createVertexBuffers(builder.vertices);
+    createPositionBuffers(builder.vertices);
     createIndexBuffers(builder.indices);
+    computeBounds(builder.vertices);
 }
 
 SveModel::~SveModel() {}
 
 std::unique_ptr<SveModel> SveModel::createModelFromFile(SveDevice& device, const std::string& path) {
+    SVE_PROFILE_FUNCTION();
     Builder builder{};
     builder.loadModel(path);
     std::cout << "Vertex count: " << builder.vertices.size() << std::endl;
@@ -45,78 +53,158 @@ std::unique_ptr<SveModel> SveModel::createModelFromFile(SveDevice& device, const
 }
 
 void SveModel::createVertexBuffers(const std::vector<Vertex>& vertices) {
+    SVE_PROFILE_FUNCTION();
     vertexCount = static_cast<uint32_t>(vertices.size());
     assert(vertexCount >= 3 && "Vertex count must be at least 3.");
-    VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
-    uint32_t vertexStride = sizeof(vertices[0]);
+    vertexBuffer =
+        uploadBuffer(vertices.data(), sizeof(vertices[0]), vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+}
 
+std::unique_ptr<SveBuffer> SveModel::uploadBuffer(
+    const void* data, uint32_t stride, uint32_t count, VkBufferUsageFlags usage) {
+    auto start = std::chrono::steady_clock::now();
     SveBuffer stagingBuffer{
         sveDevice,
-        vertexStride,
-        vertexCount,
+        stride,
+        count,
         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
     };
 
     stagingBuffer.map();
-    stagingBuffer.writeToBuffer((void*)vertices.data());
+    stagingBuffer.writeToBuffer(const_cast<void*>(data));
+    auto staged = std::chrono::steady_clock::now();
 
-    vertexBuffer = std::make_unique<SveBuffer>(
+    // transfer source too, so SveDefragmenter can move it later
+    auto buffer = std::make_unique<SveBuffer>(
         sveDevice,
-        vertexStride,
-        vertexCount,
-        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        stride,
+        count,
+        usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-    sveDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+    sveDevice.copyBuffer(stagingBuffer.getBuffer(), buffer->getBuffer(), static_cast<VkDeviceSize>(stride) * count);
+    auto copied = std::chrono::steady_clock::now();
+    uploadTimings.stagingMs += std::chrono::duration<float, std::milli>(staged - start).count();
+    uploadTimings.copyMs += std::chrono::duration<float, std::milli>(copied - staged).count();
+    return buffer;
+}
+
+// sphere around the AABB center, not minimal but stable and cheap
+void SveModel::computeBounds(const std::vector<Vertex>& vertices) {
+    glm::vec3 minPos{vertices[0].position};
+    glm::vec3 maxPos{vertices[0].position};
+    for (const auto& vertex : vertices) {
+        minPos = glm::min(minPos, vertex.position);
+        maxPos = glm::max(maxPos, vertex.position);
+    }
+    boundingCenter = (minPos + maxPos) * .5f;
+
+    float radiusSquared = 0.f;
+    for (const auto& vertex : vertices) {
+        glm::vec3 offset = vertex.position - boundingCenter;
+        radiusSquared = glm::max(radiusSquared, glm::dot(offset, offset));
+    }
+    boundingRadius = glm::sqrt(radiusSquared);
+}
+
+void SveModel::createPositionBuffers(const std::vector<Vertex>& vertices) {
+    std::vector<glm::vec3> positions(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        positions[i] = vertices[i].position;
+    }
+    positionBuffer =
+        uploadBuffer(positions.data(), sizeof(positions[0]), vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
 }
 
 void SveModel::createIndexBuffers(const std::vector<uint32_t>& indices) {
+    SVE_PROFILE_FUNCTION();
     if (indices.empty()) {
         return;
     }
     hasIndexbuffer = true;
     indexCount = static_cast<uint32_t>(indices.size());
-    VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
-    uint32_t indexStride = sizeof(indices[0]);
-
-    SveBuffer stagingBuffer{
-        sveDevice,
-        indexStride,
-        indexCount,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-    };
-
-    stagingBuffer.map();
-    stagingBuffer.writeToBuffer((void*)indices.data());
-
-    indexBuffer = std::make_unique<SveBuffer>(
-        sveDevice,
-        indexStride,
-        indexCount,
-        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-    sveDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
+    indexBuffer = uploadBuffer(indices.data(), sizeof(indices[0]), indexCount, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 }
 
 void SveModel::draw(VkCommandBuffer commandBuffer) {
     if (hasIndexbuffer) {
-        vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+        SveCommandCounters::drawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
     } else {
-        vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+        SveCommandCounters::draw(commandBuffer, vertexCount, 1, 0, 0);
     }
 }
 
 void SveModel::bind(VkCommandBuffer commandBuffer) {
     VkBuffer buffers[] = {vertexBuffer->getBuffer()};
     VkDeviceSize offsets[] = {0};
-    vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+    SveCommandCounters::bindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+
+    if (hasIndexbuffer) {
+        SveCommandCounters::bindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);  // 32 bit indices => | 2^16 -1 = 65535 | 2^32 -1 = 4294967295 | 2^64 -1 = 18446744073709551615 | etc...
+    }
+}
+
+void SveModel::bindPositions(VkCommandBuffer commandBuffer) {
+    VkBuffer buffers[] = {positionBuffer->getBuffer()};
+    VkDeviceSize offsets[] = {0};
+    SveCommandCounters::bindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
 
     if (hasIndexbuffer) {
-        vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);  // 32 bit indices => | 2^16 -1 = 65535 | 2^32 -1 = 4294967295 | 2^64 -1 = 18446744073709551615 | etc...
+        SveCommandCounters::bindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+    }
+}
+
+static bool inDrainingBlock(SveDevice& device, const std::unique_ptr<SveBuffer>& buffer) {
+    return buffer && device.allocator().isInDrainingBlock(buffer->getAllocation());
+}
+
+static VkDeviceSize relocateBuffer(
+    SveDevice& device, VkCommandBuffer commandBuffer, std::unique_ptr<SveBuffer>& buffer, uint32_t& buffersMoved) {
+    if (!inDrainingBlock(device, buffer)) {
+        return 0;
+    }
+    // the allocator skips draining blocks, so the new buffer lands somewhere denser
+    auto newBuffer = std::make_unique<SveBuffer>(
+        device,
+        buffer->getInstanceSize(),
+        buffer->getInstanceCount(),
+        buffer->getUsageFlags(),
+        buffer->getMemoryPropertyFlags());
+
+    VkBufferCopy copyRegion{};
+    copyRegion.size = buffer->getBufferSize();
+    SveCommandCounters::copyBuffer(commandBuffer, buffer->getBuffer(), newBuffer->getBuffer(), 1, &copyRegion);
+
+    // the old buffer defers its own destruction until the frames recorded so far have completed
+    buffer = std::move(newBuffer);
+    buffersMoved++;
+    return copyRegion.size;
+}
+
+bool SveModel::needsRelocation() const {
+    return inDrainingBlock(sveDevice, vertexBuffer) || inDrainingBlock(sveDevice, positionBuffer) ||
+           inDrainingBlock(sveDevice, indexBuffer);
+}
+
+VkDeviceSize SveModel::getRelocationSize() const {
+    VkDeviceSize size = 0;
+    if (inDrainingBlock(sveDevice, vertexBuffer)) {
+        size += vertexBuffer->getBufferSize();
+    }
+    if (inDrainingBlock(sveDevice, positionBuffer)) {
+        size += positionBuffer->getBufferSize();
+    }
+    if (inDrainingBlock(sveDevice, indexBuffer)) {
+        size += indexBuffer->getBufferSize();
     }
+    return size;
+}
+
+VkDeviceSize SveModel::relocate(VkCommandBuffer commandBuffer, uint32_t& buffersMoved) {
+    return relocateBuffer(sveDevice, commandBuffer, vertexBuffer, buffersMoved) +
+           relocateBuffer(sveDevice, commandBuffer, positionBuffer, buffersMoved) +
+           relocateBuffer(sveDevice, commandBuffer, indexBuffer, buffersMoved);
 }
 
 std::vector<VkVertexInputBindingDescription> SveModel::Vertex::getBindingDescriptions() {
@@ -133,16 +221,37 @@ std::vector<VkVertexInputAttributeDescription> SveModel::Vertex::getAttributeDes
     };
 }
 
+std::vector<VkVertexInputBindingDescription> SveModel::Vertex::getPositionBindingDescriptions() {
+    return {{0, sizeof(glm::vec3), VK_VERTEX_INPUT_RATE_VERTEX}};
+}
+
+std::vector<VkVertexInputAttributeDescription> SveModel::Vertex::getPositionAttributeDescriptions() {
+    return {{0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0}};
+}
+
 // TONY OBJ LOADER
 void SveModel::Builder::loadModel(const std::string& path) {
+    SVE_PROFILE_FUNCTION();
     tinyobj::attrib_t attrib;              // vertex data (position, color, normal, texture)
     std::vector<tinyobj::shape_t> shapes;  // index values for each face element
     std::vector<tinyobj::material_t> materials;
     std::string warn, err;
 
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str())) {
+    // read and parse separately, so the two can be timed apart
+    auto start = std::chrono::steady_clock::now();
+    std::ifstream file{path, std::ios::binary};
+    if (!file) {
+        throw std::runtime_error("failed to open model file " + path + "!");
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    auto read = std::chrono::steady_clock::now();
+
+    tinyobj::MaterialFileReader materialReader{""};  // what LoadObj with a path uses
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, &contents, &materialReader)) {
         throw std::runtime_error(warn + err);
     }
+    auto parsed = std::chrono::steady_clock::now();
 
     vertices.clear();
     indices.clear();
@@ -193,6 +302,11 @@ void SveModel::Builder::loadModel(const std::string& path) {
             indices.push_back(uniqueVertices[vertex]);
         }
     }
+
+    auto welded = std::chrono::steady_clock::now();
+    timings.readMs = std::chrono::duration<float, std::milli>(read - start).count();
+    timings.parseMs = std::chrono::duration<float, std::milli>(parsed - read).count();
+    timings.weldMs = std::chrono::duration<float, std::milli>(welded - parsed).count();
 }
 
 }  // namespace sve
\ No newline at end of file
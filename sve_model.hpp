@@ -25,6 +25,9 @@ class SveModel {
 
         static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
         static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+        // de-interleaved position-only stream used by depth-only passes
+        static std::vector<VkVertexInputBindingDescription> getPositionBindingDescriptions();
+        static std::vector<VkVertexInputAttributeDescription> getPositionAttributeDescriptions();
 
         bool operator==(const Vertex &other) const {
             return position == other.position && color == other.color && normal == other.normal && uv == other.uv;
@@ -32,11 +35,24 @@ class SveModel {
     };
 
     struct Builder {
+        // of the last loadModel
+        struct LoadTimings {
+            float readMs = 0.f;   // file into memory
+            float parseMs = 0.f;  // OBJ text to attributes and faces
+            float weldMs = 0.f;   // deduplicating into vertices and indices
+        };
+
         std::vector<Vertex> vertices;
         std::vector<uint32_t> indices;
+        LoadTimings timings{};
 
         void loadModel(const std::string &path);
     };
+    // summed over the model's vertex, position and index buffers
+    struct UploadTimings {
+        float stagingMs = 0.f;  // staging buffer creation and the CPU write
+        float copyMs = 0.f;     // device local buffer creation and the blocking GPU copy
+    };
 
     SveModel(SveDevice &device, const SveModel::Builder &builder);
     ~SveModel();
@@ -46,17 +62,42 @@ class SveModel {
     static std::unique_ptr<SveModel> createModelFromFile(SveDevice &device, const std::string &path);
 
     void bind(VkCommandBuffer commandBuffer);
+    void bindPositions(VkCommandBuffer commandBuffer);
     void draw(VkCommandBuffer commandBuffer);
 
+    // model space bounds, for culling
+    glm::vec3 getBoundingCenter() const { return boundingCenter; }
+    float getBoundingRadius() const { return boundingRadius; }
+    const UploadTimings &getUploadTimings() const { return uploadTimings; }
+
+    // defragmentation support, see SveDefragmenter
+    bool needsRelocation() const;
+    VkDeviceSize getRelocationSize() const;
+    // records copies into fresh buffers and swaps them in, the old buffers are destroyed once the
+    // frames recorded so far have completed. Returns the bytes copied, adds to buffersMoved
+    VkDeviceSize relocate(VkCommandBuffer commandBuffer, uint32_t &buffersMoved);
+
    private:
     void createVertexBuffers(const std::vector<Vertex> &vertices);
     void createIndexBuffers(const std::vector<uint32_t> &indices);
+    void createPositionBuffers(const std::vector<Vertex> &vertices);
+    void computeBounds(const std::vector<Vertex> &vertices);
+    // through a staging buffer into a new device local buffer
+    std::unique_ptr<SveBuffer> uploadBuffer(
+        const void *data, uint32_t stride, uint32_t count, VkBufferUsageFlags usage);
 
     SveDevice &sveDevice;
 
+    glm::vec3 boundingCenter{0.f};
+    float boundingRadius = 0.f;
+    UploadTimings uploadTimings{};
+
     std::unique_ptr<SveBuffer> vertexBuffer;
     uint32_t vertexCount;
 
+    // positions only, 12 bytes per vertex instead of 44, so depth-only passes fetch a quarter of the data
+    std::unique_ptr<SveBuffer> positionBuffer;
+
     bool hasIndexbuffer = false;
     std::unique_ptr<SveBuffer> indexBuffer;
     uint32_t indexCount;
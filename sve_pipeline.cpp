@@ -1,5 +1,6 @@
 #include "sve_pipeline.hpp"
 
+#include "sve_command_counters.hpp"
 #include "sve_model.hpp"
 
 // std
@@ -15,9 +16,16 @@ SvePipeline::SvePipeline(SveDevice& device, const std::string& vertFilepath, con
 }
 
 SvePipeline::~SvePipeline() {
-    vkDestroyShaderModule(sveDevice.device(), vertShaderModule, nullptr);
-    vkDestroyShaderModule(sveDevice.device(), fragShaderModule, nullptr);
-    vkDestroyPipeline(sveDevice.device(), graphicsPipeline, nullptr);
+    // a frame in flight may still be drawing with it
+    VkDevice device = sveDevice.device();
+    sveDevice.deferDestruction(
+        [device, vertShaderModule = vertShaderModule, fragShaderModule = fragShaderModule, graphicsPipeline = graphicsPipeline]() {
+            vkDestroyShaderModule(device, vertShaderModule, nullptr);
+            if (fragShaderModule != VK_NULL_HANDLE) {
+                vkDestroyShaderModule(device, fragShaderModule, nullptr);
+            }
+            vkDestroyPipeline(device, graphicsPipeline, nullptr);
+        });
 }
 
 std::vector<char> SvePipeline::readFile(const std::string& filepath) {
@@ -38,8 +46,9 @@ std::vector<char> SvePipeline::readFile(const std::string& filepath) {
 }
 
 void SvePipeline::createGraphicsPipeline(const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo) {
+    bool hasFragmentStage = !fragFilepath.empty();
     auto vertShaderCode = readFile(vertFilepath);
-    auto fragShaderCode = readFile(fragFilepath);
+    auto fragShaderCode = hasFragmentStage ? readFile(fragFilepath) : std::vector<char>{};
 
     std::cout << "Vertex Shader Code Size: " << vertShaderCode.size() << std::endl;
     std::cout << "Fragment Shader Code Size: " << fragShaderCode.size() << std::endl;
@@ -47,7 +56,9 @@ void SvePipeline::createGraphicsPipeline(const std::string& vertFilepath, const
     assert(configInfo.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline: no render pass provided in configInfo");
 
     createShaderModule(vertShaderCode, &vertShaderModule);
-    createShaderModule(fragShaderCode, &fragShaderModule);
+    if (hasFragmentStage) {
+        createShaderModule(fragShaderCode, &fragShaderModule);
+    }
 
     VkPipelineShaderStageCreateInfo shaderStages[2];
     shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -65,18 +76,18 @@ void SvePipeline::createGraphicsPipeline(const std::string& vertFilepath, const
     shaderStages[1].pNext = nullptr;
     shaderStages[1].pSpecializationInfo = nullptr;
 
-    auto bindingDescription = SveModel::Vertex::getBindingDescriptions();
-    auto attributeDescriptions = SveModel::Vertex::getAttributeDescriptions();
+    auto& bindingDescriptions = configInfo.bindingDescriptions;
+    auto& attributeDescriptions = configInfo.attributeDescriptions;
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
     vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescription.size());
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
     vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
-    vertexInputInfo.pVertexBindingDescriptions = bindingDescription.data();
+    vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
 
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = 2;
+    pipelineInfo.stageCount = hasFragmentStage ? 2 : 1;
     pipelineInfo.pStages = shaderStages;
     pipelineInfo.pVertexInputState = &vertexInputInfo;
     pipelineInfo.pInputAssemblyState = &configInfo.inputAssemblyInfo;
@@ -88,7 +99,7 @@ void SvePipeline::createGraphicsPipeline(const std::string& vertFilepath, const
     pipelineInfo.pDynamicState = &configInfo.dynamicStateInfo;
     pipelineInfo.layout = configInfo.pipelineLayout;
     pipelineInfo.renderPass = configInfo.renderPass;
-    pipelineInfo.subpass = 0;
+    pipelineInfo.subpass = configInfo.subpass;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
@@ -109,7 +120,7 @@ void SvePipeline::createShaderModule(const std::vector<char>& code, VkShaderModu
 }
 
 void SvePipeline::bind(VkCommandBuffer commandBuffer) {
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);  // error checked at initialization
+    SveCommandCounters::bindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);  // error checked at initialization
 }
 
 // For pipeline initialization
@@ -179,6 +190,9 @@ void SvePipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo) {
     configInfo.dynamicStateInfo.pDynamicStates = configInfo.dynamicStateEnables.data();
     configInfo.dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(configInfo.dynamicStateEnables.size());
     configInfo.dynamicStateInfo.flags = 0;
+
+    configInfo.bindingDescriptions = SveModel::Vertex::getBindingDescriptions();
+    configInfo.attributeDescriptions = SveModel::Vertex::getAttributeDescriptions();
 }
 
 }  // namespace sve
\ No newline at end of file
@@ -12,6 +12,8 @@ struct PipelineConfigInfo {
     PipelineConfigInfo(const PipelineConfigInfo&) = delete;
     PipelineConfigInfo& operator=(const PipelineConfigInfo&) = delete;
 
+    std::vector<VkVertexInputBindingDescription> bindingDescriptions{};
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
     VkPipelineViewportStateCreateInfo viewportInfo;
     VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo;
     VkPipelineRasterizationStateCreateInfo rasterizerInfo;
@@ -28,6 +30,7 @@ struct PipelineConfigInfo {
 
 class SvePipeline {
    public:
+    // an empty fragFilepath builds a pipeline without a fragment stage, e.g. for depth-only passes
     SvePipeline(SveDevice& device, const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo);
     ~SvePipeline();
 
@@ -48,7 +51,7 @@ class SvePipeline {
     SveDevice& sveDevice;
     VkPipeline graphicsPipeline;
     VkShaderModule vertShaderModule;
-    VkShaderModule fragShaderModule;
+    VkShaderModule fragShaderModule = VK_NULL_HANDLE;
 };
 
 }  // namespace sve
\ No newline at end of file
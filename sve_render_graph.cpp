@@ -0,0 +1,826 @@
+#include "sve_render_graph.hpp"
+
+#include "sve_command_counters.hpp"
+#include "sve_gpu_profiler.hpp"
+#include "sve_utils.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace sve {
+
+static constexpr SveRenderGraph::ResourceId NO_RESOURCE = ~0u;
+
+static bool hasStencil(VkFormat format) {
+    return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT ||
+           format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_S8_UINT;
+}
+
+static bool isDepthFormat(VkFormat format) {
+    return format == VK_FORMAT_D32_SFLOAT || format == VK_FORMAT_D16_UNORM ||
+           format == VK_FORMAT_X8_D24_UNORM_PACK32 || hasStencil(format);
+}
+
+static VkImageAspectFlags aspectOf(VkFormat format) {
+    if (!isDepthFormat(format)) {
+        return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+    return VK_IMAGE_ASPECT_DEPTH_BIT | (hasStencil(format) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+}
+
+SveRenderGraph::PassBuilder &SveRenderGraph::PassBuilder::read(ResourceId resource, Access access) {
+    assert(resource < graph.resources.size() && "Unknown render graph resource");
+    graph.passes[passIndex].uses.push_back({resource, access, false});
+    return *this;
+}
+
+SveRenderGraph::PassBuilder &SveRenderGraph::PassBuilder::write(ResourceId resource, Access access) {
+    assert(resource < graph.resources.size() && "Unknown render graph resource");
+    assert(access != Access::FragmentSampled && access != Access::TransferSrc && access != Access::DepthReadOnly && "Read-only access used as a write");
+    graph.passes[passIndex].uses.push_back({resource, access, true});
+    return *this;
+}
+
+SveRenderGraph::PassBuilder &SveRenderGraph::PassBuilder::clearColor(ResourceId resource, VkClearColorValue color) {
+    VkClearValue value{};
+    value.color = color;
+    graph.passes[passIndex].clears.emplace_back(resource, value);
+    return *this;
+}
+
+SveRenderGraph::PassBuilder &SveRenderGraph::PassBuilder::clearDepth(ResourceId resource, float depth) {
+    VkClearValue value{};
+    value.depthStencil = {depth, 0};
+    graph.passes[passIndex].clears.emplace_back(resource, value);
+    return *this;
+}
+
+SveRenderGraph::PassBuilder &SveRenderGraph::PassBuilder::setSideEffects() {
+    graph.passes[passIndex].sideEffects = true;
+    return *this;
+}
+
+SveRenderGraph::PassBuilder &SveRenderGraph::PassBuilder::setRenderArea(VkExtent2D extent) {
+    graph.passes[passIndex].renderArea = extent;
+    return *this;
+}
+
+SveRenderGraph::SveRenderGraph(SveDevice &device) : sveDevice{device} {}
+
+SveRenderGraph::~SveRenderGraph() { releaseCompiled(); }
+
+void SveRenderGraph::reset() {
+    for (auto &pass : passes) {
+        recycledPasses.push_back(std::move(pass));
+    }
+    passes.clear();
+    resources.clear();
+}
+
+SveRenderGraph::ResourceId SveRenderGraph::createImage(const std::string &name, const ImageDesc &desc) {
+    Resource resource{};
+    resource.name = name;
+    resource.desc = desc;
+    resources.push_back(resource);
+    return static_cast<ResourceId>(resources.size() - 1);
+}
+
+SveRenderGraph::ResourceId SveRenderGraph::importImage(
+    const std::string &name,
+    VkImage image,
+    VkImageView view,
+    const ImageDesc &desc,
+    VkImageLayout initialLayout,
+    VkPipelineStageFlags2KHR initialStage,
+    VkImageLayout finalLayout) {
+    Resource resource{};
+    resource.name = name;
+    resource.desc = desc;
+    resource.imported = true;
+    resource.image = image;
+    resource.view = view;
+    resource.initialLayout = initialLayout;
+    resource.initialStage = initialStage;
+    resource.finalLayout = finalLayout;
+    resources.push_back(resource);
+    return static_cast<ResourceId>(resources.size() - 1);
+}
+
+void SveRenderGraph::markOutput(ResourceId resource) { resources[resource].output = true; }
+
+SveRenderGraph::PassBuilder SveRenderGraph::addPass(const std::string &name, ExecuteFn execute) {
+    Pass pass{};
+    if (!recycledPasses.empty()) {
+        pass = std::move(recycledPasses.back());
+        recycledPasses.pop_back();
+        pass.uses.clear();
+        pass.clears.clear();
+        pass.sideEffects = false;
+        pass.renderArea = {0, 0};
+    }
+    pass.name = name;
+    pass.execute = std::move(execute);
+    passes.push_back(std::move(pass));
+    return PassBuilder{*this, static_cast<uint32_t>(passes.size() - 1)};
+}
+
+SveRenderGraph::AccessInfo SveRenderGraph::accessInfo(Access access) {
+    switch (access) {
+        case Access::ColorAttachment:
+            return {
+                VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR,
+                VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT_KHR | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR,
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                true};
+        case Access::DepthAttachment:
+            return {
+                VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT_KHR,
+                VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR,
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                true};
+        case Access::DepthReadOnly:
+            return {
+                VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT_KHR | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT_KHR,
+                VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT_KHR,
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                true};
+        case Access::FragmentSampled:
+            return {
+                VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT_KHR,
+                VK_ACCESS_2_SHADER_READ_BIT_KHR,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_IMAGE_USAGE_SAMPLED_BIT,
+                false};
+        case Access::TransferSrc:
+            return {
+                VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR,
+                VK_ACCESS_2_TRANSFER_READ_BIT_KHR,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                false};
+        case Access::TransferDst:
+            return {
+                VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR,
+                VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                false};
+    }
+    throw std::runtime_error("unknown render graph access!");
+}
+
+size_t SveRenderGraph::topologyHash() const {
+    size_t seed = 0;
+    hashCombine(seed, resources.size(), passes.size());
+    for (const auto &resource : resources) {
+        hashCombine(
+            seed,
+            resource.desc.format,
+            resource.desc.extent.width,
+            resource.desc.extent.height,
+            resource.imported,
+            resource.output,
+            resource.initialLayout,
+            resource.finalLayout);
+    }
+    for (const auto &pass : passes) {
+        hashCombine(seed, pass.name, pass.sideEffects, pass.uses.size());
+        for (const auto &use : pass.uses) {
+            hashCombine(seed, use.resource, use.access, use.write);
+        }
+        for (const auto &clear : pass.clears) {
+            hashCombine(seed, clear.first);
+        }
+    }
+    return seed;
+}
+
+bool SveRenderGraph::isCleared(const Pass &pass, ResourceId resource) const {
+    for (const auto &clear : pass.clears) {
+        if (clear.first == resource) return true;
+    }
+    return false;
+}
+
+void SveRenderGraph::execute(VkCommandBuffer commandBuffer) {
+    size_t hash = topologyHash();
+    if (!compiled || hash != compiledHash) {
+        compile();
+        compiledHash = hash;
+    }
+
+    stats.barriers = 0;
+    for (const auto &compiledPass : compiledPasses) {
+        recordBarriers(commandBuffer, compiledPass.barriers);
+
+        Pass &pass = passes[compiledPass.passIndex];
+        // timestamps only, passes may run statistics queries of their own
+        uint32_t profilerScope = profiler != nullptr ? profiler->beginScope(commandBuffer, pass.name) : 0;
+        if (compiledPass.renderPass == VK_NULL_HANDLE) {
+            pass.execute(commandBuffer);
+            if (profiler != nullptr) profiler->endScope(commandBuffer, profilerScope);
+            continue;
+        }
+
+        clearValues.assign(compiledPass.attachments.size(), VkClearValue{});
+        for (size_t i = 0; i < compiledPass.attachments.size(); i++) {
+            for (const auto &clear : pass.clears) {
+                if (clear.first == compiledPass.attachments[i]) clearValues[i] = clear.second;
+            }
+        }
+
+        VkExtent2D renderArea = compiledPass.extent;
+        if (pass.renderArea.width > 0 && pass.renderArea.height > 0) {
+            renderArea.width = std::min(pass.renderArea.width, compiledPass.extent.width);
+            renderArea.height = std::min(pass.renderArea.height, compiledPass.extent.height);
+        }
+
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = compiledPass.renderPass;
+        renderPassInfo.framebuffer = getFramebuffer(compiledPass);
+        renderPassInfo.renderArea.offset = {0, 0};
+        renderPassInfo.renderArea.extent = renderArea;
+        renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+        renderPassInfo.pClearValues = clearValues.data();
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+        VkViewport viewport{
+            0.f,
+            0.f,
+            static_cast<float>(renderArea.width),
+            static_cast<float>(renderArea.height),
+            0.f,
+            1.f};
+        VkRect2D scissor{{0, 0}, renderArea};
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+        pass.execute(commandBuffer);
+        vkCmdEndRenderPass(commandBuffer);
+        if (profiler != nullptr) profiler->endScope(commandBuffer, profilerScope);
+    }
+    recordBarriers(commandBuffer, finalBarriers);
+}
+
+void SveRenderGraph::compile() {
+    releaseCompiled();
+    stats.compileCount++;
+
+    // cull, walking backwards: a pass lives if it has side effects or writes something a later
+    // live pass (or the outside) still needs. A clear ends the need for earlier contents
+    std::vector<bool> needed(resources.size(), false);
+    for (ResourceId r = 0; r < resources.size(); r++) {
+        needed[r] = resources[r].output || (resources[r].imported && resources[r].finalLayout != VK_IMAGE_LAYOUT_UNDEFINED);
+    }
+    std::vector<bool> live(passes.size(), false);
+    for (int i = static_cast<int>(passes.size()) - 1; i >= 0; i--) {
+        const Pass &pass = passes[i];
+        bool alive = pass.sideEffects;
+        for (const auto &use : pass.uses) {
+            alive = alive || (use.write && needed[use.resource]);
+        }
+        if (!alive) continue;
+        live[i] = true;
+        for (const auto &use : pass.uses) {
+            if (use.write && isCleared(pass, use.resource)) needed[use.resource] = false;
+        }
+        for (const auto &use : pass.uses) {
+            if (!use.write || !isCleared(pass, use.resource)) needed[use.resource] = true;
+        }
+    }
+
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < passes.size(); i++) {
+        if (live[i]) order.push_back(i);
+    }
+    stats.livePasses = static_cast<uint32_t>(order.size());
+    stats.culledPasses = static_cast<uint32_t>(passes.size() - order.size());
+
+    // lifetimes in live pass order
+    std::vector<int> firstUse(resources.size(), -1);
+    std::vector<int> lastUse(resources.size(), -1);
+    std::vector<VkImageUsageFlags> usage(resources.size(), 0);
+    std::vector<bool> attachmentsOnly(resources.size(), true);
+    for (int k = 0; k < static_cast<int>(order.size()); k++) {
+        for (const auto &use : passes[order[k]].uses) {
+            if (firstUse[use.resource] < 0) firstUse[use.resource] = k;
+            lastUse[use.resource] = k;
+            AccessInfo info = accessInfo(use.access);
+            usage[use.resource] |= info.usage;
+            attachmentsOnly[use.resource] = attachmentsOnly[use.resource] && info.attachment;
+        }
+    }
+    for (ResourceId r = 0; r < resources.size(); r++) {
+        if (resources[r].output && firstUse[r] >= 0) lastUse[r] = static_cast<int>(order.size()) - 1;
+    }
+
+    // transient images. One that only lives inside a single pass never leaves tile memory, it
+    // gets lazily allocated memory of its own. The rest are aliased below
+    VkMemoryPropertyFlags lazyProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    const auto &memoryProperties = sveDevice.allocator().getMemoryProperties();
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if (memoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+            lazyProperties |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+            break;
+        }
+    }
+
+    struct Candidate {
+        ResourceId resource;
+        VkMemoryRequirements requirements;
+    };
+    std::vector<Candidate> candidates;
+    transientImages.assign(resources.size(), TransientImage{});
+    stats.transientImages = 0;
+    for (ResourceId r = 0; r < resources.size(); r++) {
+        const Resource &resource = resources[r];
+        if (resource.imported || firstUse[r] < 0) continue;
+        bool lazy = attachmentsOnly[r] && firstUse[r] == lastUse[r] && !resource.output;
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = resource.desc.extent.width;
+        imageInfo.extent.height = resource.desc.extent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = resource.desc.format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = usage[r] | (lazy ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        auto &transient = transientImages[r];
+        if (lazy) {
+            sveDevice.createImageWithInfo(imageInfo, lazyProperties, transient.image, transient.allocation);
+        } else {
+            if (vkCreateImage(sveDevice.device(), &imageInfo, nullptr, &transient.image) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create render graph image!");
+            }
+            VkMemoryRequirements requirements;
+            vkGetImageMemoryRequirements(sveDevice.device(), transient.image, &requirements);
+            candidates.push_back({r, requirements});
+        }
+        stats.transientImages++;
+    }
+
+    // greedy aliasing, biggest first: an image joins the first slot whose images are all dead
+    // before it starts or born after it ends
+    struct Slot {
+        VkMemoryRequirements requirements;
+        std::vector<ResourceId> images;
+    };
+    std::vector<Slot> slots;
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+        return a.requirements.size > b.requirements.size;
+    });
+    for (const auto &candidate : candidates) {
+        ResourceId r = candidate.resource;
+        Slot *target = nullptr;
+        for (auto &slot : slots) {
+            if ((slot.requirements.memoryTypeBits & candidate.requirements.memoryTypeBits) == 0) continue;
+            bool overlaps = false;
+            for (ResourceId other : slot.images) {
+                overlaps = overlaps || !(lastUse[other] < firstUse[r] || lastUse[r] < firstUse[other]);
+            }
+            if (!overlaps) {
+                target = &slot;
+                break;
+            }
+        }
+        if (target == nullptr) {
+            slots.push_back({candidate.requirements, {}});
+            target = &slots.back();
+        }
+        target->requirements.size = std::max(target->requirements.size, candidate.requirements.size);
+        target->requirements.alignment = std::max(target->requirements.alignment, candidate.requirements.alignment);
+        target->requirements.memoryTypeBits &= candidate.requirements.memoryTypeBits;
+        target->images.push_back(r);
+    }
+
+    // the previous occupant of a transient image's memory, its last access has to finish before
+    // the image is first touched. For the first image of a slot that is the last one of the
+    // previous frame, and a lazily allocated image follows itself
+    std::vector<ResourceId> predecessor(resources.size(), NO_RESOURCE);
+    for (ResourceId r = 0; r < resources.size(); r++) {
+        if (transientImages[r].image != VK_NULL_HANDLE) predecessor[r] = r;
+    }
+    stats.aliasedImages = 0;
+    stats.aliasedMemory = 0;
+    for (auto &slot : slots) {
+        // a slot may alias depth and color images, all of it counts as render targets
+        SveAllocation allocation = sveDevice.allocator().allocateMemory(
+            slot.requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, SveMemoryCategory::RenderTargets);
+        aliasedAllocations.push_back(allocation);
+        stats.aliasedMemory += slot.requirements.size;
+        if (slot.images.size() > 1) stats.aliasedImages += static_cast<uint32_t>(slot.images.size());
+
+        std::sort(slot.images.begin(), slot.images.end(), [&](ResourceId a, ResourceId b) { return firstUse[a] < firstUse[b]; });
+        for (size_t i = 0; i < slot.images.size(); i++) {
+            if (vkBindImageMemory(sveDevice.device(), transientImages[slot.images[i]].image, allocation.memory, allocation.offset) != VK_SUCCESS) {
+                throw std::runtime_error("failed to bind render graph image memory!");
+            }
+            predecessor[slot.images[i]] = slot.images[i > 0 ? i - 1 : slot.images.size() - 1];
+        }
+    }
+
+    for (ResourceId r = 0; r < resources.size(); r++) {
+        auto &transient = transientImages[r];
+        if (transient.image == VK_NULL_HANDLE) continue;
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = transient.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = resources[r].desc.format;
+        viewInfo.subresourceRange.aspectMask = aspectOf(resources[r].desc.format) & ~VK_IMAGE_ASPECT_STENCIL_BIT;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+        if (vkCreateImageView(sveDevice.device(), &viewInfo, nullptr, &transient.view) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create render graph image view!");
+        }
+    }
+
+    // barriers: replay the live passes tracking each image's layout, its last write and the
+    // stages that read it since, and only emit a barrier on a layout change or a real hazard
+    struct State {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags2KHR writeStages = 0;
+        VkAccessFlags2KHR writeAccess = 0;
+        VkPipelineStageFlags2KHR readStages = 0;     // since the last write
+        VkPipelineStageFlags2KHR visibleStages = 0;  // the last write was made visible to these
+    };
+    const VkAccessFlags2KHR writeMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT_KHR |
+                                        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT_KHR |
+                                        VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR;
+    std::vector<VkPipelineStageFlags2KHR> lastStages(resources.size(), 0);
+    std::vector<VkAccessFlags2KHR> lastWrites(resources.size(), 0);
+    for (int k = 0; k < static_cast<int>(order.size()); k++) {
+        for (const auto &use : passes[order[k]].uses) {
+            if (lastUse[use.resource] != k) continue;
+            AccessInfo info = accessInfo(use.access);
+            lastStages[use.resource] |= info.stages;
+            if (use.write) lastWrites[use.resource] |= info.access & writeMask;
+        }
+    }
+
+    std::vector<State> states(resources.size());
+    for (ResourceId r = 0; r < resources.size(); r++) {
+        if (resources[r].imported) {
+            states[r].layout = resources[r].initialLayout;
+            states[r].writeStages = resources[r].initialStage;
+        }
+    }
+
+    for (uint32_t k = 0; k < order.size(); k++) {
+        const Pass &pass = passes[order[k]];
+        CompiledPass compiledPass{};
+        compiledPass.passIndex = order[k];
+
+        // one barrier per image, merging every use the pass makes of it
+        std::vector<ResourceId> seen;
+        for (const auto &use : pass.uses) {
+            ResourceId r = use.resource;
+            if (std::find(seen.begin(), seen.end(), r) != seen.end()) continue;
+            seen.push_back(r);
+
+            AccessInfo info = accessInfo(use.access);
+            bool write = use.write;
+            for (const auto &other : pass.uses) {
+                if (other.resource != r) continue;
+                AccessInfo otherInfo = accessInfo(other.access);
+                assert(otherInfo.layout == info.layout && "An image is used in two layouts by the same pass");
+                info.stages |= otherInfo.stages;
+                info.access |= otherInfo.access;
+                write = write || other.write;
+            }
+
+            State &state = states[r];
+            if (firstUse[r] == static_cast<int>(k) && predecessor[r] != NO_RESOURCE) {
+                state.writeStages = lastStages[predecessor[r]];
+                state.writeAccess = lastWrites[predecessor[r]];
+            }
+
+            bool layoutChange = state.layout != info.layout;
+            bool hazard = write ? (state.writeStages | state.readStages) != 0
+                                : state.writeStages != 0 && (info.stages & ~state.visibleStages) != 0;
+            if (layoutChange || hazard) {
+                Barrier barrier{};
+                barrier.resource = r;
+                // a layout transition writes the image, so it also has to wait for earlier reads
+                barrier.srcStages = state.writeStages | (write || layoutChange ? state.readStages : 0);
+                barrier.srcAccess = state.writeAccess;
+                barrier.dstStages = info.stages;
+                barrier.dstAccess = info.access;
+                // transients start undefined every frame, nothing in them is worth keeping
+                barrier.oldLayout = firstUse[r] == static_cast<int>(k) && !resources[r].imported
+                                        ? VK_IMAGE_LAYOUT_UNDEFINED
+                                        : state.layout;
+                barrier.newLayout = info.layout;
+                compiledPass.barriers.push_back(barrier);
+            }
+
+            if (write) {
+                state.writeStages = info.stages;
+                state.writeAccess = info.access & writeMask;
+                state.readStages = 0;
+                state.visibleStages = 0;
+            } else {
+                if (layoutChange || hazard) state.visibleStages |= info.stages;
+                state.readStages |= info.stages;
+            }
+            state.layout = info.layout;
+        }
+
+        createRenderPass(compiledPass, k, firstUse, lastUse);
+        compiledPasses.push_back(std::move(compiledPass));
+    }
+
+    for (ResourceId r = 0; r < resources.size(); r++) {
+        const Resource &resource = resources[r];
+        if (!resource.imported || resource.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED) continue;
+        const State &state = states[r];
+        if (state.layout == resource.finalLayout && firstUse[r] < 0) continue;
+        if (state.layout == resource.finalLayout && state.writeStages == 0) continue;
+
+        Barrier barrier{};
+        barrier.resource = r;
+        barrier.srcStages = state.writeStages | state.readStages;
+        barrier.srcAccess = state.writeAccess;
+        barrier.dstStages = 0;  // whoever comes next (present, next frame) synchronizes itself
+        barrier.dstAccess = 0;
+        barrier.oldLayout = state.layout;
+        barrier.newLayout = resource.finalLayout;
+        finalBarriers.push_back(barrier);
+    }
+
+    compiled = true;
+}
+
+void SveRenderGraph::createRenderPass(
+    CompiledPass &compiledPass,
+    uint32_t order,
+    const std::vector<int> &firstUse,
+    const std::vector<int> &lastUse) {
+    const Pass &pass = passes[compiledPass.passIndex];
+
+    std::vector<ResourceId> colors;
+    ResourceId depth = NO_RESOURCE;
+    Access depthAccess = Access::DepthAttachment;
+    for (const auto &use : pass.uses) {
+        if (use.access == Access::ColorAttachment) {
+            if (std::find(colors.begin(), colors.end(), use.resource) == colors.end()) colors.push_back(use.resource);
+        } else if (use.access == Access::DepthAttachment || use.access == Access::DepthReadOnly) {
+            assert((depth == NO_RESOURCE || depth == use.resource) && "A pass can only have one depth attachment");
+            depth = use.resource;
+            depthAccess = use.access;
+        }
+    }
+    if (colors.empty() && depth == NO_RESOURCE) {
+        return;
+    }
+
+    compiledPass.attachments = colors;
+    if (depth != NO_RESOURCE) compiledPass.attachments.push_back(depth);
+    compiledPass.extent = resources[compiledPass.attachments[0]].desc.extent;
+
+    std::vector<VkAttachmentDescription> attachments;
+    for (ResourceId r : compiledPass.attachments) {
+        const Resource &resource = resources[r];
+        assert(resource.desc.extent.width == compiledPass.extent.width &&
+               resource.desc.extent.height == compiledPass.extent.height &&
+               "Attachments of a pass must have the same extent");
+        VkImageLayout layout = accessInfo(r == depth ? depthAccess : Access::ColorAttachment).layout;
+        bool firstTouch = firstUse[r] == static_cast<int>(order) &&
+                          (!resource.imported || resource.initialLayout == VK_IMAGE_LAYOUT_UNDEFINED);
+        bool keep = lastUse[r] > static_cast<int>(order) || resource.imported || resource.output;
+
+        VkAttachmentDescription attachment{};
+        attachment.format = resource.desc.format;
+        attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        attachment.loadOp = isCleared(pass, r) ? VK_ATTACHMENT_LOAD_OP_CLEAR
+                            : firstTouch       ? VK_ATTACHMENT_LOAD_OP_DONT_CARE
+                                               : VK_ATTACHMENT_LOAD_OP_LOAD;
+        attachment.storeOp = keep ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.stencilLoadOp = hasStencil(resource.desc.format) ? attachment.loadOp : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachment.stencilStoreOp = hasStencil(resource.desc.format) ? attachment.storeOp : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        // the graph's barriers do every transition, the render pass never changes layouts
+        attachment.initialLayout = layout;
+        attachment.finalLayout = layout;
+        attachments.push_back(attachment);
+    }
+
+    std::vector<VkAttachmentReference> colorRefs;
+    for (uint32_t i = 0; i < colors.size(); i++) {
+        colorRefs.push_back({i, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL});
+    }
+    VkAttachmentReference depthRef{static_cast<uint32_t>(colors.size()), accessInfo(depthAccess).layout};
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = static_cast<uint32_t>(colorRefs.size());
+    subpass.pColorAttachments = colorRefs.data();
+    subpass.pDepthStencilAttachment = depth != NO_RESOURCE ? &depthRef : nullptr;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    renderPassInfo.pAttachments = attachments.data();
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+
+    if (vkCreateRenderPass(sveDevice.device(), &renderPassInfo, nullptr, &compiledPass.renderPass) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create render graph render pass!");
+    }
+}
+
+// frames in flight may still use the old render passes, framebuffers and images, they go through
+// the device's deferred destruction
+void SveRenderGraph::releaseCompiled() {
+    if (compiledPasses.empty() && transientImages.empty() && framebuffers.empty()) {
+        return;
+    }
+
+    std::vector<VkFramebuffer> oldFramebuffers;
+    for (auto &kv : framebuffers) {
+        oldFramebuffers.push_back(kv.second);
+    }
+    framebuffers.clear();
+
+    std::vector<VkRenderPass> oldRenderPasses;
+    for (auto &compiledPass : compiledPasses) {
+        if (compiledPass.renderPass != VK_NULL_HANDLE) {
+            oldRenderPasses.push_back(compiledPass.renderPass);
+        }
+    }
+    compiledPasses.clear();
+    finalBarriers.clear();
+
+    sveDevice.deferDestruction([&device = sveDevice,
+                                oldFramebuffers = std::move(oldFramebuffers),
+                                oldRenderPasses = std::move(oldRenderPasses),
+                                oldImages = std::move(transientImages),
+                                oldAllocations = std::move(aliasedAllocations)]() mutable {
+        for (auto framebuffer : oldFramebuffers) {
+            vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
+        }
+        for (auto renderPass : oldRenderPasses) {
+            vkDestroyRenderPass(device.device(), renderPass, nullptr);
+        }
+        for (auto &transient : oldImages) {
+            if (transient.view != VK_NULL_HANDLE) {
+                vkDestroyImageView(device.device(), transient.view, nullptr);
+            }
+            if (transient.image == VK_NULL_HANDLE) continue;
+            if (transient.allocation.memory != VK_NULL_HANDLE) {
+                device.destroyImage(transient.image, transient.allocation);
+            } else {
+                vkDestroyImage(device.device(), transient.image, nullptr);
+            }
+        }
+        for (auto &allocation : oldAllocations) {
+            device.allocator().free(allocation);
+        }
+    });
+    transientImages.clear();
+    aliasedAllocations.clear();
+    compiled = false;
+}
+
+VkFramebuffer SveRenderGraph::getFramebuffer(const CompiledPass &compiledPass) {
+    size_t key = 0;
+    hashCombine(key, compiledPass.passIndex, compiledPass.extent.width, compiledPass.extent.height);
+    std::vector<VkImageView> views;
+    for (ResourceId r : compiledPass.attachments) {
+        views.push_back(viewOf(r));
+        hashCombine(key, views.back());
+    }
+
+    auto it = framebuffers.find(key);
+    if (it != framebuffers.end()) {
+        return it->second;
+    }
+
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = compiledPass.renderPass;
+    framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+    framebufferInfo.pAttachments = views.data();
+    framebufferInfo.width = compiledPass.extent.width;
+    framebufferInfo.height = compiledPass.extent.height;
+    framebufferInfo.layers = 1;
+
+    VkFramebuffer framebuffer;
+    if (vkCreateFramebuffer(sveDevice.device(), &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create render graph framebuffer!");
+    }
+    framebuffers.emplace(key, framebuffer);
+    return framebuffer;
+}
+
+void SveRenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const std::vector<Barrier> &barriers) {
+    if (barriers.empty()) {
+        return;
+    }
+    stats.barriers += static_cast<uint32_t>(barriers.size());
+
+    auto range = [&](ResourceId r) {
+        VkImageSubresourceRange subresourceRange{};
+        subresourceRange.aspectMask = aspectOf(resources[r].desc.format);
+        subresourceRange.baseMipLevel = 0;
+        subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+        subresourceRange.baseArrayLayer = 0;
+        subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+        return subresourceRange;
+    };
+
+    if (sveDevice.supportsSynchronization2()) {
+        barriers2.clear();
+        for (const auto &barrier : barriers) {
+            VkImageMemoryBarrier2KHR imageBarrier{};
+            imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR;
+            imageBarrier.srcStageMask = barrier.srcStages;
+            imageBarrier.srcAccessMask = barrier.srcAccess;
+            imageBarrier.dstStageMask = barrier.dstStages;
+            imageBarrier.dstAccessMask = barrier.dstAccess;
+            imageBarrier.oldLayout = barrier.oldLayout;
+            imageBarrier.newLayout = barrier.newLayout;
+            imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.image = imageOf(barrier.resource);
+            imageBarrier.subresourceRange = range(barrier.resource);
+            barriers2.push_back(imageBarrier);
+        }
+
+        VkDependencyInfoKHR dependencyInfo{};
+        dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR;
+        dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(barriers2.size());
+        dependencyInfo.pImageMemoryBarriers = barriers2.data();
+        SveCommandCounters::count(SveCommandCounters::Barriers);
+        sveDevice.cmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+        return;
+    }
+
+    // legacy fallback: every stage and access bit the graph uses has the same value in both APIs,
+    // but the stage masks are shared by the whole call
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+    legacyBarriers.clear();
+    for (const auto &barrier : barriers) {
+        srcStages |= static_cast<VkPipelineStageFlags>(barrier.srcStages);
+        dstStages |= static_cast<VkPipelineStageFlags>(barrier.dstStages);
+
+        VkImageMemoryBarrier imageBarrier{};
+        imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        imageBarrier.srcAccessMask = static_cast<VkAccessFlags>(barrier.srcAccess);
+        imageBarrier.dstAccessMask = static_cast<VkAccessFlags>(barrier.dstAccess);
+        imageBarrier.oldLayout = barrier.oldLayout;
+        imageBarrier.newLayout = barrier.newLayout;
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.image = imageOf(barrier.resource);
+        imageBarrier.subresourceRange = range(barrier.resource);
+        legacyBarriers.push_back(imageBarrier);
+    }
+    SveCommandCounters::count(SveCommandCounters::Barriers);
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        dstStages != 0 ? dstStages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        static_cast<uint32_t>(legacyBarriers.size()),
+        legacyBarriers.data());
+}
+
+VkImage SveRenderGraph::imageOf(ResourceId resource) const {
+    return resources[resource].imported ? resources[resource].image : transientImages[resource].image;
+}
+
+VkImageView SveRenderGraph::viewOf(ResourceId resource) const {
+    return resources[resource].imported ? resources[resource].view : transientImages[resource].view;
+}
+
+VkRenderPass SveRenderGraph::getRenderPass(const std::string &passName) const {
+    for (const auto &compiledPass : compiledPasses) {
+        if (passes[compiledPass.passIndex].name == passName) {
+            return compiledPass.renderPass;
+        }
+    }
+    return VK_NULL_HANDLE;
+}
+
+}  // namespace sve
@@ -0,0 +1,209 @@
+#pragma once
+
+#include "sve_device.hpp"
+
+// std
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sve {
+
+class SveGpuProfiler;
+
+// Frame render graph. Every frame the passes and the images they read and write are declared in
+// submission order, then execute() records them:
+//  - passes that contribute nothing to an output (or have no side effects) are culled
+//  - image layout transitions and hazards are resolved with one batched barrier per pass, using
+//    VK_KHR_synchronization2 when the device has it and vkCmdPipelineBarrier otherwise
+//  - passes with attachments get a render pass and framebuffer from the graph, with load and store
+//    ops derived from who touches the image before and after
+//  - graph owned (transient) images whose lifetimes don't overlap alias the same memory, images
+//    that only live inside one pass get lazily allocated memory
+// Declaring is cheap, compiling is not: the compiled graph is cached and only rebuilt when the
+// declared topology changes. Imported image handles may change every frame (swap chain images)
+class SveRenderGraph {
+   public:
+    using ResourceId = uint32_t;
+    using ExecuteFn = std::function<void(VkCommandBuffer)>;
+
+    enum class Access {
+        ColorAttachment,
+        DepthAttachment,
+        DepthReadOnly,  // depth test without writes
+        FragmentSampled,
+        TransferSrc,
+        TransferDst,
+    };
+
+    struct ImageDesc {
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        VkExtent2D extent{0, 0};
+    };
+
+    struct Stats {
+        uint32_t compileCount = 0;
+        uint32_t livePasses = 0;
+        uint32_t culledPasses = 0;
+        uint32_t barriers = 0;  // image barriers recorded by the last execute
+        uint32_t transientImages = 0;
+        uint32_t aliasedImages = 0;       // transient images placed in memory another one also uses
+        VkDeviceSize aliasedMemory = 0;  // bytes allocated for all aliased images together
+    };
+
+    class PassBuilder {
+       public:
+        PassBuilder &read(ResourceId resource, Access access);
+        PassBuilder &write(ResourceId resource, Access access);
+        // cleared attachments don't need what earlier passes wrote, which lets those be culled
+        PassBuilder &clearColor(ResourceId resource, VkClearColorValue color);
+        PassBuilder &clearDepth(ResourceId resource, float depth);
+        // never culled, for passes that write things the graph doesn't track (queries, buffers)
+        PassBuilder &setSideEffects();
+        // render to the top left part of the attachments only, e.g. for dynamic resolution. Not
+        // part of the topology, so changing it every frame doesn't recompile anything
+        PassBuilder &setRenderArea(VkExtent2D extent);
+
+       private:
+        PassBuilder(SveRenderGraph &graph, uint32_t passIndex) : graph{graph}, passIndex{passIndex} {}
+
+        SveRenderGraph &graph;
+        uint32_t passIndex;
+
+        friend class SveRenderGraph;
+    };
+
+    SveRenderGraph(SveDevice &device);
+    ~SveRenderGraph();
+
+    SveRenderGraph(const SveRenderGraph &) = delete;
+    SveRenderGraph &operator=(const SveRenderGraph &) = delete;
+
+    // drops the declarations of the last frame, the compiled graph is kept
+    void reset();
+
+    ResourceId createImage(const std::string &name, const ImageDesc &desc);
+    // external image, e.g. the swap chain image. It is transitioned from initialLayout after
+    // initialStage, and to finalLayout at the end of the graph unless that is UNDEFINED
+    ResourceId importImage(
+        const std::string &name,
+        VkImage image,
+        VkImageView view,
+        const ImageDesc &desc,
+        VkImageLayout initialLayout,
+        VkPipelineStageFlags2KHR initialStage,
+        VkImageLayout finalLayout);
+    // keeps the image's writers alive even though no pass reads it
+    void markOutput(ResourceId resource);
+
+    // passes run in the order they are added, execute is called inside the pass's render pass
+    // when it has attachments
+    PassBuilder addPass(const std::string &name, ExecuteFn execute);
+
+    void execute(VkCommandBuffer commandBuffer);
+    // forces a recompile, e.g. after the swap chain was recreated and imported views went away
+    void invalidate() { compiled = false; }
+
+    // render pass of a compiled pass, null if it was culled or has no attachments
+    VkRenderPass getRenderPass(const std::string &passName) const;
+    // view of an image, for binding it in pass callbacks. Valid while the graph executes
+    VkImageView getImageView(ResourceId resource) const { return viewOf(resource); }
+    const Stats &getStats() const { return stats; }
+    // brackets every executed pass with a profiler scope named after it, null to stop
+    void setProfiler(SveGpuProfiler *gpuProfiler) { profiler = gpuProfiler; }
+
+   private:
+    struct AccessInfo {
+        VkPipelineStageFlags2KHR stages;
+        VkAccessFlags2KHR access;
+        VkImageLayout layout;
+        VkImageUsageFlags usage;
+        bool attachment;
+    };
+    static AccessInfo accessInfo(Access access);
+
+    struct ResourceUse {
+        ResourceId resource;
+        Access access;
+        bool write;
+    };
+    struct Pass {
+        std::string name;
+        ExecuteFn execute;
+        std::vector<ResourceUse> uses;
+        std::vector<std::pair<ResourceId, VkClearValue>> clears;
+        bool sideEffects = false;
+        VkExtent2D renderArea{0, 0};  // zero for the whole attachment extent
+    };
+    struct Resource {
+        std::string name;
+        ImageDesc desc;
+        bool imported = false;
+        bool output = false;
+        VkImage image = VK_NULL_HANDLE;  // imported only, refreshed every frame
+        VkImageView view = VK_NULL_HANDLE;
+        VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags2KHR initialStage = 0;
+        VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    };
+
+    struct Barrier {
+        ResourceId resource;
+        VkPipelineStageFlags2KHR srcStages;
+        VkAccessFlags2KHR srcAccess;
+        VkPipelineStageFlags2KHR dstStages;
+        VkAccessFlags2KHR dstAccess;
+        VkImageLayout oldLayout;
+        VkImageLayout newLayout;
+    };
+    struct CompiledPass {
+        uint32_t passIndex;
+        std::vector<Barrier> barriers;  // recorded before the pass
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        std::vector<ResourceId> attachments;  // colors in declaration order, then depth
+        VkExtent2D extent{0, 0};
+    };
+    struct TransientImage {
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        SveAllocation allocation{};  // own memory, empty for aliased images
+    };
+
+    size_t topologyHash() const;
+    bool isCleared(const Pass &pass, ResourceId resource) const;
+    void compile();
+    void createRenderPass(CompiledPass &compiledPass, uint32_t order, const std::vector<int> &firstUse, const std::vector<int> &lastUse);
+    void releaseCompiled();
+    VkFramebuffer getFramebuffer(const CompiledPass &compiledPass);
+    void recordBarriers(VkCommandBuffer commandBuffer, const std::vector<Barrier> &barriers);
+    VkImage imageOf(ResourceId resource) const;
+    VkImageView viewOf(ResourceId resource) const;
+
+    SveDevice &sveDevice;
+
+    // declared this frame
+    std::vector<Pass> passes;
+    std::vector<Resource> resources;
+    // last frame's passes, reused by addPass so their vectors keep their capacity
+    std::vector<Pass> recycledPasses;
+
+    // compiled, reused while the topology hash matches
+    bool compiled = false;
+    size_t compiledHash = 0;
+    std::vector<CompiledPass> compiledPasses;
+    std::vector<Barrier> finalBarriers;
+    std::vector<TransientImage> transientImages;  // indexed by ResourceId
+    std::vector<SveAllocation> aliasedAllocations;
+    std::unordered_map<size_t, VkFramebuffer> framebuffers;  // by pass and attachment views
+
+    // scratch for recordBarriers and execute
+    std::vector<VkImageMemoryBarrier2KHR> barriers2;
+    std::vector<VkImageMemoryBarrier> legacyBarriers;
+    std::vector<VkClearValue> clearValues;
+
+    Stats stats{};
+    SveGpuProfiler *profiler = nullptr;
+};
+
+}  // namespace sve
@@ -1,40 +1,92 @@
 #include "sve_renderer.hpp"
 
+#include "sve_command_counters.hpp"
+#include "sve_cpu_profiler.hpp"
+
 // std
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <stdexcept>
+#include <thread>
 
 namespace sve {
 
 SveRenderer::SveRenderer(SveWindow &window, SveDevice &device) : sveWindow{window}, sveDevice{device} {
     recreateSwapChain();
     createCommandBuffers();
+    createQueryPool();
+    createFrameTimeline();
 }
 
-SveRenderer::~SveRenderer() { freeCommandBuffers(); }
+SveRenderer::~SveRenderer() {
+    if (!retiredSwapChains.empty()) {
+        vkDeviceWaitIdle(sveDevice.device());
+        retiredSwapChains.clear();
+    }
+    freeCommandBuffers();
+    if (statisticsQueryPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(sveDevice.device(), statisticsQueryPool, nullptr);
+    }
+    if (timestampQueryPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(sveDevice.device(), timestampQueryPool, nullptr);
+    }
+    vkDestroySemaphore(sveDevice.device(), frameTimeline, nullptr);
+}
 
 void SveRenderer::recreateSwapChain() {
+    SVE_PROFILE_FUNCTION();
     auto extent = sveWindow.getExtent();
     while (extent.width == 0 || extent.height == 0) {
         extent = sveWindow.getExtent();
         glfwWaitEvents();
     }
 
-    vkDeviceWaitIdle(sveDevice.device());
-
+    // no device idle: frames already submitted keep rendering to and presenting the old swap chain,
+    // which is retired until they have completed
     if (sveSwapChain == nullptr) {
-        sveSwapChain = std::make_unique<SveSwapChain>(sveDevice, extent);
+        sveSwapChain = std::make_unique<SveSwapChain>(sveDevice, extent, presentPolicy, attachmentPool);
     } else {
         std::shared_ptr<SveSwapChain> oldSwapChain = std::move(sveSwapChain);
-        sveSwapChain = std::make_unique<SveSwapChain>(sveDevice, extent, oldSwapChain);
+        sveSwapChain = std::make_unique<SveSwapChain>(sveDevice, extent, presentPolicy, attachmentPool, oldSwapChain);
+        retiredSwapChains.push_back({oldSwapChain, submittedFrameValue});
 
         if (!oldSwapChain->compareSwapFormats(*sveSwapChain.get())) {
             throw std::runtime_error("Swap chain image format or depth format has changed!");
         }
     }
 
-    // we'll come back to this
+    // new images, no frame has used them yet
+    imageFrameValues.assign(sveSwapChain->imageCount(), 0);
+    swapChainGeneration++;
+}
+
+uint64_t SveRenderer::completedFrameValue() {
+    uint64_t value = 0;
+    if (sveDevice.getSemaphoreCounterValue(sveDevice.device(), frameTimeline, &value) != VK_SUCCESS) {
+        throw std::runtime_error("failed to read frame timeline!");
+    }
+    return value;
+}
+
+void SveRenderer::destroyRetiredSwapChains(uint64_t completedFrameValue) {
+    // completion of the GPU work doesn't tell when the presentation engine is done with the old
+    // images and present semaphores. Present fences do; without them the current swap chain having
+    // acquired its first presented image again is the best there is, see
+    // SveSwapChain::hasReacquiredFirstPresentedImage for why that is only a heuristic
+    bool presentsReleased = sveSwapChain->isHeadless() || sveSwapChain->hasReacquiredFirstPresentedImage();
+    retiredSwapChains.erase(
+        std::remove_if(
+            retiredSwapChains.begin(),
+            retiredSwapChains.end(),
+            [&](const RetiredSwapChain &retired) {
+                if (completedFrameValue < retired.lastFrameValue) {
+                    return false;
+                }
+                return sveDevice.supportsSwapchainMaintenance1() ? retired.swapChain->presentsCompleted()
+                                                                 : presentsReleased;
+            }),
+        retiredSwapChains.end());
 }
 
 void SveRenderer::createCommandBuffers() {
@@ -51,6 +103,139 @@ void SveRenderer::createCommandBuffers() {
     }
 }
 
+void SveRenderer::createQueryPool() {
+    if (!sveDevice.supportsPipelineStatistics()) {
+        return;
+    }
+
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+    queryPoolInfo.queryCount = SveSwapChain::MAX_FRAMES_IN_FLIGHT;
+    queryPoolInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+    if (vkCreateQueryPool(sveDevice.device(), &queryPoolInfo, nullptr, &statisticsQueryPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline statistics query pool!");
+    }
+    queryWritten.resize(SveSwapChain::MAX_FRAMES_IN_FLIGHT, false);
+}
+
+void SveRenderer::createFrameTimeline() {
+    VkSemaphoreTypeCreateInfoKHR typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+    if (vkCreateSemaphore(sveDevice.device(), &semaphoreInfo, nullptr, &frameTimeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create frame timeline semaphore!");
+    }
+
+    if (!sveDevice.properties.limits.timestampComputeAndGraphics) {
+        return;
+    }
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = 2 * SveSwapChain::MAX_FRAMES_IN_FLIGHT;
+    if (vkCreateQueryPool(sveDevice.device(), &queryPoolInfo, nullptr, &timestampQueryPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create frame timestamp query pool!");
+    }
+}
+
+void SveRenderer::setFramesInFlight(uint32_t count) {
+    assert(!isFrameStarted && "Can't change frames in flight while frame is in progress");
+    assert(count >= 1 && count <= SveSwapChain::MAX_FRAMES_IN_FLIGHT && "Frames in flight out of range");
+    framesInFlight = count;
+    // slots keep the value of their last frame, so whichever one comes next is waited on properly
+    currentFrameIndex %= framesInFlight;
+    frameSlotReady = false;
+}
+
+void SveRenderer::waitForTimeline(uint64_t value) {
+    SVE_PROFILE_FUNCTION();
+    VkSemaphoreWaitInfoKHR waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &frameTimeline;
+    waitInfo.pValues = &value;
+    if (sveDevice.waitSemaphores(sveDevice.device(), &waitInfo, UINT64_MAX) != VK_SUCCESS) {
+        throw std::runtime_error("failed to wait for frame timeline!");
+    }
+}
+
+void SveRenderer::waitForNextFrame() {
+    SVE_PROFILE_FUNCTION();
+    assert(!isFrameStarted && "Can't wait for the next frame while frame is in progress");
+    if (frameSlotReady) {
+        return;
+    }
+
+    auto waitStart = std::chrono::steady_clock::now();
+    waitForTimeline(slotFrameValues[currentFrameIndex]);
+    auto waitEnd = std::chrono::steady_clock::now();
+    frameTimings.cpuWaitMs = std::chrono::duration<float, std::milli>(waitEnd - waitStart).count();
+    frameTimings.latencySleepMs = 0.f;
+
+    if (latencyMode == SveLatencyMode::LowLatency && submittedFrameValue > 1) {
+        // wait for all but the newest frame, then for as long as the GPU will still be busy with it
+        // minus what the CPU needs to record the next one
+        waitForTimeline(submittedFrameValue - 1);
+        auto sleepStart = std::chrono::steady_clock::now();
+        frameTimings.cpuWaitMs += std::chrono::duration<float, std::milli>(sleepStart - waitEnd).count();
+
+        float slackMs = frameTimings.gpuFrameMs - frameTimings.cpuFrameMs - 1.f;  // 1ms of margin
+        if (timestampQueryPool != VK_NULL_HANDLE && slackMs > 0.f) {
+            std::this_thread::sleep_for(std::chrono::duration<float, std::milli>(slackMs));
+            frameTimings.latencySleepMs =
+                std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - sleepStart).count();
+        }
+    }
+
+    readTimestamps();
+    uint64_t completed = completedFrameValue();
+    sveDevice.updateFrameProgress(submittedFrameValue, completed);
+    destroyRetiredSwapChains(completed);
+    frameReadyTime = std::chrono::steady_clock::now();
+    frameSlotReady = true;
+}
+
+// the slot's frame has completed, so its timestamps are available without waiting
+void SveRenderer::readTimestamps() {
+    uint64_t frameValue = slotFrameValues[currentFrameIndex];
+    if (timestampQueryPool == VK_NULL_HANDLE || frameValue == 0) {
+        return;
+    }
+
+    std::array<uint64_t, 2> timestamps{};
+    if (vkGetQueryPoolResults(
+            sveDevice.device(),
+            timestampQueryPool,
+            2 * currentFrameIndex,
+            2,
+            sizeof(timestamps),
+            timestamps.data(),
+            sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+        return;
+    }
+
+    float period = sveDevice.properties.limits.timestampPeriod * 1e-6f;  // ticks to ms
+    float gpuFrameMs = static_cast<float>(timestamps[1] - timestamps[0]) * period;
+    frameTimings.gpuFrameMs = frameTimings.gpuFrameMs == 0.f ? gpuFrameMs : .9f * frameTimings.gpuFrameMs + .1f * gpuFrameMs;
+    frameTimings.latestGpuFrameMs = gpuFrameMs;
+    // frames are read back in submission order, unless the frames in flight count just changed
+    if (lastTimestampFrame != 0 && frameValue == lastTimestampFrame + 1 && timestamps[0] > lastGpuEnd) {
+        frameTimings.gpuIdleMs = static_cast<float>(timestamps[0] - lastGpuEnd) * period;
+    } else {
+        frameTimings.gpuIdleMs = 0.f;
+    }
+    lastGpuEnd = timestamps[1];
+    lastTimestampFrame = frameValue;
+}
+
 void SveRenderer::freeCommandBuffers() {
     vkFreeCommandBuffers(
         sveDevice.device(),
@@ -61,9 +246,16 @@ void SveRenderer::freeCommandBuffers() {
 }
 
 VkCommandBuffer SveRenderer::beginFrame() {
+    SVE_PROFILE_FUNCTION();
     assert(!isFrameStarted && "Can't call beginFrame while frame is already in progress");
+    waitForNextFrame();
+
+    if (presentPolicyChanged) {
+        presentPolicyChanged = false;
+        recreateSwapChain();
+    }
 
-    auto result = sveSwapChain->acquireNextImage(&currentImageIndex);
+    auto result = sveSwapChain->acquireNextImage(currentFrameIndex, &currentImageIndex);
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
         recreateSwapChain();
         return nullptr;  // indicate the frame has not started
@@ -73,7 +265,17 @@ VkCommandBuffer SveRenderer::beginFrame() {
         throw std::runtime_error("failed to acquire swap chain image!");
     }
 
+    // the image's per-image attachments may still be written by an older frame from another slot
+    auto imageWaitStart = std::chrono::steady_clock::now();
+    waitForTimeline(imageFrameValues[currentImageIndex]);
+    frameTimings.cpuWaitMs +=
+        std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - imageWaitStart).count();
+
     isFrameStarted = true;
+    frameSlotReady = false;
+    SveCommandCounters::beginFrame();
+    // from here on, released objects may be referenced by the frame being recorded
+    sveDevice.updateFrameProgress(submittedFrameValue + 1, completedFrameValue());
 
     auto commandBuffer = getCurrentCommandBuffer();
     VkCommandBufferBeginInfo beginInfo{};
@@ -82,19 +284,59 @@ VkCommandBuffer SveRenderer::beginFrame() {
     if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
         throw std::runtime_error("failed to begin recording command buffer!");
     }
+
+    if (statisticsQueryPool != VK_NULL_HANDLE) {
+        // the slot's last frame was waited on in waitForNextFrame, so its result is available
+        if (queryWritten[currentFrameIndex]) {
+            uint64_t result = 0;
+            if (vkGetQueryPoolResults(
+                    sveDevice.device(),
+                    statisticsQueryPool,
+                    currentFrameIndex,
+                    1,
+                    sizeof(result),
+                    &result,
+                    sizeof(result),
+                    VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+                fragmentInvocations = result;
+            }
+            queryWritten[currentFrameIndex] = false;
+        }
+        vkCmdResetQueryPool(commandBuffer, statisticsQueryPool, currentFrameIndex, 1);
+    }
+    if (timestampQueryPool != VK_NULL_HANDLE) {
+        vkCmdResetQueryPool(commandBuffer, timestampQueryPool, 2 * currentFrameIndex, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, 2 * currentFrameIndex);
+    }
     return commandBuffer;
 }
 
 void SveRenderer::endFrame() {
+    SVE_PROFILE_FUNCTION();
     assert(isFrameStarted && "Can't call endFrame while frame is not in progress");
 
     // end command buffer
     auto commandBuffer = getCurrentCommandBuffer();
+    if (timestampQueryPool != VK_NULL_HANDLE) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, 2 * currentFrameIndex + 1);
+    }
     if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
         throw std::runtime_error("failed to record command buffer!");
     }
 
-    auto result = sveSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+    uint64_t frameValue = ++submittedFrameValue;
+    slotFrameValues[currentFrameIndex] = frameValue;
+    imageFrameValues[currentImageIndex] = frameValue;
+    auto result = sveSwapChain->submitCommandBuffers(
+        &commandBuffer,
+        currentFrameIndex,
+        &currentImageIndex,
+        frameTimeline,
+        frameValue);
+
+    float cpuFrameMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameReadyTime).count();
+    frameTimings.cpuFrameMs = frameTimings.cpuFrameMs == 0.f ? cpuFrameMs : .9f * frameTimings.cpuFrameMs + .1f * cpuFrameMs;
+    frameTimings.latestCpuFrameMs = cpuFrameMs;
 
     // check if window has been resized and swapchain is still valid
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || sveWindow.wasWindowResized()) {
@@ -105,29 +347,39 @@ void SveRenderer::endFrame() {
     }
 
     isFrameStarted = false;
-    currentFrameIndex = (currentFrameIndex + 1) % SveSwapChain::MAX_FRAMES_IN_FLIGHT;
+    currentFrameIndex = (currentFrameIndex + 1) % framesInFlight;
 }
 
 void SveRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
     assert(isFrameStarted && "Can't call beginSwapChainRenderPass while frame is not in progress");
     assert(commandBuffer == getCurrentCommandBuffer() && "can't begin render pass on command buffer from a different frame");
 
+    bool deferred = renderPath == SveRenderPath::Deferred;
+
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = sveSwapChain->getRenderPass();
-    renderPassInfo.framebuffer = sveSwapChain->getFrameBuffer(currentImageIndex);
+    renderPassInfo.renderPass = deferred ? sveSwapChain->getDeferredRenderPass() : sveSwapChain->getRenderPass();
+    renderPassInfo.framebuffer = deferred ? sveSwapChain->getDeferredFrameBuffer(currentImageIndex)
+                                          : sveSwapChain->getFrameBuffer(currentImageIndex);
     renderPassInfo.renderArea.offset = {0, 0};
     renderPassInfo.renderArea.extent = sveSwapChain->getSwapChainExtent();
 
-    // Attachment index specified in the renderpass
-    std::array<VkClearValue, 2> clearValues{};
+    // Attachment index specified in the renderpass, the G-buffer attachments (2, 3) aren't cleared
+    std::array<VkClearValue, 4> clearValues{};
     clearValues[0].color = {0.01f, 0.01f, 0.01f, 1.0f};  // background color
     clearValues[1].depthStencil = {1.0f, 0};
 
-    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    renderPassInfo.clearValueCount = deferred ? 4 : 2;
     renderPassInfo.pClearValues = clearValues.data();
 
+    // a query begun outside the render pass covers every subpass, one begun inside only its own
+    if (deferred) {
+        beginFragmentStatistics(commandBuffer);
+    }
     vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    if (!deferred) {
+        beginFragmentStatistics(commandBuffer);
+    }
 
     VkViewport viewport{};
     viewport.x = 0.0f;
@@ -145,6 +397,37 @@ void SveRenderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) {
     assert(isFrameStarted && "Can't call endSwapChainRenderPass while frame is not in progress");
     assert(commandBuffer == getCurrentCommandBuffer() && "can't end render pass on command buffer from a different frame");
 
+    bool deferred = renderPath == SveRenderPath::Deferred;
+    if (!deferred) {
+        endFragmentStatistics(commandBuffer);
+    }
     vkCmdEndRenderPass(commandBuffer);
+    if (deferred) {
+        endFragmentStatistics(commandBuffer);
+    }
+}
+
+void SveRenderer::beginFragmentStatistics(VkCommandBuffer commandBuffer) {
+    assert(isFrameStarted && "Can't begin statistics while frame is not in progress");
+    if (statisticsQueryPool == VK_NULL_HANDLE || queryWritten[currentFrameIndex]) {
+        return;  // one query per frame slot
+    }
+    vkCmdBeginQuery(commandBuffer, statisticsQueryPool, currentFrameIndex, 0);
+    queryActive = true;
+}
+
+void SveRenderer::endFragmentStatistics(VkCommandBuffer commandBuffer) {
+    if (!queryActive) {
+        return;
+    }
+    vkCmdEndQuery(commandBuffer, statisticsQueryPool, currentFrameIndex);
+    queryWritten[currentFrameIndex] = true;
+    queryActive = false;
+}
+
+void SveRenderer::nextSubpass(VkCommandBuffer commandBuffer) {
+    assert(isFrameStarted && "Can't call nextSubpass while frame is not in progress");
+    assert(renderPath == SveRenderPath::Deferred && "Only the deferred render pass has a second subpass");
+    vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
 }
 }  // namespace sve
\ No newline at end of file
@@ -5,12 +5,37 @@
 #include "sve_window.hpp"
 
 // std
+#include <array>
 #include <cassert>
+#include <chrono>
 #include <memory>
 #include <vector>
 
 namespace sve {
 
+enum class SveRenderPath {
+    Forward,   // single subpass, lights evaluated while rasterizing
+    Deferred,  // G-buffer subpass then a lighting subpass reading it as input attachments
+};
+
+enum class SveLatencyMode {
+    Throughput,  // record as soon as a frame slot is free, the GPU queue stays full
+    LowLatency,  // keep at most one frame queued and start the next one just before the GPU needs it
+};
+
+// where the last frame spent its time waiting. GPU values come from timestamps and describe the
+// frame that last used the current slot, zero when the queue doesn't support timestamps
+struct SveFrameTimings {
+    float cpuWaitMs = 0.f;       // blocked on the GPU until the frame slot and image were free
+    float latencySleepMs = 0.f;  // extra delay in low latency mode
+    float cpuFrameMs = 0.f;      // from waitForNextFrame returning to the submit, smoothed
+    float gpuFrameMs = 0.f;      // command buffer execution, smoothed
+    float gpuIdleMs = 0.f;       // gap between the previous frame finishing on the GPU and this one starting
+    // unsmoothed, for per frame statistics. The GPU time is of the frame last read back
+    float latestCpuFrameMs = 0.f;
+    float latestGpuFrameMs = 0.f;
+};
+
 class SveRenderer {
    public:
     SveRenderer(SveWindow &window, SveDevice &device);
@@ -20,7 +45,15 @@ class SveRenderer {
     SveRenderer &operator=(const SveRenderer &) = delete;
 
     VkRenderPass getSwapChainRenderPass() const { return sveSwapChain->getRenderPass(); }
+    VkRenderPass getDeferredRenderPass() const { return sveSwapChain->getDeferredRenderPass(); }
     float getAspectRatio() const { return sveSwapChain->extentAspectRatio(); }
+    VkExtent2D getSwapChainExtent() const { return sveSwapChain->getSwapChainExtent(); }
+    VkFormat getSwapChainImageFormat() const { return sveSwapChain->getSwapChainImageFormat(); }
+    VkFormat getSwapChainDepthFormat() const { return sveSwapChain->getSwapChainDepthFormat(); }
+    // layout swap chain images have to be in when the frame ends
+    VkImageLayout getSwapChainPresentLayout() const { return sveSwapChain->getPresentLayout(); }
+    // bumped whenever the swap chain is recreated, anything caching its images has to let go
+    uint32_t getSwapChainGeneration() const { return swapChainGeneration; }
     bool isFrameInProgress() const { return isFrameStarted; }
 
     VkCommandBuffer getCurrentCommandBuffer() const {
@@ -33,24 +66,117 @@ class SveRenderer {
         return currentFrameIndex;
     }
 
+    VkImage getCurrentSwapChainImage() const {
+        assert(isFrameStarted && "Cannot get swap chain image when frame is not in progress");
+        return sveSwapChain->getImage(currentImageIndex);
+    }
+    VkImageView getCurrentSwapChainImageView() const {
+        assert(isFrameStarted && "Cannot get swap chain image view when frame is not in progress");
+        return sveSwapChain->getImageView(currentImageIndex);
+    }
+
+    // G-buffer attachments of the image being rendered, for the deferred lighting subpass
+    SveSwapChain::GBufferViews getGBufferViews() const {
+        assert(isFrameStarted && "Cannot get G-buffer views when frame is not in progress");
+        return sveSwapChain->getGBufferViews(currentImageIndex);
+    }
+
+    // picks the render pass beginSwapChainRenderPass starts, switch between frames only
+    void setRenderPath(SveRenderPath path) {
+        assert(!isFrameStarted && "Can't change render path while frame is in progress");
+        renderPath = path;
+    }
+    SveRenderPath getRenderPath() const { return renderPath; }
+
+    // 1 for the lowest latency up to SveSwapChain::MAX_FRAMES_IN_FLIGHT for the most throughput,
+    // per-frame resources must exist for all MAX_FRAMES_IN_FLIGHT slots. Switch between frames only
+    void setFramesInFlight(uint32_t count);
+    uint32_t getFramesInFlight() const { return framesInFlight; }
+    void setLatencyMode(SveLatencyMode mode) { latencyMode = mode; }
+    SveLatencyMode getLatencyMode() const { return latencyMode; }
+    const SveFrameTimings &getFrameTimings() const { return frameTimings; }
+    // the swap chain is recreated with the new present mode at the start of the next frame
+    void setPresentPolicy(SvePresentPolicy policy) {
+        presentPolicyChanged = presentPolicyChanged || policy != presentPolicy;
+        presentPolicy = policy;
+    }
+    SvePresentPolicy getPresentPolicy() const { return presentPolicy; }
+    VkPresentModeKHR getPresentMode() const { return sveSwapChain->getPresentMode(); }
+
+    // blocks until the next frame slot is free (and in low latency mode until the GPU is about to
+    // run dry). Call before sampling input and simulating so they happen as late as possible,
+    // beginFrame calls it when the app didn't
+    void waitForNextFrame();
     VkCommandBuffer beginFrame();
     void endFrame();
     void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
     void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
+    // deferred path only, moves from the G-buffer subpass to the lighting subpass
+    void nextSubpass(VkCommandBuffer commandBuffer);
+
+    // wrap a single subpass render pass started outside beginSwapChainRenderPass, e.g. by a
+    // render graph, to count its fragment shader invocations. No-ops without the feature
+    void beginFragmentStatistics(VkCommandBuffer commandBuffer);
+    void endFragmentStatistics(VkCommandBuffer commandBuffer);
+
+    // fragment shader invocations in the swap chain render pass, both subpasses on the deferred
+    // path, read back from the frame that last used the current frame slot. Zero when
+    // pipelineStatisticsQuery isn't supported
+    uint64_t getFragmentInvocations() const { return fragmentInvocations; }
 
    private:
     void createCommandBuffers();
     void freeCommandBuffers();
+    void createQueryPool();
+    void createFrameTimeline();
     void recreateSwapChain();
+    uint64_t completedFrameValue();
+    void destroyRetiredSwapChains(uint64_t completedFrameValue);
+    void waitForTimeline(uint64_t value);
+    void readTimestamps();
 
     SveWindow &sveWindow;
     SveDevice &sveDevice;
+    SveImagePool attachmentPool{sveDevice};  // declared first, swap chains give their images back on destruction
     std::unique_ptr<SveSwapChain> sveSwapChain;
+    // replaced swap chains, destroyed once the timeline passes the value of their last frame and
+    // the presentation engine is done with their images, see destroyRetiredSwapChains
+    struct RetiredSwapChain {
+        std::shared_ptr<SveSwapChain> swapChain;
+        uint64_t lastFrameValue;
+    };
+    std::vector<RetiredSwapChain> retiredSwapChains;
     std::vector<VkCommandBuffer> commandBuffers;
 
+    VkQueryPool statisticsQueryPool = VK_NULL_HANDLE;  // one query per frame slot
+    std::vector<bool> queryWritten;
+    bool queryActive = false;
+    uint64_t fragmentInvocations = 0;
+
+    // frame N signals N on completion. A slot or image can be reused once the timeline reaches the
+    // value of the frame that last used it
+    VkSemaphore frameTimeline = VK_NULL_HANDLE;
+    uint64_t submittedFrameValue = 0;
+    std::array<uint64_t, SveSwapChain::MAX_FRAMES_IN_FLIGHT> slotFrameValues{};
+    std::vector<uint64_t> imageFrameValues;
+    uint32_t framesInFlight = 2;
+    SveLatencyMode latencyMode = SveLatencyMode::Throughput;
+    bool frameSlotReady = false;
+
+    // start and end timestamp per frame slot
+    VkQueryPool timestampQueryPool = VK_NULL_HANDLE;
+    uint64_t lastGpuEnd = 0;
+    uint64_t lastTimestampFrame = 0;
+    std::chrono::steady_clock::time_point frameReadyTime;
+    SveFrameTimings frameTimings{};
+
     uint32_t currentImageIndex;
     int currentFrameIndex{0};
     bool isFrameStarted{false};
+    SveRenderPath renderPath = SveRenderPath::Forward;
+    SvePresentPolicy presentPolicy = SvePresentPolicy::Throughput;
+    bool presentPolicyChanged = false;
+    uint32_t swapChainGeneration = 0;
 };
 
 }  // namespace sve
\ No newline at end of file
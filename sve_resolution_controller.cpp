@@ -0,0 +1,59 @@
+#include "sve_resolution_controller.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace sve {
+
+// relative error of the GPU time that is accepted as on budget
+static constexpr float DEAD_BAND = .05f;
+// largest scale change per step, and the frames to wait after one so the smoothed GPU time
+// catches up with it before the next
+static constexpr float MAX_STEP = .05f;
+static constexpr uint32_t SETTLE_FRAMES = 8;
+// scales are snapped to this so the render area doesn't change by a pixel every frame
+static constexpr float SCALE_QUANTUM = 1.f / 64.f;
+
+SveResolutionController::SveResolutionController(float gpuBudgetMs, float minScale, float maxScale)
+    : gpuBudgetMs{gpuBudgetMs} {
+    setScaleRange(minScale, maxScale);
+    scale = this->maxScale;
+}
+
+void SveResolutionController::setScaleRange(float minScale, float maxScale) {
+    assert(minScale > 0.f && minScale <= maxScale && "Invalid resolution scale range");
+    this->minScale = minScale;
+    this->maxScale = maxScale;
+    scale = std::clamp(scale, minScale, maxScale);
+}
+
+float SveResolutionController::update(float gpuFrameMs) {
+    framesSinceChange++;
+    if (gpuFrameMs <= 0.f || gpuBudgetMs <= 0.f || framesSinceChange < SETTLE_FRAMES) {
+        return scale;
+    }
+
+    float ratio = gpuBudgetMs / gpuFrameMs;
+    if (std::abs(ratio - 1.f) < DEAD_BAND) {
+        return scale;
+    }
+
+    float target = scale * std::sqrt(ratio);
+    float next = scale + std::clamp(target - scale, -MAX_STEP, MAX_STEP);
+    next = std::clamp(std::round(next / SCALE_QUANTUM) * SCALE_QUANTUM, minScale, maxScale);
+    if (next != scale) {
+        scale = next;
+        framesSinceChange = 0;
+    }
+    return scale;
+}
+
+VkExtent2D SveResolutionController::scaledExtent(VkExtent2D fullExtent) const {
+    return {
+        std::max(1u, static_cast<uint32_t>(std::lround(fullExtent.width * scale))),
+        std::max(1u, static_cast<uint32_t>(std::lround(fullExtent.height * scale)))};
+}
+
+}  // namespace sve
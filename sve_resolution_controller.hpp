@@ -0,0 +1,37 @@
+#pragma once
+
+// libs
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+
+namespace sve {
+
+// Picks the render resolution scale that keeps the GPU frame time within a budget. GPU cost is
+// taken to grow with the pixel count, i.e. with the square of the scale, so the scale moves
+// towards scale * sqrt(budget / gpu time). Timings arrive a few frames late and smoothed, so
+// changes are rate limited and small errors inside the dead band are ignored to avoid oscillating
+class SveResolutionController {
+   public:
+    explicit SveResolutionController(float gpuBudgetMs, float minScale = .5f, float maxScale = 1.f);
+
+    void setGpuBudgetMs(float budgetMs) { gpuBudgetMs = budgetMs; }
+    float getGpuBudgetMs() const { return gpuBudgetMs; }
+    void setScaleRange(float minScale, float maxScale);
+
+    // once per frame with the latest GPU frame time, 0 (no timestamps yet) leaves the scale alone
+    float update(float gpuFrameMs);
+    float getScale() const { return scale; }
+    // extent at the current scale, at least one pixel
+    VkExtent2D scaledExtent(VkExtent2D fullExtent) const;
+
+   private:
+    float gpuBudgetMs;
+    float minScale;
+    float maxScale;
+    float scale = 1.f;
+    uint32_t framesSinceChange = 0;
+};
+
+}  // namespace sve
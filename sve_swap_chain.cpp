@@ -1,6 +1,10 @@
 #include "sve_swap_chain.hpp"
 
+#include "sve_command_counters.hpp"
+#include "sve_cpu_profiler.hpp"
+
 // std
+#include <algorithm>
 #include <array>
 #include <cstdlib>
 #include <cstring>
@@ -8,16 +12,30 @@
 #include <limits>
 #include <set>
 #include <stdexcept>
+#include <utility>
 
 namespace sve {
 
-SveSwapChain::SveSwapChain(SveDevice &deviceRef, VkExtent2D extent)
-    : device{deviceRef}, windowExtent{extent} {
+SveSwapChain::SveSwapChain(
+    SveDevice &deviceRef,
+    VkExtent2D extent,
+    SvePresentPolicy policy,
+    SveImagePool &attachmentPool)
+    : presentPolicy{policy}, device{deviceRef}, attachmentPool{attachmentPool}, windowExtent{extent} {
     init();
 }
 
-SveSwapChain::SveSwapChain(SveDevice &deviceRef, VkExtent2D extent, std::shared_ptr<SveSwapChain> previous)
-    : device{deviceRef}, windowExtent{extent}, oldSwapChain{previous} {
+SveSwapChain::SveSwapChain(
+    SveDevice &deviceRef,
+    VkExtent2D extent,
+    SvePresentPolicy policy,
+    SveImagePool &attachmentPool,
+    std::shared_ptr<SveSwapChain> previous)
+    : presentPolicy{policy},
+      device{deviceRef},
+      attachmentPool{attachmentPool},
+      windowExtent{extent},
+      oldSwapChain{previous} {
     init();
 
     // clearn up old swap chain since it is no longer needed
@@ -25,10 +43,21 @@ SveSwapChain::SveSwapChain(SveDevice &deviceRef, VkExtent2D extent, std::shared_
 }
 
 void SveSwapChain::init() {
+    SVE_PROFILE_FUNCTION();
     createSwapChain();
     createImageViews();
-    createRenderPass();
+    swapChainDepthFormat = findDepthFormat();
+    if (oldSwapChain != nullptr && oldSwapChain->compareSwapFormats(*this)) {
+        // same formats give identical render passes, the old swap chain's frames in flight keep
+        // using them so they are handed over rather than destroyed
+        renderPass = std::exchange(oldSwapChain->renderPass, VK_NULL_HANDLE);
+        deferredRenderPass = std::exchange(oldSwapChain->deferredRenderPass, VK_NULL_HANDLE);
+    } else {
+        createRenderPass();
+        createDeferredRenderPass();
+    }
     createDepthResources();
+    createGBufferResources();
     createFramebuffers();
     createSyncObjects();
 }
@@ -43,55 +72,134 @@ SveSwapChain::~SveSwapChain() {
         vkDestroySwapchainKHR(device.device(), swapChain, nullptr);
         swapChain = nullptr;
     }
+    for (size_t i = 0; i < offscreenAllocations.size(); i++) {
+        device.destroyImage(swapChainImages[i], offscreenAllocations[i]);
+    }
 
-    for (int i = 0; i < depthImages.size(); i++) {
-        vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
-        vkDestroyImage(device.device(), depthImages[i], nullptr);
-        vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
+    // only destroyed once its last frame has completed, so the attachments are free to reuse
+    for (auto &attachment : depthAttachments) {
+        attachmentPool.release(attachment);
+    }
+    for (auto &attachment : albedoAttachments) {
+        attachmentPool.release(attachment);
+    }
+    for (auto &attachment : normalAttachments) {
+        attachmentPool.release(attachment);
     }
 
     for (auto framebuffer : swapChainFramebuffers) {
         vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
     }
+    for (auto framebuffer : deferredFramebuffers) {
+        vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
+    }
 
-    vkDestroyRenderPass(device.device(), renderPass, nullptr);
+    // null when a newer swap chain took them over
+    if (renderPass != VK_NULL_HANDLE) {
+        vkDestroyRenderPass(device.device(), renderPass, nullptr);
+    }
+    if (deferredRenderPass != VK_NULL_HANDLE) {
+        vkDestroyRenderPass(device.device(), deferredRenderPass, nullptr);
+    }
 
     // cleanup synchronization objects
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
-        vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
-        vkDestroyFence(device.device(), inFlightFences[i], nullptr);
+    if (!pendingPresentFences.empty()) {
+        vkWaitForFences(
+            device.device(),
+            static_cast<uint32_t>(pendingPresentFences.size()),
+            pendingPresentFences.data(),
+            VK_TRUE,
+            std::numeric_limits<uint64_t>::max());
+    }
+    for (auto fence : pendingPresentFences) {
+        vkDestroyFence(device.device(), fence, nullptr);
+    }
+    for (auto fence : freePresentFences) {
+        vkDestroyFence(device.device(), fence, nullptr);
+    }
+    for (auto semaphore : renderFinishedSemaphores) {
+        vkDestroySemaphore(device.device(), semaphore, nullptr);
+    }
+    for (auto semaphore : imageAvailableSemaphores) {
+        vkDestroySemaphore(device.device(), semaphore, nullptr);
     }
 }
 
-VkResult SveSwapChain::acquireNextImage(uint32_t *imageIndex) {
-    vkWaitForFences(
-        device.device(),
-        1,
-        &inFlightFences[currentFrame],
-        VK_TRUE,
-        std::numeric_limits<uint64_t>::max());
+VkResult SveSwapChain::acquireNextImage(uint32_t frameIndex, uint32_t *imageIndex) {
+    if (isHeadless()) {
+        // plain round robin, SveRenderer waits for the image's last frame before reusing it
+        *imageIndex = nextOffscreenImage;
+        nextOffscreenImage = (nextOffscreenImage + 1) % static_cast<uint32_t>(imageCount());
+        return VK_SUCCESS;
+    }
 
+    SVE_PROFILE_SCOPE("vkAcquireNextImageKHR");
     VkResult result = vkAcquireNextImageKHR(
         device.device(),
         swapChain, std::numeric_limits<uint64_t>::max(),
-        imageAvailableSemaphores[currentFrame],  // must be a not signaled semaphore
+        imageAvailableSemaphores[frameIndex],  // must be a not signaled semaphore
         VK_NULL_HANDLE,
         imageIndex);
 
+    if ((result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) && *imageIndex == firstPresentedImage) {
+        firstPresentReacquired = true;
+    }
     return result;
 }
 
-VkResult SveSwapChain::submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex) {
-    if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
-        vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
+bool SveSwapChain::presentsCompleted() {
+    if (isHeadless()) {
+        return true;
     }
-    imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
+    if (!device.supportsSwapchainMaintenance1()) {
+        return false;
+    }
+
+    auto signaled = std::partition(pendingPresentFences.begin(), pendingPresentFences.end(), [&](VkFence fence) {
+        return vkGetFenceStatus(device.device(), fence) == VK_NOT_READY;
+    });
+    if (signaled != pendingPresentFences.end()) {
+        vkResetFences(
+            device.device(),
+            static_cast<uint32_t>(pendingPresentFences.end() - signaled),
+            &*signaled);
+        freePresentFences.insert(freePresentFences.end(), signaled, pendingPresentFences.end());
+        pendingPresentFences.erase(signaled, pendingPresentFences.end());
+    }
+    return pendingPresentFences.empty();
+}
 
+VkResult SveSwapChain::submitCommandBuffers(
+    const VkCommandBuffer *buffers,
+    uint32_t frameIndex,
+    uint32_t *imageIndex,
+    VkSemaphore frameTimeline,
+    uint64_t frameValue) {
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-    VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
+    if (isHeadless()) {
+        // nothing acquired and nothing presented, only the frame timeline is signaled
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = buffers;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &frameTimeline;
+
+        VkTimelineSemaphoreSubmitInfoKHR timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+        timelineInfo.signalSemaphoreValueCount = 1;
+        timelineInfo.pSignalSemaphoreValues = &frameValue;
+        submitInfo.pNext = &timelineInfo;
+
+        SVE_PROFILE_SCOPE("vkQueueSubmit");
+        SveCommandCounters::count(SveCommandCounters::Submits);
+        if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit draw command buffer!");
+        }
+        return VK_SUCCESS;
+    }
+
+    VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[frameIndex]};
     VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
     submitInfo.waitSemaphoreCount = 1;
     submitInfo.pWaitSemaphores = waitSemaphores;
@@ -100,39 +208,89 @@ VkResult SveSwapChain::submitCommandBuffers(const VkCommandBuffer *buffers, uint
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = buffers;
 
-    VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-    submitInfo.signalSemaphoreCount = 1;
+    VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[*imageIndex], frameTimeline};
+    submitInfo.signalSemaphoreCount = 2;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
-    vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
-
-    if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
-        throw std::runtime_error("failed to submit draw command buffer!");
+    // values of binary semaphores are ignored
+    uint64_t waitValues[] = {0};
+    uint64_t signalValues[] = {0, frameValue};
+    VkTimelineSemaphoreSubmitInfoKHR timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+    timelineInfo.waitSemaphoreValueCount = 1;
+    timelineInfo.pWaitSemaphoreValues = waitValues;
+    timelineInfo.signalSemaphoreValueCount = 2;
+    timelineInfo.pSignalSemaphoreValues = signalValues;
+    submitInfo.pNext = &timelineInfo;
+
+    {
+        SVE_PROFILE_SCOPE("vkQueueSubmit");
+        SveCommandCounters::count(SveCommandCounters::Submits);
+        if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit draw command buffer!");
+        }
     }
 
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
     presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = signalSemaphores;
+    presentInfo.pWaitSemaphores = &renderFinishedSemaphores[*imageIndex];
 
     VkSwapchainKHR swapChains[] = {swapChain};
     presentInfo.swapchainCount = 1;
     presentInfo.pSwapchains = swapChains;
     presentInfo.pImageIndices = imageIndex;
 
-    VkResult result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
+    VkFence presentFence = VK_NULL_HANDLE;
+    VkSwapchainPresentFenceInfoEXT presentFenceInfo{};
+    if (device.supportsSwapchainMaintenance1()) {
+        presentsCompleted();  // recycles the signaled fences
+        if (freePresentFences.empty()) {
+            VkFenceCreateInfo fenceInfo{};
+            fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            if (vkCreateFence(device.device(), &fenceInfo, nullptr, &presentFence) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create present fence!");
+            }
+        } else {
+            presentFence = freePresentFences.back();
+            freePresentFences.pop_back();
+        }
+        presentFenceInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_PRESENT_FENCE_INFO_EXT;
+        presentFenceInfo.swapchainCount = 1;
+        presentFenceInfo.pFences = &presentFence;
+        presentInfo.pNext = &presentFenceInfo;
+    }
 
-    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    SVE_PROFILE_SCOPE("vkQueuePresentKHR");
+    VkResult result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
 
+    // out of date and surface lost presents still count as enqueued, their fence signals and their
+    // wait semaphore is still waited on
+    bool enqueued = result >= 0 || result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_ERROR_SURFACE_LOST_KHR;
+    if (presentFence != VK_NULL_HANDLE) {
+        if (enqueued) {
+            pendingPresentFences.push_back(presentFence);
+        } else {
+            vkDestroyFence(device.device(), presentFence, nullptr);
+        }
+    }
+    if (enqueued && firstPresentedImage == std::numeric_limits<uint32_t>::max()) {
+        firstPresentedImage = *imageIndex;
+    }
     return result;
 }
 
 void SveSwapChain::createSwapChain() {
+    if (isHeadless()) {
+        createOffscreenImages();
+        return;
+    }
+
     SwapChainSupportDetails swapChainSupport = device.getSwapChainSupport();
 
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-    VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+    presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
     VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
     uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
@@ -189,6 +347,39 @@ void SveSwapChain::createSwapChain() {
     swapChainExtent = extent;
 }
 
+void SveSwapChain::createOffscreenImages() {
+    swapChainImageFormat = HEADLESS_IMAGE_FORMAT;
+    swapChainExtent = windowExtent;
+    presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;  // nothing waits on a display
+    presentLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+    // one per frame in flight, so a frame never waits on an image another frame still renders to
+    swapChainImages.resize(MAX_FRAMES_IN_FLIGHT);
+    offscreenAllocations.resize(MAX_FRAMES_IN_FLIGHT);
+    for (size_t i = 0; i < swapChainImages.size(); i++) {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = swapChainExtent.width;
+        imageInfo.extent.height = swapChainExtent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = swapChainImageFormat;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        device.createImageWithInfo(
+            imageInfo,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            swapChainImages[i],
+            offscreenAllocations[i]);
+    }
+}
+
 void SveSwapChain::createImageViews() {
     swapChainImageViews.resize(swapChainImages.size());
     for (size_t i = 0; i < swapChainImages.size(); i++) {
@@ -232,7 +423,7 @@ void SveSwapChain::createRenderPass() {
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachment.finalLayout = presentLayout;
 
     VkAttachmentReference colorAttachmentRef = {};
     colorAttachmentRef.attachment = 0;
@@ -267,10 +458,114 @@ void SveSwapChain::createRenderPass() {
     }
 }
 
+// Two subpasses: the first writes albedo, normals and depth, the second reads them back as input
+// attachments at the same pixel and shades into the swap chain image. The G-buffer is never stored,
+// so on tile based GPUs it stays in tile memory and never touches main memory at all
+void SveSwapChain::createDeferredRenderPass() {
+    std::array<VkAttachmentDescription, 4> attachments{};
+
+    auto &colorAttachment = attachments[0];
+    colorAttachment.format = getSwapChainImageFormat();
+    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    colorAttachment.finalLayout = presentLayout;
+
+    auto &depthAttachment = attachments[1];
+    depthAttachment.format = findDepthFormat();
+    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+    // the lighting subpass discards pixels without geometry, so the G-buffer needs no clear
+    for (uint32_t i = 2; i < 4; i++) {
+        attachments[i].format = i == 2 ? GBUFFER_ALBEDO_FORMAT : GBUFFER_NORMAL_FORMAT;
+        attachments[i].samples = VK_SAMPLE_COUNT_1_BIT;
+        attachments[i].loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachments[i].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachments[i].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachments[i].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachments[i].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        attachments[i].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    }
+
+    std::array<VkAttachmentReference, 2> gbufferRefs = {{
+        {2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL},
+        {3, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL},
+    }};
+    VkAttachmentReference depthRef{1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+
+    // input_attachment_index 0, 1 and 2 in shaders/deferred_lighting.frag
+    std::array<VkAttachmentReference, 3> inputRefs = {{
+        {2, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+        {3, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+        {1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL},
+    }};
+    VkAttachmentReference colorRef{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+
+    std::array<VkSubpassDescription, 2> subpasses{};
+    subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpasses[0].colorAttachmentCount = static_cast<uint32_t>(gbufferRefs.size());
+    subpasses[0].pColorAttachments = gbufferRefs.data();
+    subpasses[0].pDepthStencilAttachment = &depthRef;
+
+    subpasses[1].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpasses[1].inputAttachmentCount = static_cast<uint32_t>(inputRefs.size());
+    subpasses[1].pInputAttachments = inputRefs.data();
+    subpasses[1].colorAttachmentCount = 1;
+    subpasses[1].pColorAttachments = &colorRef;
+
+    std::array<VkSubpassDependency, 3> dependencies{};
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependencies[0].srcAccessMask = 0;
+    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    // the swap chain image is first used in the lighting subpass, its transition has to wait on the
+    // acquire semaphore like in the forward pass
+    dependencies[1].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].dstSubpass = 1;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].srcAccessMask = 0;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+    // by region: each pixel only reads its own G-buffer texel, so tiles never have to be flushed
+    dependencies[2].srcSubpass = 0;
+    dependencies[2].dstSubpass = 1;
+    dependencies[2].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[2].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[2].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    dependencies[2].dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+    dependencies[2].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    renderPassInfo.pAttachments = attachments.data();
+    renderPassInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+    renderPassInfo.pSubpasses = subpasses.data();
+    renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    renderPassInfo.pDependencies = dependencies.data();
+
+    if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &deferredRenderPass) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create deferred render pass!");
+    }
+}
+
 void SveSwapChain::createFramebuffers() {
     swapChainFramebuffers.resize(imageCount());
     for (size_t i = 0; i < imageCount(); i++) {
-        std::array<VkImageView, 2> attachments = {swapChainImageViews[i], depthImageViews[i]};
+        std::array<VkImageView, 2> attachments = {swapChainImageViews[i], depthAttachments[i].view};
 
         VkExtent2D swapChainExtent = getSwapChainExtent();
         VkFramebufferCreateInfo framebufferInfo = {};
@@ -290,79 +585,83 @@ void SveSwapChain::createFramebuffers() {
             throw std::runtime_error("failed to create framebuffer!");
         }
     }
-}
 
-void SveSwapChain::createDepthResources() {
-    VkFormat depthFormat = findDepthFormat();
-    swapChainDepthFormat = depthFormat;
-    VkExtent2D swapChainExtent = getSwapChainExtent();
+    deferredFramebuffers.resize(imageCount());
+    for (size_t i = 0; i < imageCount(); i++) {
+        std::array<VkImageView, 4> attachments = {
+            swapChainImageViews[i],
+            depthAttachments[i].view,
+            albedoAttachments[i].view,
+            normalAttachments[i].view};
 
-    depthImages.resize(imageCount());
-    depthImageMemorys.resize(imageCount());
-    depthImageViews.resize(imageCount());
+        VkFramebufferCreateInfo framebufferInfo = {};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = deferredRenderPass;
+        framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        framebufferInfo.pAttachments = attachments.data();
+        framebufferInfo.width = swapChainExtent.width;
+        framebufferInfo.height = swapChainExtent.height;
+        framebufferInfo.layers = 1;
 
-    for (int i = 0; i < depthImages.size(); i++) {
-        VkImageCreateInfo imageInfo{};
-        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-        imageInfo.imageType = VK_IMAGE_TYPE_2D;
-        imageInfo.extent.width = swapChainExtent.width;
-        imageInfo.extent.height = swapChainExtent.height;
-        imageInfo.extent.depth = 1;
-        imageInfo.mipLevels = 1;
-        imageInfo.arrayLayers = 1;
-        imageInfo.format = depthFormat;
-        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        imageInfo.flags = 0;
+        if (vkCreateFramebuffer(device.device(), &framebufferInfo, nullptr, &deferredFramebuffers[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create deferred framebuffer!");
+        }
+    }
+}
 
-        device.createImageWithInfo(
-            imageInfo,
+void SveSwapChain::createDepthResources() {
+    depthAttachments.resize(imageCount());
+    for (auto &attachment : depthAttachments) {
+        attachment = attachmentPool.acquire(
+            swapChainDepthFormat,
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            depthImages[i],
-            depthImageMemorys[i]);
-
-        VkImageViewCreateInfo viewInfo{};
-        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-        viewInfo.image = depthImages[i];
-        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-        viewInfo.format = depthFormat;
-        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-        viewInfo.subresourceRange.baseMipLevel = 0;
-        viewInfo.subresourceRange.levelCount = 1;
-        viewInfo.subresourceRange.baseArrayLayer = 0;
-        viewInfo.subresourceRange.layerCount = 1;
+            swapChainExtent);
+    }
+}
 
-        if (vkCreateImageView(device.device(), &viewInfo, nullptr, &depthImageViews[i]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create texture image view!");
+void SveSwapChain::createGBufferResources() {
+    // fall back to regular device memory where nothing is lazily allocated (most desktop GPUs)
+    VkMemoryPropertyFlags memoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    const auto &deviceMemoryProperties = device.allocator().getMemoryProperties();
+    for (uint32_t i = 0; i < deviceMemoryProperties.memoryTypeCount; i++) {
+        if (deviceMemoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+            memoryProperties |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+            break;
         }
     }
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT |
+                              VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
+    albedoAttachments.resize(imageCount());
+    normalAttachments.resize(imageCount());
+    for (size_t i = 0; i < imageCount(); i++) {
+        albedoAttachments[i] = attachmentPool.acquire(GBUFFER_ALBEDO_FORMAT, usage, memoryProperties, swapChainExtent);
+        normalAttachments[i] = attachmentPool.acquire(GBUFFER_NORMAL_FORMAT, usage, memoryProperties, swapChainExtent);
+    }
 }
 
 void SveSwapChain::createSyncObjects() {
+    if (isHeadless()) {
+        return;  // frames are only ordered by the renderer's frame timeline
+    }
+
     imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-    imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+    renderFinishedSemaphores.resize(imageCount());
 
     VkSemaphoreCreateInfo semaphoreInfo = {};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    VkFenceCreateInfo fenceInfo = {};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) !=
-                VK_SUCCESS ||
-            vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) !=
-                VK_SUCCESS ||
-            vkCreateFence(device.device(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
+    for (auto &semaphore : imageAvailableSemaphores) {
+        if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
             throw std::runtime_error("failed to create synchronization objects for a frame!");
         }
     }
+    for (auto &semaphore : renderFinishedSemaphores) {
+        if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create synchronization objects for a swap chain image!");
+        }
+    }
 }
 
 VkSurfaceFormatKHR SveSwapChain::chooseSwapSurfaceFormat(
@@ -378,22 +677,28 @@ VkSurfaceFormatKHR SveSwapChain::chooseSwapSurfaceFormat(
 }
 
 VkPresentModeKHR SveSwapChain::chooseSwapPresentMode(const std::vector<VkPresentModeKHR> &availablePresentModes) {
-    /* Mailbox present mode for low latency. High power consumption and not always supported */
-    for (const auto &availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-            return availablePresentMode;
-        }
+    std::vector<VkPresentModeKHR> preferred;
+    switch (presentPolicy) {
+        case SvePresentPolicy::LowLatency:
+            preferred = {VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR};
+            break;
+        case SvePresentPolicy::Throughput:
+            preferred = {VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR};
+            break;
+        case SvePresentPolicy::PowerSaving:
+            break;
+        case SvePresentPolicy::Adaptive:
+            preferred = {VK_PRESENT_MODE_FIFO_RELAXED_KHR};
+            break;
     }
 
-    /* Immediate present mode for low latency. High power consumption and tearing. Usually supported */
-    // for (const auto &availablePresentMode : availablePresentModes) {
-    //   if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-    //     std::cout << "Present mode: Immediate" << std::endl;
-    //     return availablePresentMode;
-    //   }
-    // }
+    for (auto mode : preferred) {
+        if (std::find(availablePresentModes.begin(), availablePresentModes.end(), mode) != availablePresentModes.end()) {
+            return mode;
+        }
+    }
 
-    /* Default: FIFO present mode for mobile. Always supported but poor latency */
+    /* Default: FIFO present mode. Always supported, waits for vblank */
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
@@ -1,20 +1,55 @@
 #pragma once
 
 #include "sve_device.hpp"
+#include "sve_image_pool.hpp"
 
 // std
+#include <limits>
 #include <memory>
 #include <string>
 #include <vector>
 
 namespace sve {
 
+// what the present mode is picked for, falling back in order of preference when unsupported
+enum class SvePresentPolicy {
+    LowLatency,  // IMMEDIATE, MAILBOX, FIFO_RELAXED, FIFO: may tear, never waits on vblank
+    Throughput,  // MAILBOX, IMMEDIATE, FIFO: no tearing when possible, renders unthrottled
+    PowerSaving, // FIFO: vsync caps rendering at the refresh rate
+    Adaptive,    // FIFO_RELAXED, FIFO: vsync, but a late frame tears instead of waiting a whole interval
+};
+
 class SveSwapChain {
    public:
-    static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
-
-    SveSwapChain(SveDevice& deviceRef, VkExtent2D windowExtent);
-    SveSwapChain(SveDevice& deviceRef, VkExtent2D windowExtent, std::shared_ptr<SveSwapChain> previous);
+    // per-frame resources are created for this many frames, SveRenderer cycles through 1 to all of them
+    static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 3;
+    // deferred path G-buffer, albedo in srgb so dark vertex colors keep their precision
+    static constexpr VkFormat GBUFFER_ALBEDO_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+    static constexpr VkFormat GBUFFER_NORMAL_FORMAT = VK_FORMAT_A2B10G10R10_UNORM_PACK32;
+    // headless devices render to a ring of offscreen images instead, in a format every
+    // implementation can render to and sample
+    static constexpr VkFormat HEADLESS_IMAGE_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+
+    // attachments the deferred lighting subpass reads back as input attachments
+    struct GBufferViews {
+        VkImageView albedo;
+        VkImageView normal;
+        VkImageView depth;
+    };
+
+    // depth and G-buffer attachments come from attachmentPool and go back to it on destruction
+    SveSwapChain(
+        SveDevice& deviceRef,
+        VkExtent2D windowExtent,
+        SvePresentPolicy presentPolicy,
+        SveImagePool& attachmentPool);
+    // previous is retired, not destroyed. Its render passes are taken over when formats match
+    SveSwapChain(
+        SveDevice& deviceRef,
+        VkExtent2D windowExtent,
+        SvePresentPolicy presentPolicy,
+        SveImagePool& attachmentPool,
+        std::shared_ptr<SveSwapChain> previous);
     ~SveSwapChain();
 
     SveSwapChain(const SveSwapChain&) = delete;
@@ -22,18 +57,46 @@ class SveSwapChain {
 
     VkFramebuffer getFrameBuffer(uint32_t index) { return swapChainFramebuffers[index]; }
     VkRenderPass getRenderPass() { return renderPass; }
+    VkFramebuffer getDeferredFrameBuffer(uint32_t index) { return deferredFramebuffers[index]; }
+    VkRenderPass getDeferredRenderPass() { return deferredRenderPass; }
+    GBufferViews getGBufferViews(uint32_t index) {
+        return {albedoAttachments[index].view, normalAttachments[index].view, depthAttachments[index].view};
+    }
     VkImageView getImageView(uint32_t index) { return swapChainImageViews[index]; }
+    VkImage getImage(uint32_t index) { return swapChainImages[index]; }
+    VkFormat getSwapChainDepthFormat() { return swapChainDepthFormat; }
     size_t imageCount() { return swapChainImages.size(); }
     VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
     VkExtent2D getSwapChainExtent() { return swapChainExtent; }
+    VkPresentModeKHR getPresentMode() { return presentMode; }
+    // layout images are left in at the end of a frame: PRESENT_SRC, or TRANSFER_SRC when headless
+    // so they can be read back
+    VkImageLayout getPresentLayout() { return presentLayout; }
+    bool isHeadless() { return device.isHeadless(); }
     uint32_t width() { return swapChainExtent.width; }
     uint32_t height() { return swapChainExtent.height; }
 
     float extentAspectRatio() { return static_cast<float>(swapChainExtent.width) / static_cast<float>(swapChainExtent.height); }
     VkFormat findDepthFormat();
 
-    VkResult acquireNextImage(uint32_t* imageIndex);
-    VkResult submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex);
+    // frame pacing lives in SveRenderer, which must have waited for frameIndex's last submission
+    VkResult acquireNextImage(uint32_t frameIndex, uint32_t* imageIndex);
+    // also signals frameTimeline to frameValue once the command buffers have executed
+    VkResult submitCommandBuffers(
+        const VkCommandBuffer* buffers,
+        uint32_t frameIndex,
+        uint32_t* imageIndex,
+        VkSemaphore frameTimeline,
+        uint64_t frameValue);
+
+    // When a retired swap chain can be destroyed. With VK_EXT_swapchain_maintenance1 every present
+    // carries a fence, and this polls whether all of them have signaled
+    bool presentsCompleted();
+    // Without the extension nothing reports when the presentation engine is done with a present.
+    // Once the image this swap chain presented first is acquired again, that present has completed,
+    // and every present before it on a retired swap chain has too, provided presents are processed
+    // in order. The spec doesn't guarantee that, so this is a known limitation, not a fix
+    bool hasReacquiredFirstPresentedImage() const { return firstPresentReacquired; }
 
     bool compareSwapFormats(const SveSwapChain& other) const {
         return swapChainImageFormat == other.swapChainImageFormat &&
@@ -43,9 +106,12 @@ class SveSwapChain {
    private:
     void init();
     void createSwapChain();
+    void createOffscreenImages();
     void createImageViews();
     void createDepthResources();
     void createRenderPass();
+    void createDeferredRenderPass();
+    void createGBufferResources();
     void createFramebuffers();
     void createSyncObjects();
 
@@ -57,27 +123,44 @@ class SveSwapChain {
     VkFormat swapChainImageFormat;
     VkFormat swapChainDepthFormat;
     VkExtent2D swapChainExtent;
+    SvePresentPolicy presentPolicy;
+    VkPresentModeKHR presentMode;
+    VkImageLayout presentLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
     std::vector<VkFramebuffer> swapChainFramebuffers;
-    VkRenderPass renderPass;
-
-    std::vector<VkImage> depthImages;
-    std::vector<VkDeviceMemory> depthImageMemorys;
-    std::vector<VkImageView> depthImageViews;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    std::vector<VkFramebuffer> deferredFramebuffers;
+    VkRenderPass deferredRenderPass = VK_NULL_HANDLE;
+
+    // pooled, so they may be larger than the swap chain extent
+    std::vector<SveImagePool::Image> depthAttachments;
+    // transient, only ever live in tile memory on GPUs with lazily allocated memory
+    std::vector<SveImagePool::Image> albedoAttachments;
+    std::vector<SveImagePool::Image> normalAttachments;
     std::vector<VkImage> swapChainImages;
     std::vector<VkImageView> swapChainImageViews;
+    // headless only, the images above are owned by the swap chain object itself
+    std::vector<SveAllocation> offscreenAllocations;
+    uint32_t nextOffscreenImage = 0;
 
     SveDevice& device;
+    SveImagePool& attachmentPool;
     VkExtent2D windowExtent;
 
-    VkSwapchainKHR swapChain;
+    VkSwapchainKHR swapChain = VK_NULL_HANDLE;
     std::shared_ptr<SveSwapChain> oldSwapChain;
 
-    std::vector<VkSemaphore> imageAvailableSemaphores;
+    std::vector<VkSemaphore> imageAvailableSemaphores;  // per frame slot
+    // per image: present holds on to its wait semaphore until the image is acquired again, so a
+    // per frame slot semaphore could still be in use when its slot comes around
     std::vector<VkSemaphore> renderFinishedSemaphores;
-    std::vector<VkFence> inFlightFences;
-    std::vector<VkFence> imagesInFlight;
-    size_t currentFrame = 0;
+
+    // swapchain maintenance1 only: fences of presents not known to have completed, and signaled
+    // ones reset for the next present
+    std::vector<VkFence> pendingPresentFences;
+    std::vector<VkFence> freePresentFences;
+    uint32_t firstPresentedImage = std::numeric_limits<uint32_t>::max();
+    bool firstPresentReacquired = false;
 };
 
 }  // namespace sve
\ No newline at end of file
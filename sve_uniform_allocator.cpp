@@ -0,0 +1,56 @@
+#include "sve_uniform_allocator.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace sve {
+
+SveUniformAllocator::SveUniformAllocator(SveDevice &device, uint32_t frameCount, VkDeviceSize bytesPerFrame)
+    : sveDevice{device} {
+    alignment = std::max<VkDeviceSize>(sveDevice.properties.limits.minUniformBufferOffsetAlignment, 1);
+    capacity = SveBuffer::getAlignment(bytesPerFrame, alignment);
+
+    frameBuffers.resize(frameCount);
+    for (auto &buffer : frameBuffers) {
+        buffer = std::make_unique<SveBuffer>(
+            sveDevice,
+            capacity,
+            1,
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        buffer->map();  // stays mapped for the allocator's lifetime
+    }
+}
+
+SveUniformAllocator::~SveUniformAllocator() {}
+
+void SveUniformAllocator::beginFrame(int frameIndex) {
+    assert(frameIndex < static_cast<int>(frameBuffers.size()) && "Frame index out of range");
+    currentFrame = frameIndex;
+    head = 0;
+}
+
+SveUniformAllocator::Allocation SveUniformAllocator::allocate(VkDeviceSize size) {
+    assert(size <= sveDevice.properties.limits.maxUniformBufferRange && "Uniform block exceeds maxUniformBufferRange");
+
+    VkDeviceSize offset = head;
+    if (offset + size > capacity) {
+        throw std::runtime_error("per-frame uniform allocator is out of space!");
+    }
+    head = SveBuffer::getAlignment(offset + size, alignment);
+
+    char *base = static_cast<char *>(frameBuffers[currentFrame]->getMappedMemory());
+    return {base + offset, static_cast<uint32_t>(offset)};
+}
+
+void SveUniformAllocator::flush() {
+    if (head == 0) {
+        return;
+    }
+    // the device allocator rounds the range out to nonCoherentAtomSize and skips coherent memory
+    frameBuffers[currentFrame]->flush(head);
+}
+
+}  // namespace sve
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "sve_buffer.hpp"
+#include "sve_device.hpp"
+
+// std
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace sve {
+
+// Linear allocator for per-frame uniform data: one persistently mapped buffer per frame in flight,
+// bump allocated at minUniformBufferOffsetAlignment and rewound when its frame slot comes around
+// again. Blocks are bound through UNIFORM_BUFFER_DYNAMIC descriptors, so pushing a block costs a
+// pointer bump and one dynamic offset instead of a buffer and descriptor set of its own
+class SveUniformAllocator {
+   public:
+    struct Allocation {
+        void *mapped;
+        uint32_t offset;  // dynamic offset to pass to vkCmdBindDescriptorSets
+    };
+
+    SveUniformAllocator(SveDevice &device, uint32_t frameCount, VkDeviceSize bytesPerFrame = 1 << 20);
+    ~SveUniformAllocator();
+
+    SveUniformAllocator(const SveUniformAllocator &) = delete;
+    SveUniformAllocator &operator=(const SveUniformAllocator &) = delete;
+
+    // rewinds the slot, only call once the frame's fence has been waited on
+    void beginFrame(int frameIndex);
+    Allocation allocate(VkDeviceSize size);
+    void flush();  // make this frame's writes visible to the device, call before submitting
+
+    template <typename T>
+    uint32_t push(const T &data) {
+        Allocation allocation = allocate(sizeof(T));
+        std::memcpy(allocation.mapped, &data, sizeof(T));
+        return allocation.offset;
+    }
+
+    // descriptor for a dynamic uniform binding whose blocks are `range` bytes
+    VkDescriptorBufferInfo descriptorInfo(int frameIndex, VkDeviceSize range) {
+        return frameBuffers[frameIndex]->descriptorInfo(range, 0);
+    }
+    VkDeviceSize bytesUsed() const { return head; }
+
+   private:
+    SveDevice &sveDevice;
+    std::vector<std::unique_ptr<SveBuffer>> frameBuffers;
+    VkDeviceSize capacity;
+    VkDeviceSize alignment;
+
+    int currentFrame = 0;
+    VkDeviceSize head = 0;
+};
+
+}  // namespace sve
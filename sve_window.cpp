@@ -1,17 +1,23 @@
 #include "sve_window.hpp"
 
 // std
+#include <cassert>
 #include <stdexcept>
 
 namespace sve {
 
-SveWindow::SveWindow(int w, int h, std::string name) : width{w}, height{h}, windowName{name} {
-    initWindow();
+SveWindow::SveWindow(int w, int h, std::string name, bool headless)
+    : width{w}, height{h}, headless{headless}, windowName{name} {
+    if (!headless) {
+        initWindow();
+    }
 }
 
 SveWindow::~SveWindow() {
-    glfwDestroyWindow(window);
-    glfwTerminate();
+    if (!headless) {
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
 }
 
 void SveWindow::initWindow() {
@@ -25,6 +31,7 @@ void SveWindow::initWindow() {
 }
 
 void SveWindow::createWindowSurface(VkInstance instance, VkSurfaceKHR *surface) {
+    assert(!headless && "Headless windows have no surface");
     if (glfwCreateWindowSurface(instance, window, nullptr, surface) != VK_SUCCESS) {
         throw std::runtime_error("failed to create window surface!");
     }
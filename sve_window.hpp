@@ -8,13 +8,16 @@ namespace sve {
 
 class SveWindow {
    public:
-    SveWindow(int w, int h, std::string name);
+    // headless skips GLFW entirely: no window and no surface, the extent is only the resolution
+    // to render at and the window never closes or resizes
+    SveWindow(int w, int h, std::string name, bool headless = false);
     ~SveWindow();
 
     SveWindow(const SveWindow &) = delete;
     SveWindow &operator=(const SveWindow &) = delete;
 
-    bool shouldClose() { return glfwWindowShouldClose(window); }
+    bool shouldClose() { return !headless && glfwWindowShouldClose(window); }
+    bool isHeadless() const { return headless; }
     VkExtent2D getExtent() { return {static_cast<uint32_t>(width), static_cast<uint32_t>(height)}; }
     bool wasWindowResized() { return framebufferResized; }
     void resetWindowResizedFlag() { framebufferResized = false; }
@@ -29,8 +32,9 @@ class SveWindow {
     int width;
     int height;
     bool framebufferResized = false;
+    bool headless;
 
     std::string windowName;
-    GLFWwindow *window;
+    GLFWwindow *window = nullptr;
 };
 }  // namespace sve
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "upscale_render_system.hpp"
+
+#include "sve_command_counters.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <cassert>
+#include <stdexcept>
+
+namespace sve {
+
+struct UpscalePushConstantData {
+    glm::vec2 uvScale;          // rendered part of the source image, in uv
+    glm::vec2 sourceTexelSize;  // 1 / source extent
+    glm::vec2 targetSize;
+    float sharpness;
+};
+
+UpscaleRenderSystem::UpscaleRenderSystem(SveDevice &device, VkFormat colorFormat, SveDescriptorLayoutCache &layoutCache)
+    : sveDevice{device} {
+    // the source image changes every frame, so push it when the device can instead of allocating a set
+    VkDescriptorSetLayoutCreateFlags setFlags =
+        sveDevice.supportsPushDescriptors() ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR : 0;
+    sourceSetLayout = SveDescriptorSetLayout::Builder(sveDevice)
+                          .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+                          .setFlags(setFlags)
+                          .build(layoutCache);
+    createRenderPass(colorFormat);
+    createSampler();
+    createPipelineLayout();
+    createPipeline();
+
+    auto templateBuilder = SveDescriptorUpdateTemplate::Builder(*sourceSetLayout).addEntry(0, 0);
+    sourceTemplate = sourceSetLayout->isPushDescriptor()
+                         ? templateBuilder.buildForPush(VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0)
+                         : templateBuilder.build();
+}
+
+UpscaleRenderSystem::~UpscaleRenderSystem() {
+    vkDestroyPipelineLayout(sveDevice.device(), pipelineLayout, nullptr);
+    vkDestroySampler(sveDevice.device(), sampler, nullptr);
+    vkDestroyRenderPass(sveDevice.device(), renderPass, nullptr);
+}
+
+void UpscaleRenderSystem::createRenderPass(VkFormat colorFormat) {
+    VkAttachmentDescription colorAttachment{};
+    colorAttachment.format = colorFormat;
+    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference colorAttachmentRef{};
+    colorAttachmentRef.attachment = 0;
+    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorAttachmentRef;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &colorAttachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+
+    if (vkCreateRenderPass(sveDevice.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upscale render pass!");
+    }
+}
+
+void UpscaleRenderSystem::createSampler() {
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.minLod = 0.f;
+    samplerInfo.maxLod = 0.f;
+    if (vkCreateSampler(sveDevice.device(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upscale sampler!");
+    }
+}
+
+void UpscaleRenderSystem::createPipelineLayout() {
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    pushConstantRange.size = sizeof(UpscalePushConstantData);
+
+    VkDescriptorSetLayout setLayout = sourceSetLayout->getDescriptorSetLayout();
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(sveDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upscale pipeline layout!");
+    }
+}
+
+void UpscaleRenderSystem::createPipeline() {
+    assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+
+    PipelineConfigInfo pipelineConfig{};
+    SvePipeline::defaultPipelineConfigInfo(pipelineConfig);
+    pipelineConfig.renderPass = renderPass;
+    pipelineConfig.pipelineLayout = pipelineLayout;
+    pipelineConfig.bindingDescriptions.clear();  // full screen triangle from gl_VertexIndex
+    pipelineConfig.attributeDescriptions.clear();
+    pipelineConfig.depthStencilInfo.depthTestEnable = VK_FALSE;
+    pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+    // the deferred lighting pass's vertex shader already draws exactly that triangle
+    pipeline = std::make_unique<SvePipeline>(
+        sveDevice,
+        "shaders/deferred_lighting.vert.spv",
+        "shaders/upscale.frag.spv",
+        pipelineConfig);
+}
+
+void UpscaleRenderSystem::render(
+    FrameInfo &frameInfo,
+    VkImageView source,
+    VkExtent2D sourceExtent,
+    VkExtent2D renderExtent,
+    VkExtent2D targetExtent) {
+    SveCommandScope commandScope{"upscale"};
+    VkDescriptorImageInfo sourceInfo{sampler, source, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
+    pipeline->bind(frameInfo.commandBuffer);
+    if (sourceSetLayout->isPushDescriptor()) {
+        sourceTemplate->push(frameInfo.commandBuffer, &sourceInfo);
+    } else {
+        VkDescriptorSet sourceSet;
+        auto &allocator = frameInfo.frameDescriptorAllocator;
+        if (!allocator.allocateDescriptor(sourceSetLayout->getDescriptorSetLayout(), sourceSet)) {
+            throw std::runtime_error("failed to allocate upscale descriptor set!");
+        }
+        sourceTemplate->update(sourceSet, &sourceInfo);
+        SveCommandCounters::bindDescriptorSets(
+            frameInfo.commandBuffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            pipelineLayout,
+            0,
+            1,
+            &sourceSet,
+            0,
+            nullptr);
+    }
+
+    UpscalePushConstantData push{};
+    push.uvScale = {
+        static_cast<float>(renderExtent.width) / sourceExtent.width,
+        static_cast<float>(renderExtent.height) / sourceExtent.height};
+    push.sourceTexelSize = {1.f / sourceExtent.width, 1.f / sourceExtent.height};
+    push.targetSize = {static_cast<float>(targetExtent.width), static_cast<float>(targetExtent.height)};
+    push.sharpness = sharpness;
+    SveCommandCounters::pushConstants(
+        frameInfo.commandBuffer,
+        pipelineLayout,
+        VK_SHADER_STAGE_FRAGMENT_BIT,
+        0,
+        sizeof(UpscalePushConstantData),
+        &push);
+    SveCommandCounters::draw(frameInfo.commandBuffer, 3, 1, 0, 0);
+}
+
+}  // namespace sve
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "sve_descriptors.hpp"
+#include "sve_device.hpp"
+#include "sve_frame_info.hpp"
+#include "sve_pipeline.hpp"
+
+// std
+#include <memory>
+
+namespace sve {
+
+// Stretches the part of an offscreen image the scene was rendered to over the whole target with
+// bilinear filtering, then sharpens it with a contrast adaptive filter to win back some of the
+// detail lost to the lower resolution. Draws a full screen triangle, so call it inside a render
+// pass with a single color attachment of colorFormat
+class UpscaleRenderSystem {
+   public:
+    UpscaleRenderSystem(SveDevice &device, VkFormat colorFormat, SveDescriptorLayoutCache &layoutCache);
+    ~UpscaleRenderSystem();
+
+    UpscaleRenderSystem(const UpscaleRenderSystem &) = delete;
+    UpscaleRenderSystem &operator=(const UpscaleRenderSystem &) = delete;
+
+    // 0 plain bilinear up to 1 strongest
+    void setSharpness(float value) { sharpness = value; }
+    float getSharpness() const { return sharpness; }
+
+    // source must be in SHADER_READ_ONLY_OPTIMAL, only its top left renderExtent texels are read
+    void render(
+        FrameInfo &frameInfo,
+        VkImageView source,
+        VkExtent2D sourceExtent,
+        VkExtent2D renderExtent,
+        VkExtent2D targetExtent);
+
+   private:
+    void createRenderPass(VkFormat colorFormat);
+    void createSampler();
+    void createPipelineLayout();
+    void createPipeline();
+
+    SveDevice &sveDevice;
+
+    // only for building the pipeline, the render graph's pass with the same format is compatible
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkSampler sampler = VK_NULL_HANDLE;
+    std::shared_ptr<SveDescriptorSetLayout> sourceSetLayout;
+    // push template when the device has VK_KHR_push_descriptor, set template otherwise
+    std::unique_ptr<SveDescriptorUpdateTemplate> sourceTemplate;
+    std::unique_ptr<SvePipeline> pipeline;
+    VkPipelineLayout pipelineLayout;
+    float sharpness = .5f;
+};
+
+}  // namespace sve